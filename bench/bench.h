@@ -0,0 +1,133 @@
+/**
+ * @file bench.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Helpers of the benchmarks of the native platform: timing with the monotonic clock of the host and output of the results as JSON.
+ *
+ * The results are costs in picoseconds per operation (integers, so that CMake can compare them with the baselines). Each benchmark is repeated `BENCH_REPETITIONS` times and the fastest run is kept, which filters out the noise of the host.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+
+/* Defines -------------------------------------------------------------------*/
+#ifndef BENCH_REPETITIONS
+#define BENCH_REPETITIONS 7 /*!< Runs of each benchmark. The fastest one is kept */
+#endif
+#ifndef BENCH_BUILD_TYPE
+#define BENCH_BUILD_TYPE "Unknown" /*!< Build type of the benchmark. Only results of the same build type are comparable */
+#endif
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Body of a benchmark: it runs the operation `iterations` times.
+ */
+typedef void (*bench_fn_t)(uint32_t iterations);
+
+/**
+ * @brief Output of the results of a benchmark.
+ */
+typedef struct
+{
+    FILE *p_file;  /*!< JSON file */
+    int n_results; /*!< Number of results written */
+} bench_output_t;
+
+/* Functions -----------------------------------------------------------------*/
+/**
+ * @brief Gets the monotonic time of the host in nanoseconds.
+ */
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Runs a benchmark `BENCH_REPETITIONS` times and gets the cost of the fastest run.
+ *
+ * @param fn Body of the benchmark.
+ * @param iterations Operations of each run.
+ * @return uint64_t Picoseconds per operation.
+ */
+static inline uint64_t bench_run_ps(bench_fn_t fn, uint32_t iterations)
+{
+    uint64_t best_ns = UINT64_MAX;
+    for (int i = 0; i < BENCH_REPETITIONS; i++)
+    {
+        uint64_t start_ns = bench_now_ns();
+        fn(iterations);
+        uint64_t elapsed_ns = bench_now_ns() - start_ns;
+        if (elapsed_ns < best_ns)
+        {
+            best_ns = elapsed_ns;
+        }
+    }
+    return (best_ns * 1000U) / iterations;
+}
+
+/**
+ * @brief Opens the output of a benchmark. The results are also printed to `stdout`.
+ *
+ * @param p_out Output to open.
+ * @param p_path Path of the JSON file, or NULL for `stdout` only.
+ * @param p_name Name of the benchmark.
+ * @return int 0 on success, 1 if the file cannot be created.
+ */
+static inline int bench_begin(bench_output_t *p_out, const char *p_path, const char *p_name)
+{
+    p_out->p_file = (p_path != NULL) ? fopen(p_path, "w") : stdout;
+    p_out->n_results = 0;
+    if (p_out->p_file == NULL)
+    {
+        perror(p_path);
+        return 1;
+    }
+    fprintf(p_out->p_file, "{\n  \"benchmark\": \"%s\",\n  \"build_type\": \"%s\",\n  \"unit\": \"ps/op\",\n  \"results\": {", p_name, BENCH_BUILD_TYPE);
+    return 0;
+}
+
+/**
+ * @brief Writes a result of a benchmark.
+ *
+ * @param p_out Output of the benchmark.
+ * @param p_key Name of the result.
+ * @param ps_per_op Picoseconds per operation.
+ */
+static inline void bench_result(bench_output_t *p_out, const char *p_key, uint64_t ps_per_op)
+{
+    fprintf(p_out->p_file, "%s\n    \"%s\": %" PRIu64, (p_out->n_results > 0) ? "," : "", p_key, ps_per_op);
+    if (p_out->p_file != stdout)
+    {
+        printf("%s: %" PRIu64 ".%03" PRIu64 " ns/op\n", p_key, ps_per_op / 1000U, ps_per_op % 1000U);
+    }
+    p_out->n_results++;
+}
+
+/**
+ * @brief Closes the output of a benchmark.
+ *
+ * @param p_out Output of the benchmark.
+ * @return int 0 on success, 1 if the file could not be written.
+ */
+static inline int bench_end(bench_output_t *p_out)
+{
+    fprintf(p_out->p_file, "\n  }\n}\n");
+    if (p_out->p_file != stdout)
+    {
+        return (fclose(p_out->p_file) == 0) ? 0 : 1;
+    }
+    return 0;
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,132 @@
+/**
+ * @file bench_fsm.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Benchmark of the thermostat FSM: firing without and with new samples, transitions and queries of the history.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bench.h"
+#include "port_system.h"
+#include "port_led.h"
+#include "port_temp_sensor.h"
+#include "fsm_thermostat.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_ITERATIONS 1000000U /*!< Operations of each run */
+#define BENCH_HISTORY_EVENTS 32U  /*!< Events read by each query of the history */
+
+/* Global variables -----------------------------------------------------------*/
+static fsm_t *p_fsm;                      /*!< Thermostat under test */
+static uint32_t cold_counts;              /*!< Measurement below the threshold */
+static uint32_t warm_counts;              /*!< Measurement above the threshold */
+static volatile uint32_t sink;            /*!< Keeps the results of the queries alive */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Simulates a new sample of the sensor without the cost of saving it: only the inputs of the guards change.
+ */
+static void _new_sample(uint32_t counts)
+{
+    temp_sensor_thermostat.adc_counts = counts;
+    temp_sensor_thermostat.sample_seq++;
+}
+
+/**
+ * @brief Firing with nothing new: the FSM skips its guards.
+ */
+static void _fire_idle(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        fsm_thermostat_fire(p_fsm);
+    }
+}
+
+/**
+ * @brief Firing with a new sample that does not change the state: the guards are evaluated.
+ */
+static void _fire_evaluate(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        _new_sample(warm_counts);
+        fsm_thermostat_fire(p_fsm);
+    }
+}
+
+/**
+ * @brief Firing with a new sample on the other side of the threshold: every firing makes a transition (LEDs and history).
+ */
+static void _fire_transition(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        _new_sample((i & 1U) ? warm_counts : cold_counts);
+        fsm_thermostat_fire(p_fsm);
+    }
+}
+
+/**
+ * @brief Query of the last time of an event, indexed apart from the history.
+ */
+static void _last_time_event(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        sink = fsm_thermostat_get_last_time_event(p_fsm, (uint8_t)(i & 1U));
+    }
+}
+
+/**
+ * @brief Query of the `BENCH_HISTORY_EVENTS` most recent events of the packed history.
+ */
+static void _history(uint32_t iterations)
+{
+    uint8_t events[BENCH_HISTORY_EVENTS];
+    uint32_t times[BENCH_HISTORY_EVENTS];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        sink = fsm_thermostat_get_history(p_fsm, events, times, BENCH_HISTORY_EVENTS);
+    }
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Runs the benchmarks of the thermostat FSM.
+ *
+ * @param argc Number of arguments.
+ * @param argv The first argument, if any, is the path of the JSON results.
+ * @return int 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    port_system_init();
+    p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    if (p_fsm == NULL)
+    {
+        return 1;
+    }
+
+    // Switch exactly at the threshold, with no minimum dwell time, so that every crossing makes a transition
+    fsm_thermostat_set_hysteresis(p_fsm, 0);
+    fsm_thermostat_set_min_dwell(p_fsm, 0, 0);
+    uint32_t threshold_counts = port_temp_sensor_mcelsius_to_adc_counts(&temp_sensor_thermostat, fsm_thermostat_get_threshold(p_fsm));
+    cold_counts = threshold_counts - 1U;
+    warm_counts = threshold_counts + 1U;
+    _new_sample(warm_counts);
+    fsm_thermostat_fire(p_fsm);
+
+    bench_output_t out;
+    if (bench_begin(&out, (argc > 1) ? argv[1] : NULL, "bench_fsm") != 0)
+    {
+        return 1;
+    }
+    bench_result(&out, "fire_idle", bench_run_ps(_fire_idle, BENCH_ITERATIONS));
+    bench_result(&out, "fire_evaluate", bench_run_ps(_fire_evaluate, BENCH_ITERATIONS));
+    bench_result(&out, "fire_transition", bench_run_ps(_fire_transition, BENCH_ITERATIONS));
+    bench_result(&out, "last_time_event", bench_run_ps(_last_time_event, BENCH_ITERATIONS));
+    bench_result(&out, "history_32_events", bench_run_ps(_history, BENCH_ITERATIONS / 10U));
+    return bench_end(&out);
+}
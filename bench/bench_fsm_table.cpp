@@ -0,0 +1,167 @@
+/**
+ * @file bench_fsm_table.cpp
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Benchmark of the dispatch of an FSM: the library `fsm.h` (table of function pointers walked by `fsm_fire()`) against the compile-time engine of `fsm_table.hpp`, with the same guards and actions.
+ *
+ * Both machines have the transitions of the thermostat, and a ring of 8 states with 2 transitions each shows how the cost of the library grows with the table while the engine jumps to the transitions of the current state.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bench.h"
+extern "C"
+{
+#include <fsm.h>
+}
+#include "fsm_table.hpp"
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_ITERATIONS 1000000U /*!< Operations of each run */
+#define BENCH_RING_STATES 8       /*!< States of the ring */
+
+/* Global variables -----------------------------------------------------------*/
+static uint32_t counts;                /*!< Input of the guards of the thermostat */
+static uint32_t threshold = 1000;      /*!< Threshold of the guards of the thermostat */
+static volatile bool hold = false;     /*!< Input of the guard that keeps the state of the ring */
+static volatile uint32_t transitions;  /*!< Output of the actions */
+static fsm_t fsm;                      /*!< FSM under test */
+
+/* Guards and actions (the same for both dispatchers) -----------------------*/
+static bool _check_heat(fsm_t *p_this) { return counts < threshold; }
+static bool _check_comfort(fsm_t *p_this) { return counts >= threshold; }
+static bool _check_hold(fsm_t *p_this) { return hold; }
+static bool _check_step(fsm_t *p_this) { return true; }
+static void _do_transition(fsm_t *p_this) { transitions = transitions + 1U; }
+
+/* Library tables --------------------------------------------------------------*/
+static fsm_trans_t fsm_trans_thermostat[] = {
+    {0, _check_heat, 1, _do_transition},
+    {1, _check_comfort, 0, _do_transition},
+    {-1, NULL, -1, NULL},
+};
+
+static fsm_trans_t fsm_trans_ring[2 * BENCH_RING_STATES + 1]; /*!< Built in `main()`: a hold and a step transition per state */
+
+/* Engines ---------------------------------------------------------------------*/
+using thermostat_engine_t = fsm_table::engine<fsm_t, 2,
+                                              fsm_table::transition<0, _check_heat, 1, _do_transition>,
+                                              fsm_table::transition<1, _check_comfort, 0, _do_transition>>;
+
+template <int S>
+using hold_t = fsm_table::transition<S, _check_hold, S>; /*!< Transition of the ring that keeps the state */
+template <int S>
+using step_t = fsm_table::transition<S, _check_step, (S + 1) % BENCH_RING_STATES, _do_transition>; /*!< Transition of the ring to the next state */
+
+using ring_engine_t = fsm_table::engine<fsm_t, BENCH_RING_STATES,
+                                        hold_t<0>, step_t<0>, hold_t<1>, step_t<1>, hold_t<2>, step_t<2>, hold_t<3>, step_t<3>,
+                                        hold_t<4>, step_t<4>, hold_t<5>, step_t<5>, hold_t<6>, step_t<6>, hold_t<7>, step_t<7>>;
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Library: the input crosses the threshold at every firing, so every firing makes a transition.
+ */
+static void _library_thermostat_transition(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_thermostat);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        counts = (i & 1U) ? threshold : threshold - 1U;
+        fsm_fire(&fsm);
+    }
+}
+
+/**
+ * @brief Engine: the input crosses the threshold at every firing, so every firing makes a transition.
+ */
+static void _table_thermostat_transition(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_thermostat);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        counts = (i & 1U) ? threshold : threshold - 1U;
+        thermostat_engine_t::fire(&fsm, fsm.current_state);
+    }
+}
+
+/**
+ * @brief Library: the input stays on the same side of the threshold, so only the guards are evaluated.
+ */
+static void _library_thermostat_evaluate(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_thermostat);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        counts = threshold + (i & 1U);
+        fsm_fire(&fsm);
+    }
+}
+
+/**
+ * @brief Engine: the input stays on the same side of the threshold, so only the guards are evaluated.
+ */
+static void _table_thermostat_evaluate(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_thermostat);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        counts = threshold + (i & 1U);
+        thermostat_engine_t::fire(&fsm, fsm.current_state);
+    }
+}
+
+/**
+ * @brief Library: a step around the ring at every firing.
+ */
+static void _library_ring(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_ring);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        fsm_fire(&fsm);
+    }
+}
+
+/**
+ * @brief Engine: a step around the ring at every firing.
+ */
+static void _table_ring(uint32_t iterations)
+{
+    fsm_init(&fsm, fsm_trans_ring);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        ring_engine_t::fire(&fsm, fsm.current_state);
+    }
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Runs the benchmarks of the dispatch of an FSM.
+ *
+ * @param argc Number of arguments.
+ * @param argv The first argument, if any, is the path of the JSON results.
+ * @return int 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    for (int s = 0; s < BENCH_RING_STATES; s++)
+    {
+        fsm_trans_ring[2 * s] = {s, _check_hold, s, NULL};
+        fsm_trans_ring[2 * s + 1] = {s, _check_step, (s + 1) % BENCH_RING_STATES, _do_transition};
+    }
+    fsm_trans_ring[2 * BENCH_RING_STATES] = {-1, NULL, -1, NULL};
+
+    bench_output_t out;
+    if (bench_begin(&out, (argc > 1) ? argv[1] : NULL, "bench_fsm_table") != 0)
+    {
+        return 1;
+    }
+    bench_result(&out, "library_thermostat_evaluate", bench_run_ps(_library_thermostat_evaluate, BENCH_ITERATIONS));
+    bench_result(&out, "table_thermostat_evaluate", bench_run_ps(_table_thermostat_evaluate, BENCH_ITERATIONS));
+    bench_result(&out, "library_thermostat_transition", bench_run_ps(_library_thermostat_transition, BENCH_ITERATIONS));
+    bench_result(&out, "table_thermostat_transition", bench_run_ps(_table_thermostat_transition, BENCH_ITERATIONS));
+    bench_result(&out, "library_8_states", bench_run_ps(_library_ring, BENCH_ITERATIONS));
+    bench_result(&out, "table_8_states", bench_run_ps(_table_ring, BENCH_ITERATIONS));
+    return bench_end(&out);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bench_telemetry.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Benchmark of the output of the thermostat: records of the binary telemetry against the lines of text formatted with `snprintf()` that it replaces.
+ *
+ * The bytes per record of both formats are printed too (they are not costs, so they are not compared with the baseline).
+ *
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bench.h"
+#include "fsm_thermostat.h"
+#include "thermostat_telemetry.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_ITERATIONS 1000000U /*!< Operations of each run */
+
+/* Global variables -----------------------------------------------------------*/
+static char line[64];       /*!< Line of text of the last record */
+static uint64_t text_bytes; /*!< Bytes of the lines of text */
+static uint64_t wire_bytes; /*!< Bytes of the frames of the telemetry */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Output of the telemetry that only counts the bytes, as a transfer to the ITM or to the DMA would cost nothing to the CPU.
+ */
+static void _count(const uint8_t *p_data, uint32_t length)
+{
+    (void)p_data;
+    wire_bytes += length;
+}
+
+/**
+ * @brief Temperature of a sensor sampled every second that drifts slowly.
+ */
+static inline int32_t _mcelsius(uint32_t i)
+{
+    return 21000 + (int32_t)((i * 7U) % 100U) - 50;
+}
+
+/**
+ * @brief A temperature sample as a line of text, as the log printed it.
+ */
+static void _text_sample(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        int32_t mcelsius = _mcelsius(i);
+        int n = snprintf(line, sizeof(line), "[%" PRIu32 " ms] Temperature: %" PRId32 ".%" PRId32 " oC\n", 1000U * i, mcelsius / 1000, (mcelsius % 1000) / 100);
+        text_bytes += (uint32_t)n;
+    }
+}
+
+/**
+ * @brief A temperature sample as a record of the telemetry, frames included.
+ */
+static void _telemetry_sample(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        thermostat_telemetry_sample(0, 1000U * i, _mcelsius(i));
+    }
+    thermostat_telemetry_flush();
+}
+
+/**
+ * @brief A transition as a line of text, as `main.c` printed it.
+ */
+static void _text_transition(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        int n = snprintf(line, sizeof(line), "Thermostat %s at %" PRIu32 "\n", (i & 1U) ? "OFF" : "ON", 60000U * i);
+        text_bytes += (uint32_t)n;
+    }
+}
+
+/**
+ * @brief A transition as a record of the telemetry, sent at once as `main.c` does.
+ */
+static void _telemetry_transition(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        thermostat_telemetry_transition(0, (i & 1U) ? DEACTIVATION : ACTIVATION, 60000U * i);
+        thermostat_telemetry_flush();
+    }
+}
+
+/**
+ * @brief Prints the bytes per record of both formats of a benchmark, in hundredths of byte.
+ */
+static void _print_bytes(const char *p_key, bench_fn_t text, bench_fn_t telemetry)
+{
+    text_bytes = 0;
+    wire_bytes = 0;
+    text(BENCH_ITERATIONS);
+    telemetry(BENCH_ITERATIONS);
+    uint64_t text_centibytes = (text_bytes * 100U) / BENCH_ITERATIONS;
+    uint64_t wire_centibytes = (wire_bytes * 100U) / BENCH_ITERATIONS;
+    printf("%s: %" PRIu64 ".%02" PRIu64 " bytes/record as text, %" PRIu64 ".%02" PRIu64 " bytes/record as telemetry\n", p_key, text_centibytes / 100U, text_centibytes % 100U, wire_centibytes / 100U, wire_centibytes % 100U);
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Runs the benchmarks of the telemetry.
+ *
+ * @param argc Number of arguments.
+ * @param argv The first argument, if any, is the path of the JSON results.
+ * @return int 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    thermostat_telemetry_init(_count);
+
+    bench_output_t out;
+    if (bench_begin(&out, (argc > 1) ? argv[1] : NULL, "bench_telemetry") != 0)
+    {
+        return 1;
+    }
+    bench_result(&out, "text_sample", bench_run_ps(_text_sample, BENCH_ITERATIONS));
+    bench_result(&out, "telemetry_sample", bench_run_ps(_telemetry_sample, BENCH_ITERATIONS));
+    bench_result(&out, "text_transition", bench_run_ps(_text_transition, BENCH_ITERATIONS));
+    bench_result(&out, "telemetry_transition", bench_run_ps(_telemetry_transition, BENCH_ITERATIONS));
+    int result = bench_end(&out);
+
+    _print_bytes("sample", _text_sample, _telemetry_sample);
+    _print_bytes("transition", _text_transition, _telemetry_transition);
+    return result;
+}
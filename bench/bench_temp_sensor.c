@@ -0,0 +1,127 @@
+/**
+ * @file bench_temp_sensor.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Benchmark of the pipeline of the temperature sensor: filtering and saving of the measurements and conversion to temperature.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bench.h"
+#include "port_system.h"
+#include "port_temp_sensor.h"
+#include "thermostat_log.h"
+#include "thermostat_filter.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_ITERATIONS 1000000U /*!< Operations of each run */
+
+/* Global variables -----------------------------------------------------------*/
+static volatile int32_t sink; /*!< Keeps the results of the conversions alive */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Saving of a decimated measurement, as the ISR of the DMA does. The record of the log is popped so that the ring never drops it.
+ */
+static void _save_adc_value(uint32_t iterations)
+{
+    thermostat_log_record_t record;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        port_temp_sensor_save_adc_value(&temp_sensor_thermostat, i & 0x3FFFU);
+        thermostat_log_pop(&record);
+    }
+}
+
+/**
+ * @brief Decimation and saving of a sequence of conversions of the scan of one sensor: the whole work of the ISR of the DMA.
+ */
+static void _save_adc_samples(uint32_t iterations)
+{
+    thermostat_log_record_t record;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        temp_sensor_scan.adc_buffer[i % TEMP_SENSOR_OVERSAMPLING] = (uint16_t)(i & 0xFFFU);
+        port_temp_sensor_scan_save_samples(&temp_sensor_scan, temp_sensor_scan.adc_buffer);
+        thermostat_log_pop(&record);
+    }
+}
+
+static thermostat_filter_t filter; /*!< Filter of the benchmarks of the filters */
+
+/**
+ * @brief Update of the filter with a new measurement, as the ISR of the DMA does before saving it.
+ */
+static void _filter_update(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        sink = (int32_t)thermostat_filter_update(&filter, (i * 2654435761U) >> 18);
+    }
+}
+
+/**
+ * @brief Update of an EMA with alpha = 1/16.
+ */
+static void _filter_ema(uint32_t iterations)
+{
+    thermostat_filter_init_ema(&filter, 4);
+    _filter_update(iterations);
+}
+
+/**
+ * @brief Update of a moving average of 16 samples.
+ */
+static void _filter_moving_average(uint32_t iterations)
+{
+    thermostat_filter_init_moving_average(&filter, 4);
+    _filter_update(iterations);
+}
+
+/**
+ * @brief Update of a running median of 15 samples, the widest one, with measurements in random order.
+ */
+static void _filter_median(uint32_t iterations)
+{
+    thermostat_filter_init_median(&filter, THERMOSTAT_FILTER_MAX_WINDOW - 1U);
+    _filter_update(iterations);
+}
+
+/**
+ * @brief Conversion of the last measurement to milli-degrees Celsius.
+ */
+static void _get_temperature(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        temp_sensor_thermostat.adc_counts = i & 0x3FFFU;
+        sink = port_temp_sensor_get_temperature_mcelsius(&temp_sensor_thermostat);
+    }
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Runs the benchmarks of the temperature sensor.
+ *
+ * @param argc Number of arguments.
+ * @param argv The first argument, if any, is the path of the JSON results.
+ * @return int 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    port_system_init();
+    port_temp_sensor_init(&temp_sensor_thermostat);
+
+    bench_output_t out;
+    if (bench_begin(&out, (argc > 1) ? argv[1] : NULL, "bench_temp_sensor") != 0)
+    {
+        return 1;
+    }
+    bench_result(&out, "save_adc_value", bench_run_ps(_save_adc_value, BENCH_ITERATIONS));
+    bench_result(&out, "save_adc_samples", bench_run_ps(_save_adc_samples, BENCH_ITERATIONS));
+    bench_result(&out, "get_temperature", bench_run_ps(_get_temperature, BENCH_ITERATIONS));
+    bench_result(&out, "filter_ema", bench_run_ps(_filter_ema, BENCH_ITERATIONS));
+    bench_result(&out, "filter_moving_average", bench_run_ps(_filter_moving_average, BENCH_ITERATIONS));
+    bench_result(&out, "filter_median", bench_run_ps(_filter_median, BENCH_ITERATIONS));
+    return bench_end(&out);
+}
@@ -0,0 +1,49 @@
+# Compares the results of a benchmark with its baseline. Usage:
+#   cmake -DRESULTS=<results.json> -DBASELINE=<baseline.json> [-DTOLERANCE_PERCENT=<percent>] -P compare_baseline.cmake
+# The results are costs (lower is better). A result that exceeds its baseline by more than TOLERANCE_PERCENT is an error.
+IF(NOT DEFINED TOLERANCE_PERCENT)
+    SET(TOLERANCE_PERCENT 50)
+ENDIF()
+
+FILE(READ ${RESULTS} RESULTS_JSON)
+STRING(JSON BENCH_NAME GET ${RESULTS_JSON} benchmark)
+IF(NOT EXISTS ${BASELINE})
+    MESSAGE(WARNING "${BENCH_NAME}: no baseline (${BASELINE}), nothing to compare")
+    RETURN()
+ENDIF()
+FILE(READ ${BASELINE} BASELINE_JSON)
+
+# Only results of the same build type are comparable
+STRING(JSON RESULTS_BUILD_TYPE GET ${RESULTS_JSON} build_type)
+STRING(JSON BASELINE_BUILD_TYPE GET ${BASELINE_JSON} build_type)
+IF(NOT RESULTS_BUILD_TYPE STREQUAL BASELINE_BUILD_TYPE)
+    MESSAGE(WARNING "${BENCH_NAME}: the baseline is of a ${BASELINE_BUILD_TYPE} build and the results of a ${RESULTS_BUILD_TYPE} build, nothing to compare")
+    RETURN()
+ENDIF()
+
+STRING(JSON UNIT GET ${RESULTS_JSON} unit)
+STRING(JSON N_BASELINE LENGTH ${BASELINE_JSON} results)
+MATH(EXPR LAST "${N_BASELINE} - 1")
+SET(REGRESSIONS 0)
+FOREACH(I RANGE ${LAST})
+    STRING(JSON KEY MEMBER ${BASELINE_JSON} results ${I})
+    STRING(JSON EXPECTED GET ${BASELINE_JSON} results ${KEY})
+    STRING(JSON ACTUAL ERROR_VARIABLE MISSING GET ${RESULTS_JSON} results ${KEY})
+    IF(MISSING)
+        MESSAGE(SEND_ERROR "${BENCH_NAME}.${KEY}: missing in the results")
+        MATH(EXPR REGRESSIONS "${REGRESSIONS} + 1")
+        CONTINUE()
+    ENDIF()
+
+    MATH(EXPR LIMIT "${EXPECTED} + (${EXPECTED} * ${TOLERANCE_PERCENT}) / 100")
+    IF(ACTUAL GREATER LIMIT)
+        MESSAGE(SEND_ERROR "${BENCH_NAME}.${KEY}: ${ACTUAL} ${UNIT} > ${LIMIT} ${UNIT} (baseline ${EXPECTED} ${UNIT} + ${TOLERANCE_PERCENT} %)")
+        MATH(EXPR REGRESSIONS "${REGRESSIONS} + 1")
+    ELSE()
+        MESSAGE(STATUS "${BENCH_NAME}.${KEY}: ${ACTUAL} ${UNIT} (baseline ${EXPECTED} ${UNIT})")
+    ENDIF()
+ENDFOREACH()
+
+IF(REGRESSIONS GREATER 0)
+    MESSAGE(FATAL_ERROR "${BENCH_NAME}: ${REGRESSIONS} performance regressions")
+ENDIF()
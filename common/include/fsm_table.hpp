@@ -0,0 +1,124 @@
+/**
+ * @file fsm_table.hpp
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header-only FSM engine whose transitions are resolved at compile time (C++17).
+ *
+ * The states, guards and actions of the transitions are template parameters, instead of the rows of a table of function pointers in RAM walked by `fsm_fire()`:
+ * - The dispatch jumps straight to the transitions of the current state through a `constexpr` table of handlers, one per state, which the compiler places in flash. The rows of the other states are never visited.
+ * - Each handler calls its guards and actions directly, not through pointers, so the compiler can inline them when their definitions are visible (same translation unit, or link-time optimization).
+ * - The states of the transitions are checked at compile time.
+ *
+ * The semantics are the ones of `fsm_fire()`: the transitions of a state are evaluated in the order of the table, the first one whose guard is true fires, and the state is updated before its action runs.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef FSM_TABLE_HPP
+#define FSM_TABLE_HPP
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C++ includes */
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace fsm_table
+{
+    /**
+     * @brief Transition of an FSM.
+     *
+     * @tparam From Origin state.
+     * @tparam Guard Input function, `bool guard(Machine *)`.
+     * @tparam To Destination state.
+     * @tparam Action Output function, `void action(Machine *)`, or `nullptr` for none.
+     */
+    template <int From, auto Guard, int To, auto Action = nullptr>
+    struct transition
+    {
+        static constexpr int from = From; /*!< Origin state */
+        static constexpr int to = To;     /*!< Destination state */
+
+        /**
+         * @brief Fires the transition if its guard is true.
+         *
+         * @param p_this Pointer to the FSM.
+         * @param state Current state of the FSM. It is set to `To` before the action runs.
+         * @return true if the transition has fired, false otherwise.
+         */
+        template <typename Machine>
+        static inline bool try_fire(Machine *p_this, int &state)
+        {
+            if (!Guard(p_this))
+            {
+                return false;
+            }
+            state = To;
+            if constexpr (!std::is_null_pointer_v<decltype(Action)>)
+            {
+                Action(p_this);
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief FSM engine.
+     *
+     * @tparam Machine Type of the FSM passed to the guards and the actions.
+     * @tparam NumStates Number of states. The states are numbered from 0.
+     * @tparam Transitions Transitions of the FSM (see `transition`), in order of priority.
+     */
+    template <typename Machine, int NumStates, typename... Transitions>
+    class engine
+    {
+        static_assert(NumStates > 0, "An FSM has at least one state");
+        static_assert(((Transitions::from >= 0 && Transitions::from < NumStates) && ...), "The origin state of a transition is out of range");
+        static_assert(((Transitions::to >= 0 && Transitions::to < NumStates) && ...), "The destination state of a transition is out of range");
+
+        using handler_t = bool (*)(Machine *, int &); /*!< Handler of the transitions of a state */
+
+        /**
+         * @brief Handler of the transitions of a state. The transitions of the other states are constant false in the fold, so they are removed at compile time.
+         */
+        template <int State>
+        static bool fire_state(Machine *p_this, int &state)
+        {
+            return ((Transitions::from == State && Transitions::template try_fire<Machine>(p_this, state)) || ...);
+        }
+
+        /**
+         * @brief Builds the jump table: the handler of each state, indexed by the state.
+         */
+        template <int... States>
+        static constexpr std::array<handler_t, NumStates> make_handlers(std::integer_sequence<int, States...>)
+        {
+            return {{&fire_state<States>...}};
+        }
+
+        static constexpr std::array<handler_t, NumStates> handlers = make_handlers(std::make_integer_sequence<int, NumStates>{}); /*!< Jump table of the states. It is `constexpr`, so it lives in flash */
+
+    public:
+        static constexpr int num_states = NumStates;                          /*!< Number of states */
+        static constexpr std::size_t num_transitions = sizeof...(Transitions); /*!< Number of transitions */
+
+        /**
+         * @brief Evaluates the transitions of the current state and fires the first one whose guard is true.
+         *
+         * @param p_this Pointer to the FSM.
+         * @param state Current state of the FSM. It is updated if a transition fires. A state out of range has no transitions.
+         * @return true if a transition has fired, false otherwise.
+         */
+        static inline bool fire(Machine *p_this, int &state)
+        {
+            if (static_cast<unsigned>(state) >= static_cast<unsigned>(NumStates))
+            {
+                return false;
+            }
+            return handlers[static_cast<std::size_t>(state)](p_this, state);
+        }
+    };
+} // namespace fsm_table
+
+#endif /* FSM_TABLE_HPP */
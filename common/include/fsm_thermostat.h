@@ -17,12 +17,33 @@
 #include <fsm.h>
 #include "port_led.h"
 #include "port_temp_sensor.h"
+#include "thermostat_config.h"
 
 /* Defines and enums ----------------------------------------------------------*/
 /* Defines */
-#define THERMOSTAT_TIMEOUT_SEC 1        /*!< Timeout for the thermostat to be activated */
-#define THERMOSTAT_HISTORY 10           /*!< Number of events to store in the thermostat */
-#define THERMOSTAT_DEFAULT_THRESHOLD 25 /*!< Threshold temperature to activate the thermostat */
+#ifndef THERMOSTAT_DEFAULT_PERIOD_MS
+#define THERMOSTAT_DEFAULT_PERIOD_MS 1000 /*!< Default period of the measurements of the temperature in milliseconds. Its timer configuration is computed at compile time */
+#endif
+#define THERMOSTAT_DEFAULT_THRESHOLD_MCELSIUS 25000 /*!< Threshold temperature to activate the thermostat in milli-degrees Celsius */
+#ifndef THERMOSTAT_DEFAULT_HYSTERESIS_MCELSIUS
+#define THERMOSTAT_DEFAULT_HYSTERESIS_MCELSIUS 500 /*!< Width of the band around the threshold where the thermostat keeps its state, in milli-degrees Celsius */
+#endif
+#ifndef THERMOSTAT_DEFAULT_MIN_ON_MS
+#define THERMOSTAT_DEFAULT_MIN_ON_MS 0 /*!< Minimum time the thermostat stays on before it can be deactivated, in milliseconds */
+#endif
+#ifndef THERMOSTAT_DEFAULT_MIN_OFF_MS
+#define THERMOSTAT_DEFAULT_MIN_OFF_MS 0 /*!< Minimum time the thermostat stays off before it can be activated again, in milliseconds */
+#endif
+#ifndef THERMOSTAT_HISTORY
+#define THERMOSTAT_HISTORY 50 /*!< Size in bytes of the packed event history of each thermostat. Each event takes 1 to 5 bytes (2 or 3 for events from seconds to hours apart) */
+#endif
+#ifndef THERMOSTAT_HISTORY_RESOLUTION_MS
+#define THERMOSTAT_HISTORY_RESOLUTION_MS 100 /*!< Resolution of the timestamps of the event history. The last time of each event is always kept with 1 ms resolution */
+#endif
+#define THERMOSTAT_NUM_EVENTS 2 /*!< Number of events of the thermostat (see `THERMOSTAT_EVENTS`) */
+#ifndef THERMOSTAT_POOL_SIZE
+#define THERMOSTAT_POOL_SIZE 4 /*!< Maximum number of thermostats (zones). Instances are taken from a static pool, no heap is used */
+#endif
 
 /* Enums */
 /**
@@ -47,46 +68,230 @@ enum THERMOSTAT_EVENTS
 };
 
 /* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Counters of the transitions of a thermostat and of the transitions it has suppressed.
+ *
+ * A transition is suppressed at each evaluation of the guards in which the exact threshold would have changed the state: inside the hysteresis band, or before the minimum dwell time in the current state has elapsed.
+ */
+typedef struct
+{
+    uint32_t transitions;              /*!< Number of transitions of the thermostat */
+    uint32_t suppressed_by_hysteresis; /*!< Number of evaluations in which the temperature had crossed the threshold but not the hysteresis band */
+    uint32_t suppressed_by_dwell;      /*!< Number of evaluations in which the temperature had crossed the hysteresis band before the minimum dwell time */
+} fsm_thermostat_stats_t;
+
 /**
  * @brief Structure to define the thermostat FSM.
+ *
+ * Only the fields used at every firing (hot fields) are kept here, so that the pool of thermostats is compact and `fsm_thermostat_fire_all()` walks it in a single cache-friendly pass. The event history, the counters of transitions and the settings (threshold and hysteresis in milli-degrees Celsius and dwell times) are cold fields, kept in parallel arrays indexed by `zone`. The period and the low-power mode belong to the scan of the sensors, so they are shared by all the thermostats.
  */
 typedef struct
 {
-    fsm_t f;                                       /*!< FSM structure. Important to be the first element of the structure */
-    port_led_hw_t *p_led_heat;                     /*!< Pointer to the heat LED structure */
-    port_led_hw_t *p_led_comfort;                  /*!< Pointer to the cool LED structure */
-    port_temp_hw_t *p_temp_sensor;                 /*!< Pointer to the temperature sensor structure */
-    bool last_events[THERMOSTAT_HISTORY];          /*!< Statuses of the thermostat */
-    uint32_t last_time_events[THERMOSTAT_HISTORY]; /*!< Last times of events detected */
-    uint8_t event_idx;                             /*!< Index of the last event */
-    double threshold_temp_celsius;                 /*!< Threshold temperature to activate the thermostat Celsius */
-    uint32_t timer_period_sec;                     /*!< Period of the timer to measure the temperature */
+    fsm_t f;                            /*!< FSM structure. Important to be the first element of the structure */
+    uint32_t threshold_adc_counts;      /*!< Threshold temperature to activate the thermostat, in raw counts of the ADC of the sensor */
+    uint32_t heat_adc_counts;           /*!< The thermostat is activated below this measurement: lower limit of the hysteresis band in raw counts of the ADC of the sensor */
+    uint32_t comfort_adc_counts;        /*!< The thermostat is deactivated from this measurement: upper limit of the hysteresis band in raw counts of the ADC of the sensor */
+    uint32_t state_since_ms;            /*!< Time of the last transition in milliseconds */
+    port_temp_hw_t *p_temp_sensor;      /*!< Pointer to the temperature sensor structure */
+    const port_led_hw_t *p_led_heat;    /*!< Pointer to the heat LED structure */
+    const port_led_hw_t *p_led_comfort; /*!< Pointer to the cool LED structure */
+    uint32_t last_sample_seq;           /*!< Sequence number of the last sample of the sensor evaluated by the guards */
+    bool inputs_changed;                /*!< An input of the guards other than the temperature (e.g., the threshold) has changed since the last evaluation */
+    bool adc_watchdog;                  /*!< The sensor is only measured when the temperature crosses the threshold (analog watchdog of the ADC) */
+    uint8_t zone;                       /*!< Index of the thermostat in the pool */
 } fsm_thermostat_t;
 
 /* Function prototypes and explanations ---------------------------------------*/
 /**
  * @brief Creates a new thermostat FSM.
  *
+ * The thermostat is taken from a static pool of `THERMOSTAT_POOL_SIZE` instances. No heap is used.
+ *
  * @param p_led_heat Pointer to the LED of the thermostat.
  * @param p_led_comfort Pointer to the comfort LED of the thermostat.
  * @param p_temp Pointer to the temperature sensor of the thermostat.
- * @return fsm_thermostat_t* Pointer to the new thermostat FSM.
+ * @return fsm_thermostat_t* Pointer to the new thermostat FSM, or NULL if the pool is exhausted.
+ */
+fsm_t *fsm_thermostat_new(const port_led_hw_t *p_led_heat, const port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp);
+
+/**
+ * @brief Returns a thermostat FSM to the pool.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ */
+void fsm_thermostat_destroy(fsm_t *p_this);
+
+/**
+ * @brief Fires the thermostat FSM only if an input of its guards has changed.
+ *
+ * The guards depend on the temperature and on the threshold. The temperature only changes when the sensor saves a new sample, so the FSM is fired only if the sequence number of the samples has changed or the threshold has been updated since the last evaluation.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @return true if the guards were evaluated, false if there was nothing new to evaluate.
+ */
+bool fsm_thermostat_fire(fsm_t *p_this);
+
+/**
+ * @brief Fires all the thermostat FSMs of the pool with new inputs in a single pass. See `fsm_thermostat_fire()`.
+ *
+ * @return uint8_t Number of thermostats whose guards were evaluated.
+ */
+uint8_t fsm_thermostat_fire_all(void);
+
+/**
+ * @brief Sets the threshold temperature of the thermostat. The guards are evaluated again at the next firing.
+ *
+ * The threshold is converted once into raw counts of the ADC of the sensor, so that the guards compare integers without converting each sample.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param threshold_mcelsius New threshold temperature in milli-degrees Celsius.
+ */
+void fsm_thermostat_set_threshold(fsm_t *p_this, int32_t threshold_mcelsius);
+
+/**
+ * @brief Sets the period of the measurements of the temperature of the thermostat.
+ *
+ * The timer is reconfigured at runtime with integer arithmetic only. On the target, the new period starts at the next update event of the timer.
+ *
+ * @note The measurement timer is shared by all the thermostats: the period applies to all of them, and it is kept when other thermostats are created.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param period_ms New period in milliseconds, from 1 to `THERMOSTAT_PERIOD_MAX_MS`.
+ * @return true if the period has been applied, false if it is out of range (the current period is kept).
+ */
+bool fsm_thermostat_set_period(fsm_t *p_this, uint32_t period_ms);
+
+/**
+ * @brief Enables or disables the low-power mode of the thermostat.
+ *
+ * In low-power mode, the wake-up timer of the RTC replaces the measurement timer as the trigger of the measurements, and the core enters STOP mode between them. See `port_system_get_power_stats()` for the time spent asleep and awake.
+ *
+ * @note The mode is global: the measurement timer, the RTC and the STOP mode are shared by all the thermostats, and the thermostats created later join the mode as it is.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param enable true to enable the low-power mode, false to go back to the measurement timer.
  */
-fsm_t *fsm_thermostat_new(port_led_hw_t *p_led_heat, port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp);
+void fsm_thermostat_set_low_power(fsm_t *p_this, bool enable);
+
+/**
+ * @brief Gets the period of the measurements of the temperature of the thermostat, which is the one of all the thermostats.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @return uint32_t Period in milliseconds.
+ */
+uint32_t fsm_thermostat_get_period(fsm_t *p_this);
+
+/**
+ * @brief Sets the hysteresis of the thermostat. The guards are evaluated again at the next firing.
+ *
+ * The thermostat is activated when the temperature falls below the threshold minus half the hysteresis, and it is deactivated when the temperature reaches the threshold plus half the hysteresis. Inside the band the state is kept, so the noise of the sensor around the threshold does not make the thermostat flip at every sample.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param hysteresis_mcelsius Width of the band in milli-degrees Celsius. 0 to switch exactly at the threshold.
+ */
+void fsm_thermostat_set_hysteresis(fsm_t *p_this, uint32_t hysteresis_mcelsius);
+
+/**
+ * @brief Sets the minimum dwell times of the thermostat in each state.
+ *
+ * A transition is not made until the thermostat has been in its current state for the minimum time, whatever the temperature. This bounds the rate of transitions, and of the work they cause (LEDs, history, logs), to one per minimum dwell time. The first activation is not delayed.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param min_on_ms Minimum time in the `THERMOSTAT_ON` state in milliseconds.
+ * @param min_off_ms Minimum time in the `THERMOSTAT_OFF` state in milliseconds.
+ */
+void fsm_thermostat_set_min_dwell(fsm_t *p_this, uint32_t min_on_ms, uint32_t min_off_ms);
+
+/**
+ * @brief Gets the counters of transitions and suppressed transitions of the thermostat.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param p_stats Pointer to the structure to store the counters.
+ */
+void fsm_thermostat_get_stats(fsm_t *p_this, fsm_thermostat_stats_t *p_stats);
+
+/**
+ * @brief Enables or disables the analog watchdog mode of the thermostat.
+ *
+ * In analog watchdog mode, after each evaluation of the guards the hysteresis band is programmed as the window of the analog watchdog of the ADC of the sensor, on the side of the current state: while heating, the watchdog triggers when the temperature reaches the upper limit of the band; otherwise, when it falls below the lower limit. The samples inside the window do not interrupt the CPU, so the thermostat only wakes up around the crossings of the threshold.
+ *
+ * @warning The analog watchdog belongs to the ADC: the thermostat must be the only user of its sensor.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param enable true to enable the analog watchdog mode, false to measure every sample.
+ */
+void fsm_thermostat_set_adc_watchdog(fsm_t *p_this, bool enable);
+
+/**
+ * @brief Gets the threshold temperature of the thermostat.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @return int32_t Threshold temperature in milli-degrees Celsius.
+ */
+int32_t fsm_thermostat_get_threshold(fsm_t *p_this);
+
+/**
+ * @brief Gets the settings of the thermostat that are kept across resets, e.g., to save them with `thermostat_config_save()`.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param p_config Pointer to store the settings.
+ */
+void fsm_thermostat_get_config(fsm_t *p_this, thermostat_config_t *p_config);
+
+/**
+ * @brief Applies settings to the thermostat, e.g., the ones restored at boot with `thermostat_config_load()`. The guards are evaluated again at the next firing.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param p_config Pointer to the settings.
+ * @return true if the settings have been applied, false if the period is out of range (nothing is applied).
+ */
+bool fsm_thermostat_set_config(fsm_t *p_this, const thermostat_config_t *p_config);
+
+/**
+ * @brief Gets the number of thermostat FSMs in use.
+ *
+ * @return uint8_t Number of thermostats taken from the pool.
+ */
+uint8_t fsm_thermostat_get_count(void);
 
 /**
  * @brief Gets the last time there was an event in the thermostat. If the event is not found, it returns 0.
  *
+ * The last time of each event is indexed apart from the history, so this query takes constant time.
+ *
  * @param p_this Pointer to the thermostat FSM structure.
  * @param event Event to check. It can be any of the events in the THERMOSTAT_EVENTS enum.
  */
 uint32_t fsm_thermostat_get_last_time_event(fsm_t *p_this, uint8_t event);
 
 /**
- * @brief Gets the thermostat status.
+ * @brief Gets the thermostat status, i.e., the last event of the thermostat, or `UNKNOWN` if there was none.
  *
  * @param p_this Pointer to the thermostat FSM structure.
  */
 uint8_t fsm_thermostat_get_status(fsm_t *p_this);
 
+/**
+ * @brief Gets the event history of the thermostat, from the most recent event to the oldest one.
+ *
+ * The history is stored packed: each event is a bit and the time since the previous event is a variable-length delta with a resolution of `THERMOSTAT_HISTORY_RESOLUTION_MS`. The oldest events are overwritten when the `THERMOSTAT_HISTORY` bytes are full.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @param p_events Array to store the events. It can be NULL.
+ * @param p_times Array to store the times of the events in milliseconds. It can be NULL.
+ * @param max_events Maximum number of events to read.
+ * @return uint8_t Number of events read.
+ */
+uint8_t fsm_thermostat_get_history(fsm_t *p_this, uint8_t *p_events, uint32_t *p_times, uint8_t max_events);
+
+#ifdef USE_FSM_TABLE
+/**
+ * @brief Fires the thermostat FSM with the engine of `fsm_table.hpp` instead of `fsm_fire()`: the transitions of the current state are reached through a jump table in flash, and their guards and actions are called directly. It is used by `fsm_thermostat_fire()` when `USE_FSM_TABLE` is set.
+ *
+ * @param p_this Pointer to the thermostat FSM structure.
+ * @return int 1 if a transition has fired, 0 otherwise (as `fsm_fire()`).
+ */
+int fsm_thermostat_table_fire(fsm_t *p_this);
+#endif
+
 #endif /* FSM_THERMOSTAT_H */
\ No newline at end of file
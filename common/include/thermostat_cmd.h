@@ -0,0 +1,56 @@
+/**
+ * @file thermostat_cmd.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the command interface of the thermostat over the UART.
+ *
+ * The host sends text commands, one per line (ended by `\n` or `\r`), and the replies of all the commands of a burst are sent back in one transfer of the DMA. Each reply ends with a line `ok` or `error`:
+ *
+ * | Command               | Reply before `ok`                                                          |
+ * |-----------------------|----------------------------------------------------------------------------|
+ * | `threshold <m°C>`     | None. Sets the threshold temperature in milli-degrees Celsius              |
+ * | `period <ms>`         | None. Sets the period of the measurements in ms (1 to `THERMOSTAT_PERIOD_MAX_MS`) |
+ * | `status`              | `state=<on\|off> temperature=<m°C> threshold=<m°C> period=<ms> transitions=<n>` |
+ * | `history`             | One line `<ms> <on\|off>` per event of the history, from the newest one     |
+ * | `save`                | None. Stores the configuration in flash (`thermostat_config_save()`)       |
+ *
+ * The commands are parsed in place in the circular buffer of reception of the UART, with no copy. While a reply is being sent, the new commands wait in that buffer, so the host must wait for the replies of a burst before sending more than `PORT_UART_RX_SIZE` bytes.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_CMD_H
+#define THERMOSTAT_CMD_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+
+/* Other includes */
+#include "fsm_thermostat.h"
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#ifndef THERMOSTAT_CMD_TX_SIZE
+#define THERMOSTAT_CMD_TX_SIZE 1024U /*!< Size in bytes of the buffer of the replies. It must hold the longest reply: the dump of a full history */
+#endif
+#define THERMOSTAT_CMD_MAX_LINE 64U /*!< Maximum length of a command line. The bytes of a longer line without end are discarded */
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Initializes the UART and the command interface. The commands act on one thermostat.
+ *
+ * @param p_fsm Pointer to the thermostat FSM controlled by the commands.
+ */
+void thermostat_cmd_init(fsm_t *p_fsm);
+
+/**
+ * @brief Executes the commands received since the last call and starts the transmission of their replies. To be called from the main loop when `PORT_SYSTEM_EVENT_UART` is posted.
+ *
+ * It never blocks: if the replies of the previous commands are still being sent, nothing is done until the end of the transfer (which posts `PORT_SYSTEM_EVENT_UART` again). An incomplete line is kept for the next call.
+ *
+ * @return uint32_t Number of commands executed (including the wrong ones).
+ */
+uint32_t thermostat_cmd_process(void);
+
+#endif /* THERMOSTAT_CMD_H */
@@ -0,0 +1,86 @@
+/**
+ * @file thermostat_config.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the persistent configuration of the thermostat.
+ *
+ * The configuration is stored in a dedicated sector of flash as a log: each update appends a record of fixed size after the previous one, and the sector is only erased when it is full. Each erase thus takes `PORT_FLASH_SECTOR_SIZE` / `THERMOSTAT_CONFIG_RECORD_BYTES` updates (4096 in the STM32F446RE), and an update that does not change the configuration is not written at all.
+ *
+ * A record is written in order from its first word, which is never erased once programmed, so the used records are always a prefix of the sector. At boot, the end of the log is found with a binary search over the first word of the records, and only the last records are checked: the newest valid one is the configuration. A record is valid if its header and its CRC-32 are correct, so a record cut by a reset in the middle of its write is skipped. The boot reads about log2(records of the sector) + `THERMOSTAT_CONFIG_MAX_BACKTRACK` records, whatever the number of updates.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_CONFIG_H
+#define THERMOSTAT_CONFIG_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#define THERMOSTAT_CONFIG_VERSION 1U                                         /*!< Version of the layout of `thermostat_config_t`. Records of other versions are ignored */
+#define THERMOSTAT_CONFIG_RECORD_WORDS 8U                                    /*!< Words of a record: header, sequence number, configuration and CRC-32 */
+#define THERMOSTAT_CONFIG_RECORD_BYTES (THERMOSTAT_CONFIG_RECORD_WORDS * 4U) /*!< Bytes of a record */
+#define THERMOSTAT_CONFIG_HEADER ((0xC0F6U << 16) | (THERMOSTAT_CONFIG_VERSION << 8) | THERMOSTAT_CONFIG_RECORD_WORDS) /*!< First word of a record: magic, version and words of the record. It is never `PORT_FLASH_ERASED_WORD` */
+#ifndef THERMOSTAT_CONFIG_MAX_BACKTRACK
+#define THERMOSTAT_CONFIG_MAX_BACKTRACK 4U /*!< Records checked back from the end of the log at boot. Only a write cut by a reset leaves an invalid record, so this tolerates several resets in a row during updates */
+#endif
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Persistent configuration of a thermostat. It is stored as it is in the records, so any change of its layout must increment `THERMOSTAT_CONFIG_VERSION`.
+ */
+typedef struct
+{
+    int32_t threshold_mcelsius;   /*!< Threshold temperature to activate the thermostat in milli-degrees Celsius */
+    uint32_t period_ms;           /*!< Period of the measurements in milliseconds */
+    uint32_t hysteresis_mcelsius; /*!< Width of the hysteresis band centered on the threshold in milli-degrees Celsius */
+    uint32_t min_on_ms;           /*!< Minimum time in the `THERMOSTAT_ON` state in milliseconds */
+    uint32_t min_off_ms;          /*!< Minimum time in the `THERMOSTAT_OFF` state in milliseconds */
+} thermostat_config_t;
+
+/**
+ * @brief State of the log of the configuration.
+ */
+typedef struct
+{
+    uint32_t slots;      /*!< Records that fit in the sector */
+    uint32_t used_slots; /*!< Records written since the last erase, including the invalid ones */
+    uint32_t seq;        /*!< Sequence number of the newest valid record, or 0 if there is none */
+    uint32_t erases;     /*!< Erases of the sector since the boot */
+} thermostat_config_stats_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Finds the newest valid configuration in the flash. To be called once at boot, before `thermostat_config_load()` and `thermostat_config_save()`.
+ *
+ */
+void thermostat_config_init(void);
+
+/**
+ * @brief Gets the newest valid configuration found at boot or saved since then. It does not read the flash.
+ *
+ * @param p_config Pointer to store the configuration.
+ * @return true if there is a stored configuration, false otherwise (e.g., first boot): `p_config` is not modified.
+ */
+bool thermostat_config_load(thermostat_config_t *p_config);
+
+/**
+ * @brief Saves a configuration: a new record is appended to the log. The sector is erased first if it is full. Nothing is written if the configuration is the same as the stored one.
+ *
+ * @param p_config Pointer to the configuration.
+ * @return true if the configuration is stored, false if the flash could not be programmed (the record is skipped at boot).
+ */
+bool thermostat_config_save(const thermostat_config_t *p_config);
+
+/**
+ * @brief Gets the state of the log of the configuration.
+ *
+ * @param p_stats Pointer to store the state.
+ */
+void thermostat_config_get_stats(thermostat_config_stats_t *p_stats);
+
+#endif /* THERMOSTAT_CONFIG_H */
@@ -0,0 +1,103 @@
+/**
+ * @file thermostat_filter.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the filters of the measurements of the temperature sensors.
+ *
+ * A filter sits between the ADC and the FSM: the port of the sensor passes each new measurement through it, in the ISR of the DMA, before the thermostats see it. All the filters work on raw counts of the ADC with integer arithmetic only (no division, no floating point), and take a bounded time per sample:
+ * - Exponential moving average (EMA): y += (x - y) / 2^k. One subtraction and one shift.
+ * - Moving average of the last 2^k samples: a ring and its running sum. One addition, one subtraction and one shift.
+ * - Running median of the last N samples (N odd): the window is kept sorted, so each sample moves at most N entries. It removes spikes without blurring the steps of the temperature.
+ *
+ * The first sample fills the whole window (or the accumulator of the EMA), so the filter has no transient at start-up.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_FILTER_H
+#define THERMOSTAT_FILTER_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#define THERMOSTAT_FILTER_MAX_WINDOW 16U       /*!< Maximum number of samples of the window of the moving average and the running median */
+#define THERMOSTAT_FILTER_MAX_EMA_SHIFT 8U     /*!< Maximum smoothing of the EMA: alpha = 1/256 */
+#define THERMOSTAT_FILTER_EMA_FRACTION_BITS 8U /*!< Fractional bits of the accumulator of the EMA, so that small steps are not lost in the shift */
+
+/* Enums */
+/**
+ * @brief Enumerates the types of filters.
+ *
+ */
+enum THERMOSTAT_FILTER_TYPES
+{
+    THERMOSTAT_FILTER_NONE = 0,       /*!< The measurements are not modified */
+    THERMOSTAT_FILTER_EMA,            /*!< Exponential moving average */
+    THERMOSTAT_FILTER_MOVING_AVERAGE, /*!< Moving average of a window of 2^k samples */
+    THERMOSTAT_FILTER_MEDIAN,         /*!< Running median of a window of an odd number of samples */
+};
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Structure of a filter. The application reserves it (statically) and attaches it to a sensor with `port_temp_sensor_set_filter()`.
+ */
+typedef struct
+{
+    uint8_t type;                                  /*!< Type of the filter (see `THERMOSTAT_FILTER_TYPES`) */
+    uint8_t shift;                                 /*!< EMA: alpha = 1/2^shift. Moving average: the window has 2^shift samples */
+    uint8_t window;                                /*!< Samples of the window of the moving average and the running median */
+    uint8_t index;                                 /*!< Position of the oldest sample in the ring */
+    bool primed;                                   /*!< The filter has received its first sample */
+    uint32_t acc;                                  /*!< EMA: output with `THERMOSTAT_FILTER_EMA_FRACTION_BITS` fractional bits. Moving average: sum of the window */
+    uint16_t ring[THERMOSTAT_FILTER_MAX_WINDOW];   /*!< Samples of the window, in order of arrival */
+    uint16_t sorted[THERMOSTAT_FILTER_MAX_WINDOW]; /*!< Samples of the window, in ascending order (running median) */
+} thermostat_filter_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Initializes an exponential moving average: y += (x - y) / 2^shift.
+ *
+ * Its time constant is about 2^shift samples, and it needs no memory of the past samples.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param shift Smoothing, from 0 (no filtering) to `THERMOSTAT_FILTER_MAX_EMA_SHIFT`. It is saturated.
+ */
+void thermostat_filter_init_ema(thermostat_filter_t *p_filter, uint8_t shift);
+
+/**
+ * @brief Initializes a moving average of the last 2^shift samples.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param shift log2 of the window, from 0 (no filtering) to log2(`THERMOSTAT_FILTER_MAX_WINDOW`). It is saturated.
+ */
+void thermostat_filter_init_moving_average(thermostat_filter_t *p_filter, uint8_t shift);
+
+/**
+ * @brief Initializes a running median of the last samples.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param window Samples of the window. It must be odd, so that the median is one of them: an even window is made one sample shorter. It is saturated to `THERMOSTAT_FILTER_MAX_WINDOW` - 1.
+ */
+void thermostat_filter_init_median(thermostat_filter_t *p_filter, uint8_t window);
+
+/**
+ * @brief Discards the past samples of a filter. The next sample fills the window again.
+ *
+ * @param p_filter Pointer to the filter.
+ */
+void thermostat_filter_reset(thermostat_filter_t *p_filter);
+
+/**
+ * @brief Passes a new measurement through a filter.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param counts New measurement in counts of the ADC (up to 16 bits).
+ * @return uint32_t Filtered measurement in counts of the ADC.
+ */
+uint32_t thermostat_filter_update(thermostat_filter_t *p_filter, uint32_t counts);
+
+#endif /* THERMOSTAT_FILTER_H */
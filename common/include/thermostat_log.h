@@ -0,0 +1,83 @@
+/**
+ * @file thermostat_log.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the lock-free log of the thermostat.
+ *
+ * The ISRs push compact binary records to a single-producer/single-consumer ring and the main loop turns them into records of the telemetry stream (`thermostat_telemetry.h`). This way, no formatting runs inside an ISR.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_LOG_H
+#define THERMOSTAT_LOG_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#ifndef THERMOSTAT_LOG_SIZE
+#define THERMOSTAT_LOG_SIZE 16 /*!< Number of records of the log ring. It must be a power of 2 */
+#endif
+
+/* Enums */
+/**
+ * @brief Enumerates the codes of the log records.
+ *
+ */
+enum THERMOSTAT_LOG_CODES
+{
+    THERMOSTAT_LOG_TEMPERATURE = 0, /*!< New temperature sample. Source: slot of the sensor in the scan of the ADC. Argument: temperature in milli-degrees Celsius */
+};
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Structure of a log record.
+ */
+typedef struct
+{
+    uint32_t timestamp_ms; /*!< Time of the record in milliseconds */
+    uint16_t code;         /*!< Code of the record (see `THERMOSTAT_LOG_CODES`) */
+    uint8_t source;        /*!< Source of the record (e.g., the sensor of a sample) */
+    int32_t arg;           /*!< Argument of the record */
+} thermostat_log_record_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Pushes a record to the log. It must be called from a single producer (e.g., one ISR).
+ *
+ * It never blocks: if the ring is full, the record is dropped and counted.
+ *
+ * @param code Code of the record (see `THERMOSTAT_LOG_CODES`).
+ * @param source Source of the record (e.g., the sensor of a sample).
+ * @param arg Argument of the record.
+ * @return true if the record was pushed, false if it was dropped.
+ */
+bool thermostat_log_push(uint16_t code, uint8_t source, int32_t arg);
+
+/**
+ * @brief Pops the oldest record of the log. It must be called from a single consumer (e.g., the main loop).
+ *
+ * @param p_record Pointer to store the record.
+ * @return true if a record was popped, false if the log is empty.
+ */
+bool thermostat_log_pop(thermostat_log_record_t *p_record);
+
+/**
+ * @brief Moves all the pending records of the log to the telemetry stream, and the number of dropped records if it has changed. It does not flush the frame of the telemetry.
+ *
+ * @return uint32_t Number of records moved.
+ */
+uint32_t thermostat_log_drain(void);
+
+/**
+ * @brief Gets the number of records dropped because the log was full.
+ *
+ * @return uint32_t Number of dropped records.
+ */
+uint32_t thermostat_log_get_dropped(void);
+
+#endif /* THERMOSTAT_LOG_H */
@@ -0,0 +1,109 @@
+/**
+ * @file thermostat_profile.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the cycle profiler of the thermostat.
+ *
+ * The instrumented regions (ISRs, FSM) measure their duration with the cycle counter of the core and keep the minimum, maximum, mean and a log2 histogram of the cycles. The macros compile to nothing unless `THERMOSTAT_PROFILE` is 1, so the profiler costs nothing when it is not used.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_PROFILE_H
+#define THERMOSTAT_PROFILE_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* HW dependent includes */
+#include "port_system.h"
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#ifndef THERMOSTAT_PROFILE
+#define THERMOSTAT_PROFILE 0 /*!< Set to 1 (e.g., `-DTHERMOSTAT_PROFILE=1`) to instrument the regions */
+#endif
+#define THERMOSTAT_PROFILE_BUCKETS 32U /*!< Buckets of the histograms: bucket k counts the durations of [2^k, 2^(k+1)) cycles (bucket 0 also counts 0 cycles) */
+
+#if THERMOSTAT_PROFILE
+#define THERMOSTAT_PROFILE_BEGIN(region) uint32_t profile_start_##region = port_system_get_cycles()                      /*!< Starts the measurement of a region. It must be in the same block as `THERMOSTAT_PROFILE_END()` */
+#define THERMOSTAT_PROFILE_END(region) thermostat_profile_record((region), port_system_get_cycles() - profile_start_##region) /*!< Ends the measurement of a region and records its cycles */
+#else
+#define THERMOSTAT_PROFILE_BEGIN(region) ((void)0) /*!< Profiler disabled: nothing */
+#define THERMOSTAT_PROFILE_END(region) ((void)0)   /*!< Profiler disabled: nothing */
+#endif
+
+/* Enums */
+/**
+ * @brief Enumerates the instrumented regions. Each region must be recorded from a single context (one ISR or the main loop).
+ *
+ */
+enum THERMOSTAT_PROFILE_REGIONS
+{
+    THERMOSTAT_PROFILE_TIMEBASE_ISR = 0, /*!< ISR of the time base (TIM5 or SysTick) */
+    THERMOSTAT_PROFILE_DMA_ISR,          /*!< ISR of the DMA of the ADC: decimation and saving of the measurement */
+    THERMOSTAT_PROFILE_ADC_ISR,          /*!< ISR of the ADC: analog watchdog */
+    THERMOSTAT_PROFILE_RTC_ISR,          /*!< ISR of the wake-up timer of the RTC */
+    THERMOSTAT_PROFILE_UART_ISR,         /*!< ISRs of the UART (idle line) and of its DMA (end of transmission). Both have the same priority */
+    THERMOSTAT_PROFILE_FSM_FIRE,         /*!< Evaluation of all the thermostat FSMs */
+    THERMOSTAT_PROFILE_LOG_DRAIN,        /*!< Encoding of the log records into the telemetry, including the sending of the frames that fill up */
+    THERMOSTAT_PROFILE_CMD,              /*!< Parsing and execution of the commands received by the UART */
+    THERMOSTAT_PROFILE_REGIONS_COUNT     /*!< Number of regions */
+};
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Statistics of an instrumented region, in cycles of the core.
+ */
+typedef struct
+{
+    uint32_t count;                                   /*!< Number of measurements */
+    uint32_t min_cycles;                              /*!< Shortest measurement */
+    uint32_t max_cycles;                              /*!< Longest measurement */
+    uint64_t total_cycles;                            /*!< Sum of all the measurements, for the mean */
+    uint32_t histogram[THERMOSTAT_PROFILE_BUCKETS];   /*!< Measurements per log2 bucket of cycles */
+} thermostat_profile_stats_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Records a measurement of a region. It is called by `THERMOSTAT_PROFILE_END()`.
+ *
+ * @param region Region (see `THERMOSTAT_PROFILE_REGIONS`).
+ * @param cycles Duration of the region in cycles of the core.
+ */
+void thermostat_profile_record(uint8_t region, uint32_t cycles);
+
+/**
+ * @brief Gets the statistics of a region.
+ *
+ * @param region Region (see `THERMOSTAT_PROFILE_REGIONS`).
+ * @param p_stats Pointer to store the statistics.
+ * @return true if the region exists, false otherwise.
+ */
+bool thermostat_profile_get_stats(uint8_t region, thermostat_profile_stats_t *p_stats);
+
+/**
+ * @brief Gets the log2 bucket of a duration: the position of its most significant bit.
+ *
+ * @param cycles Duration in cycles of the core.
+ * @return uint8_t Bucket of the histogram (0 to `THERMOSTAT_PROFILE_BUCKETS` - 1).
+ */
+uint8_t thermostat_profile_bucket(uint32_t cycles);
+
+/**
+ * @brief Discards the statistics of all the regions.
+ */
+void thermostat_profile_reset(void);
+
+/**
+ * @brief Writes the statistics of the regions with measurements to the text output of the trace (`port_system_trace_write_text()`: stimulus port 1 of the ITM in the STM32F4, `stderr` in the native platform), apart from the frames of the telemetry: count, minimum, mean and maximum, and the non-empty buckets of the histogram.
+ *
+ * It formats the text, so it must be called from the main loop, not from an ISR.
+ *
+ * @return uint32_t Number of regions written.
+ */
+uint32_t thermostat_profile_dump(void);
+
+#endif /* THERMOSTAT_PROFILE_H */
@@ -0,0 +1,189 @@
+/**
+ * @file thermostat_telemetry.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the binary telemetry stream of the thermostat and its decoder.
+ *
+ * The main loop sends the temperature samples, the transitions of the thermostats and some counters as binary records instead of text. The records are gathered in frames of up to `THERMOSTAT_TELEMETRY_FRAME_SIZE` bytes, and each frame is self-contained, so that a lost frame does not corrupt the next ones:
+ *
+ * | Field     | Bytes        | Content                                                        |
+ * |-----------|--------------|----------------------------------------------------------------|
+ * | Version   | 1            | `THERMOSTAT_TELEMETRY_VERSION`                                 |
+ * | Base time | 1 to 5       | Time of the first record of the frame in milliseconds          |
+ * | Records   | 2 to 11 each | Tag byte (type, flag bit and id), time and value (see below)  |
+ * | CRC       | 1            | CRC-8 (polynomial 0x07) of the previous bytes                  |
+ *
+ * The numbers are variable-length (7 bits per byte, LSBs first), and the signed ones are zigzag-encoded (0, -1, 1, -2...) so that small numbers take one byte:
+ * - Sample: the time is the difference with the time predicted from the previous two samples of the sensor in the frame, and the value is the difference with the previous temperature of the sensor in the frame. When the sample is at the predicted time, as the samples of a periodic sensor are, the flag bit of the tag is set and the time is not sent. The first sample of a sensor in a frame is relative to the base time and to 0 m°C.
+ * - Transition: the time since the base time. The event is the flag bit of the tag, and there is no value.
+ * - Counter: the time since the base time, and the value of the counter.
+ *
+ * A periodic sample takes 2 bytes (3 if the temperature changes by more than 63 m°C), and the frame is sent when the next record does not fit, when the first record is `THERMOSTAT_TELEMETRY_MAX_LATENCY_MS` old, or with `thermostat_telemetry_flush()`. The frame is COBS-encoded (no byte 0 inside) and followed by a byte 0, so the receiver finds the start of the next frame after any error. The frames are written to the trace output (`port_system_trace_write()`: the ITM in the target, `stdout` in the native platform) or to the output given to `thermostat_telemetry_init()`.
+ *
+ * The encoder is not reentrant: it must be called from the main loop only. The decoder runs in the host (e.g., `tools/telemetry_decode`).
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_TELEMETRY_H
+#define THERMOSTAT_TELEMETRY_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#ifndef THERMOSTAT_TELEMETRY_FRAME_SIZE
+#define THERMOSTAT_TELEMETRY_FRAME_SIZE 64U /*!< Bytes of a frame before the COBS encoding, CRC included. From 18 to 254 */
+#endif
+#ifndef THERMOSTAT_TELEMETRY_MAX_LATENCY_MS
+#define THERMOSTAT_TELEMETRY_MAX_LATENCY_MS 30000U /*!< A frame is sent when its first record is this old, even if it is not full */
+#endif
+#define THERMOSTAT_TELEMETRY_VERSION 1U                                               /*!< First byte of a frame: version of the format */
+#define THERMOSTAT_TELEMETRY_MAX_IDS 32U                                              /*!< Number of sensors, zones or counters that fit in the tag byte */
+#define THERMOSTAT_TELEMETRY_MAX_SENSORS 16U                                          /*!< Number of sensors whose previous sample is kept for the differences */
+#define THERMOSTAT_TELEMETRY_MAX_RECORD_BYTES 11U                                     /*!< Longest record: tag, 32-bit time and 32-bit value */
+#define THERMOSTAT_TELEMETRY_MAX_ENCODED_BYTES (THERMOSTAT_TELEMETRY_FRAME_SIZE + 2U) /*!< Longest frame on the wire: COBS code byte, frame and delimiter */
+
+/* Enums */
+/**
+ * @brief Enumerates the types of the records of the telemetry.
+ *
+ */
+enum THERMOSTAT_TELEMETRY_TYPES
+{
+    THERMOSTAT_TELEMETRY_SAMPLE = 0,     /*!< New temperature of a sensor. Id: slot of the sensor in the scan of the ADC. Value: temperature in milli-degrees Celsius */
+    THERMOSTAT_TELEMETRY_TRANSITION = 1, /*!< Transition of a thermostat. Id: index of the thermostat in the pool. Value: event (see `THERMOSTAT_EVENTS`) */
+    THERMOSTAT_TELEMETRY_COUNTER = 2,    /*!< Value of a counter. Id: counter (see `THERMOSTAT_TELEMETRY_COUNTERS`) */
+};
+
+/**
+ * @brief Enumerates the counters of the telemetry.
+ *
+ */
+enum THERMOSTAT_TELEMETRY_COUNTERS
+{
+    THERMOSTAT_TELEMETRY_AWAKE_PERMILLE = 0, /*!< Time spent awake since the system started, in tenths of percent */
+    THERMOSTAT_TELEMETRY_SLEEPS = 1,         /*!< Number of times the core has slept */
+    THERMOSTAT_TELEMETRY_STOPS = 2,          /*!< Number of those sleeps in STOP mode */
+    THERMOSTAT_TELEMETRY_TRANSITIONS = 3,    /*!< Transitions of the thermostat since it was created */
+    THERMOSTAT_TELEMETRY_LOG_DROPPED = 4,    /*!< Records dropped because the log of the ISRs was full */
+};
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Output of the frames of the telemetry.
+ *
+ * @param p_data Bytes of a COBS-encoded frame and its delimiter.
+ * @param length Number of bytes.
+ */
+typedef void (*thermostat_telemetry_output_t)(const uint8_t *p_data, uint32_t length);
+
+/**
+ * @brief Decoded record of the telemetry.
+ */
+typedef struct
+{
+    uint32_t time_ms; /*!< Time of the record in milliseconds */
+    uint8_t type;     /*!< Type of the record (see `THERMOSTAT_TELEMETRY_TYPES`) */
+    uint8_t id;       /*!< Sensor of a sample, thermostat of a transition or counter */
+    int32_t value;    /*!< Temperature of a sample, event of a transition or value of a counter */
+} thermostat_telemetry_record_t;
+
+/**
+ * @brief State of a frame used for the differences of the samples. The encoder and the decoder keep the same one.
+ */
+typedef struct
+{
+    uint32_t base_ms;                                     /*!< Base time of the frame */
+    uint32_t sensors;                                     /*!< Bit mask of the sensors with a previous sample in the frame */
+    uint32_t sample_ms[THERMOSTAT_TELEMETRY_MAX_SENSORS]; /*!< Time of the previous sample of each sensor */
+    uint32_t period_ms[THERMOSTAT_TELEMETRY_MAX_SENSORS]; /*!< Time between the previous two samples of each sensor */
+    int32_t mcelsius[THERMOSTAT_TELEMETRY_MAX_SENSORS];   /*!< Temperature of the previous sample of each sensor */
+} thermostat_telemetry_frame_state_t;
+
+/**
+ * @brief Decoder of a stream of telemetry. It is fed byte by byte, as the bytes arrive.
+ */
+typedef struct
+{
+    uint8_t frame[THERMOSTAT_TELEMETRY_FRAME_SIZE]; /*!< Frame being received, after the COBS decoding */
+    uint32_t length;                                /*!< Bytes of the frame */
+    uint32_t offset;                                /*!< Next byte of a valid frame to decode into records, or 0 while the frame is being received */
+    uint8_t block;                                  /*!< Bytes left in the current COBS block */
+    bool pending_zero;                              /*!< The current COBS block ends with a byte 0 */
+    bool overflow;                                  /*!< The frame is longer than `THERMOSTAT_TELEMETRY_FRAME_SIZE` */
+    thermostat_telemetry_frame_state_t state;       /*!< State of the valid frame for the differences of the samples */
+    uint32_t frames;                                /*!< Valid frames received */
+    uint32_t bad_frames;                            /*!< Frames discarded (wrong COBS encoding, length, CRC or version) */
+    uint32_t bytes;                                 /*!< Bytes received */
+} thermostat_telemetry_decoder_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Discards the frame being filled and sets the output of the frames.
+ *
+ * @param output Output of the frames, or NULL for the trace output (`port_system_trace_write()`).
+ */
+void thermostat_telemetry_init(thermostat_telemetry_output_t output);
+
+/**
+ * @brief Adds a temperature sample to the frame.
+ *
+ * @param sensor Slot of the sensor in the scan of the ADC (less than `THERMOSTAT_TELEMETRY_MAX_SENSORS`).
+ * @param time_ms Time of the sample in milliseconds.
+ * @param mcelsius Temperature in milli-degrees Celsius.
+ */
+void thermostat_telemetry_sample(uint8_t sensor, uint32_t time_ms, int32_t mcelsius);
+
+/**
+ * @brief Adds a transition of a thermostat to the frame.
+ *
+ * @param zone Index of the thermostat in the pool.
+ * @param event Event of the transition (see `THERMOSTAT_EVENTS`).
+ * @param time_ms Time of the transition in milliseconds.
+ */
+void thermostat_telemetry_transition(uint8_t zone, uint8_t event, uint32_t time_ms);
+
+/**
+ * @brief Adds the value of a counter to the frame.
+ *
+ * @param counter Counter (see `THERMOSTAT_TELEMETRY_COUNTERS`).
+ * @param time_ms Time of the value in milliseconds.
+ * @param value Value of the counter (up to 2^31 - 1).
+ */
+void thermostat_telemetry_counter(uint8_t counter, uint32_t time_ms, uint32_t value);
+
+/**
+ * @brief Sends the frame being filled, if it has any record.
+ */
+void thermostat_telemetry_flush(void);
+
+/**
+ * @brief Starts to decode a stream of telemetry.
+ *
+ * @param p_decoder Decoder to initialize.
+ */
+void thermostat_telemetry_decoder_init(thermostat_telemetry_decoder_t *p_decoder);
+
+/**
+ * @brief Feeds a byte of the stream to the decoder. When it returns true, the records of the frame must be read with `thermostat_telemetry_decoder_next()` before the next byte is fed.
+ *
+ * @param p_decoder Decoder of the stream.
+ * @param byte Next byte of the stream.
+ * @return true if the byte completes a valid frame, false otherwise.
+ */
+bool thermostat_telemetry_decoder_push(thermostat_telemetry_decoder_t *p_decoder, uint8_t byte);
+
+/**
+ * @brief Decodes the next record of the last valid frame.
+ *
+ * @param p_decoder Decoder of the stream.
+ * @param p_record Pointer to store the record.
+ * @return true if a record was decoded, false at the end of the frame or if the record is truncated.
+ */
+bool thermostat_telemetry_decoder_next(thermostat_telemetry_decoder_t *p_decoder, thermostat_telemetry_record_t *p_record);
+
+#endif /* THERMOSTAT_TELEMETRY_H */
@@ -0,0 +1,161 @@
+/**
+ * @file thermostat_trace.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the binary trace recorder of the thermostat and its replay driver.
+ *
+ * The recorder captures the raw measurements of the sensor and the transitions of the thermostats into a compact ring of bytes in RAM. When the ring is full, the oldest records are dropped. The ring is exported as a self-contained image (e.g., read with the debugger on the target, or written to a file in the native platform) that the replay driver feeds back into the sensor and the FSM as fast as possible, to reproduce in the host the behaviour of a unit in the field.
+ *
+ * Each record is a tag byte (type, and the zone of a transition or the sensor of a sample) followed by the time since the previous record in milliseconds and, for a sample, its counts. Both numbers are variable-length (7 bits per byte, LSBs first), so a sample every second takes 5 bytes.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef THERMOSTAT_TRACE_H
+#define THERMOSTAT_TRACE_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Other includes */
+#include <fsm.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#ifndef THERMOSTAT_TRACE_SIZE
+#define THERMOSTAT_TRACE_SIZE 1024 /*!< Bytes of the ring of the recorder. It must be a power of 2 */
+#endif
+#define THERMOSTAT_TRACE_MAGIC 0x31435254U   /*!< First word of an image of the trace: "TRC1" */
+#define THERMOSTAT_TRACE_HEADER_BYTES 16U    /*!< Header of an image: magic, time reference, length of the records and dropped records (32 bits each, little endian) */
+#define THERMOSTAT_TRACE_MAX_RECORD_BYTES 11U /*!< Longest record: tag, 32-bit delta and 32-bit counts */
+
+/* Enums */
+/**
+ * @brief Enumerates the types of the records of the trace.
+ *
+ */
+enum THERMOSTAT_TRACE_TYPES
+{
+    THERMOSTAT_TRACE_SAMPLE = 0,     /*!< New measurement of a sensor. Zone: slot of the sensor in the scan of the ADC. Value: counts of `TEMP_SENSOR_ADC_BITS` bits */
+    THERMOSTAT_TRACE_TRANSITION = 1, /*!< Transition of a thermostat. Zone: index of the thermostat in the pool. Value: event (see `THERMOSTAT_EVENTS`) */
+};
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Decoded record of the trace.
+ */
+typedef struct
+{
+    uint32_t time_ms; /*!< Time of the record in milliseconds */
+    uint8_t type;     /*!< Type of the record (see `THERMOSTAT_TRACE_TYPES`) */
+    uint8_t zone;     /*!< Thermostat of a transition, or sensor of a sample */
+    uint32_t value;   /*!< Counts of a sample or event of a transition */
+} thermostat_trace_record_t;
+
+/**
+ * @brief Reader of an image of the trace.
+ */
+typedef struct
+{
+    const uint8_t *p_records; /*!< First byte of the records of the image */
+    uint32_t length;          /*!< Bytes of the records */
+    uint32_t offset;          /*!< Next byte to decode */
+    uint32_t time_ms;         /*!< Time of the last decoded record */
+    uint32_t dropped;         /*!< Records dropped by the recorder before the first one of the image */
+} thermostat_trace_reader_t;
+
+/**
+ * @brief Result of the replay of a trace.
+ */
+typedef struct
+{
+    uint32_t samples;              /*!< Samples fed to the sensor */
+    uint32_t recorded_transitions; /*!< Transitions of the thermostat found in the trace */
+    uint32_t replayed_transitions; /*!< Transitions made by the thermostat during the replay */
+    uint32_t mismatches;           /*!< Transitions that were recorded but not replayed, or replayed but not recorded, in order */
+} thermostat_trace_replay_result_t;
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Records a new measurement of a sensor. It is called by the port of the sensor, in the ISR.
+ *
+ * @param sensor Slot of the sensor in the scan of the ADC.
+ * @param counts Counts of the measurement.
+ */
+void thermostat_trace_sample(uint8_t sensor, uint32_t counts);
+
+/**
+ * @brief Records a transition of a thermostat. It is called by the FSM, in the main loop.
+ *
+ * @param zone Index of the thermostat in the pool.
+ * @param event Event of the transition (see `THERMOSTAT_EVENTS`).
+ */
+void thermostat_trace_transition(uint8_t zone, uint8_t event);
+
+/**
+ * @brief Enables or disables the recorder. It is enabled by default, and disabled during a replay.
+ *
+ * @param enable true to record, false to ignore the new records.
+ */
+void thermostat_trace_enable(bool enable);
+
+/**
+ * @brief Discards all the records of the recorder.
+ */
+void thermostat_trace_clear(void);
+
+/**
+ * @brief Gets the number of records dropped because the ring was full since the last `thermostat_trace_clear()`.
+ *
+ * @return uint32_t Number of dropped records.
+ */
+uint32_t thermostat_trace_get_dropped(void);
+
+/**
+ * @brief Exports the records of the ring as a self-contained image: a header of `THERMOSTAT_TRACE_HEADER_BYTES` and the records, from the oldest to the newest.
+ *
+ * The ring is copied with the interrupts masked, so that the image is consistent.
+ *
+ * @param p_image Buffer for the image.
+ * @param max_length Bytes of the buffer. `THERMOSTAT_TRACE_HEADER_BYTES` + `THERMOSTAT_TRACE_SIZE` always fit.
+ * @return uint32_t Bytes of the image, or 0 if the buffer is too small.
+ */
+uint32_t thermostat_trace_export(uint8_t *p_image, uint32_t max_length);
+
+/**
+ * @brief Starts to read an image of the trace.
+ *
+ * @param p_reader Reader to initialize.
+ * @param p_image Image of the trace.
+ * @param length Bytes of the image.
+ * @return true if the header of the image is valid, false otherwise.
+ */
+bool thermostat_trace_reader_init(thermostat_trace_reader_t *p_reader, const uint8_t *p_image, uint32_t length);
+
+/**
+ * @brief Decodes the next record of an image of the trace.
+ *
+ * @param p_reader Reader of the image.
+ * @param p_record Pointer to store the record.
+ * @return true if a record was decoded, false at the end of the image or if the record is truncated.
+ */
+bool thermostat_trace_reader_next(thermostat_trace_reader_t *p_reader, thermostat_trace_record_t *p_record);
+
+/**
+ * @brief Replays an image of the trace into a thermostat: each sample of its sensor is saved in the sensor of the thermostat at the time it was recorded, and the thermostat is fired. The transitions of the thermostat are compared with the ones recorded for its zone.
+ *
+ * The recorder is disabled during the replay, and the system time is set to the time of each sample, so it should run in the native platform (e.g., `tools/trace_replay`). There is no waiting: a week of samples replays in a fraction of a second.
+ *
+ * @param p_image Image of the trace.
+ * @param length Bytes of the image.
+ * @param p_fsm Thermostat to replay into. It should be new, so that its initial state matches the one of the recording.
+ * @param zone Zone whose recorded transitions are compared with the ones of `p_fsm`.
+ * @param sensor Sensor of the zone in the recording: only its samples are replayed.
+ * @param p_result Pointer to store the result of the replay.
+ * @return true if the image was valid, false otherwise.
+ */
+bool thermostat_trace_replay(const uint8_t *p_image, uint32_t length, fsm_t *p_fsm, uint8_t zone, uint8_t sensor, thermostat_trace_replay_result_t *p_result);
+
+#endif /* THERMOSTAT_TRACE_H */
@@ -8,7 +8,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 /* Standard C includes */
-#include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
 /* Project includes */
@@ -16,6 +16,165 @@
 #include "port_thermostat.h"
 #include "port_led.h"
 #include "port_temp_sensor.h"
+#include "thermostat_trace.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define HISTORY_EVENT_BIT 0x80U    /*!< Head byte of an event: event (ACTIVATION: 0, DEACTIVATION: 1) */
+#define HISTORY_EXT_BIT 0x40U      /*!< Head byte of an event: the delta continues in the previous (older) byte */
+#define HISTORY_HEAD_MASK 0x3FU    /*!< Head byte of an event: 6 LSBs of the delta */
+#define HISTORY_MORE_BIT 0x80U     /*!< Extension byte: the delta continues in the previous (older) byte */
+#define HISTORY_EXT_MASK 0x7FU     /*!< Extension byte: next 7 bits of the delta */
+#define HISTORY_MAX_EVENT_BYTES 5U /*!< Maximum size of an event: 6 + 4 * 7 bits hold a 32-bit delta */
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Event history of a thermostat. It is only accessed on transitions and queries, so it is kept apart from the pool of thermostats.
+ *
+ * The events are packed in a ring of bytes. Each event is written as a head byte (event bit, extension bit and the 6 LSBs of the delta) preceded by as many extension bytes (7 bits each) as the delta needs, with the closest ones to the head holding the lower bits. This way the ring can be decoded backwards from the most recent event. The delta is the time since the previous event in units of `THERMOSTAT_HISTORY_RESOLUTION_MS`.
+ */
+typedef struct
+{
+    uint8_t ring[THERMOSTAT_HISTORY];                 /*!< Packed events */
+    uint16_t head;                                    /*!< Index of the ring where the next byte is written */
+    uint16_t used;                                    /*!< Number of valid bytes in the ring */
+    uint32_t newest_ticks;                            /*!< Time of the most recent event in units of `THERMOSTAT_HISTORY_RESOLUTION_MS` */
+    uint32_t last_time_events[THERMOSTAT_NUM_EVENTS]; /*!< Last time of each event in milliseconds (constant-time index) */
+    uint8_t last_event;                               /*!< Most recent event, or `UNKNOWN` */
+} fsm_thermostat_history_t;
+
+/**
+ * @brief Settings of a thermostat. They are only read when they change, when they are queried and, for the dwell times, when the temperature has left the hysteresis band, so they are kept apart from the pool of thermostats. The guards use the limits of the band converted into ADC counts, which are hot fields.
+ */
+typedef struct
+{
+    int32_t threshold_mcelsius;   /*!< Threshold temperature to activate the thermostat in milli-degrees Celsius */
+    uint32_t hysteresis_mcelsius; /*!< Width of the hysteresis band centered on the threshold in milli-degrees Celsius */
+    uint32_t min_on_ms;           /*!< Minimum time in the `THERMOSTAT_ON` state in milliseconds */
+    uint32_t min_off_ms;          /*!< Minimum time in the `THERMOSTAT_OFF` state in milliseconds */
+} fsm_thermostat_settings_t;
+
+/**
+ * @brief Settings of the measurements, shared by all the thermostats: their sensors are converted by one scan of the ADC, started by one trigger (the measurement timer, or the RTC in low-power mode).
+ */
+typedef struct
+{
+    uint32_t period_ms; /*!< Period of the measurements in milliseconds */
+    bool low_power;     /*!< The measurements are triggered by the RTC and the core enters STOP mode between them */
+} fsm_thermostat_scan_settings_t;
+
+/* Global variables -----------------------------------------------------------*/
+_Static_assert(THERMOSTAT_POOL_SIZE <= 32, "The pool of thermostats is tracked in a 32-bit mask");
+
+static fsm_thermostat_t thermostat_pool[THERMOSTAT_POOL_SIZE];              /*!< Static pool of thermostats (hot fields) */
+static fsm_thermostat_history_t thermostat_history[THERMOSTAT_POOL_SIZE];   /*!< Event history of each thermostat of the pool (cold fields) */
+static fsm_thermostat_stats_t thermostat_stats[THERMOSTAT_POOL_SIZE];       /*!< Counters of transitions of each thermostat of the pool (cold fields) */
+static fsm_thermostat_settings_t thermostat_settings[THERMOSTAT_POOL_SIZE]; /*!< Settings of each thermostat of the pool (cold fields) */
+static fsm_thermostat_scan_settings_t thermostat_scan_settings;             /*!< Settings of the measurements of all the thermostats of the pool */
+static uint32_t thermostat_in_use = 0;                                      /*!< Bitmask of the thermostats of the pool in use */
+static uint8_t thermostat_high_water = 0;                                   /*!< Number of slots of the pool that have ever been used */
+
+_Static_assert(THERMOSTAT_HISTORY >= HISTORY_MAX_EVENT_BYTES, "The event history must fit at least one event");
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief Stores an event in the history of a thermostat.
+ *
+ * @param p_history Pointer to the event history
+ * @param event Event to store
+ * @param time_ms Time of the event in milliseconds
+ */
+static void _history_push(fsm_thermostat_history_t *p_history, uint8_t event, uint32_t time_ms)
+{
+    uint32_t ticks = time_ms / THERMOSTAT_HISTORY_RESOLUTION_MS;
+    uint32_t delta = ticks - p_history->newest_ticks;
+
+    // Split the delta: 6 LSBs in the head byte and groups of 7 bits in the extension bytes, lower groups closer to the head
+    uint8_t bytes[HISTORY_MAX_EVENT_BYTES];
+    uint8_t n = 0;
+    bytes[n++] = (event ? HISTORY_EVENT_BIT : 0) | (delta & HISTORY_HEAD_MASK);
+    delta >>= 6;
+    while (delta > 0)
+    {
+        bytes[0] |= HISTORY_EXT_BIT;
+        bytes[n++] = (delta & HISTORY_EXT_MASK);
+        delta >>= 7;
+        if (delta > 0)
+        {
+            bytes[n - 1] |= HISTORY_MORE_BIT;
+        }
+    }
+
+    // Write from the oldest byte (last extension) to the head byte
+    while (n > 0)
+    {
+        p_history->ring[p_history->head] = bytes[--n];
+        p_history->head = (p_history->head + 1) % THERMOSTAT_HISTORY;
+        if (p_history->used < THERMOSTAT_HISTORY)
+        {
+            p_history->used++;
+        }
+    }
+
+    // Update the constant-time index
+    p_history->newest_ticks = ticks;
+    p_history->last_time_events[event] = time_ms;
+    p_history->last_event = event;
+}
+
+/**
+ * @brief Converts the threshold and the hysteresis of a thermostat into raw ADC counts. The guards are evaluated again at the next firing.
+ *
+ * @param p_fsm Pointer to the thermostat FSM structure
+ */
+static void _update_band(fsm_thermostat_t *p_fsm)
+{
+    const fsm_thermostat_settings_t *p_settings = &thermostat_settings[p_fsm->zone];
+    int32_t half = (int32_t)(p_settings->hysteresis_mcelsius / 2U);
+    int32_t low_mcelsius = p_settings->threshold_mcelsius - half;
+    int32_t high_mcelsius = p_settings->threshold_mcelsius + ((int32_t)p_settings->hysteresis_mcelsius - half);
+    p_fsm->threshold_adc_counts = port_temp_sensor_mcelsius_to_adc_counts(p_fsm->p_temp_sensor, p_settings->threshold_mcelsius);
+    p_fsm->heat_adc_counts = port_temp_sensor_mcelsius_to_adc_counts(p_fsm->p_temp_sensor, low_mcelsius);
+    p_fsm->comfort_adc_counts = port_temp_sensor_mcelsius_to_adc_counts(p_fsm->p_temp_sensor, high_mcelsius);
+    p_fsm->inputs_changed = true;
+}
+
+/**
+ * @brief Checks if a thermostat has been in its current state for its minimum dwell time. If not, the transition is counted as suppressed.
+ *
+ * @param p_fsm Pointer to the thermostat FSM structure
+ * @param min_ms Minimum dwell time of the current state in milliseconds
+ * @return true if the thermostat can leave its current state, false otherwise
+ */
+static bool _dwell_elapsed(fsm_thermostat_t *p_fsm, uint32_t min_ms)
+{
+    // The first activation is not delayed. The subtraction is safe when the milliseconds wrap around
+    if ((min_ms == 0) || (thermostat_history[p_fsm->zone].last_event == (uint8_t)UNKNOWN) || ((port_system_get_millis() - p_fsm->state_since_ms) >= min_ms))
+    {
+        return true;
+    }
+    thermostat_stats[p_fsm->zone].suppressed_by_dwell++;
+    return false;
+}
+
+/**
+ * @brief Arms the analog watchdog of the sensor of a thermostat on the side of the threshold given by its state.
+ *
+ * @param p_fsm Pointer to the thermostat FSM structure
+ */
+static void _arm_adc_watchdog(fsm_thermostat_t *p_fsm)
+{
+    if (fsm_get_state(&p_fsm->f) == THERMOSTAT_ON)
+    {
+        // Heating: wake up when the temperature reaches the upper limit of the band
+        uint32_t comfort = p_fsm->comfort_adc_counts;
+        port_temp_sensor_watch(p_fsm->p_temp_sensor, 0, (comfort > 0) ? comfort - 1U : 0);
+    }
+    else
+    {
+        // Comfort: wake up when the temperature falls below the lower limit of the band
+        port_temp_sensor_watch(p_fsm->p_temp_sensor, p_fsm->heat_adc_counts, (1U << TEMP_SENSOR_ADC_BITS) - 1U);
+    }
+}
 
 /* State machine input or transition functions */
 
@@ -30,15 +189,19 @@ bool check_heat(fsm_t *p_this)
     // Retrieve the FSM structure and get the temperature sensor
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
 
-    // Get the temperature from the sensor
-    if (port_temp_sensor_get_temperature(p_fsm->p_temp_sensor) < p_fsm->threshold_temp_celsius)
+    // Compare the raw measurement of the sensor with the lower limit of the band, both in ADC counts
+    uint32_t counts = port_temp_sensor_get_adc_counts(p_fsm->p_temp_sensor);
+    if (counts < p_fsm->heat_adc_counts)
     {
-        return true;
+        return _dwell_elapsed(p_fsm, thermostat_settings[p_fsm->zone].min_off_ms);
     }
-    else
+
+    // Below the threshold, but inside the band
+    if (counts < p_fsm->threshold_adc_counts)
     {
-        return false;
+        thermostat_stats[p_fsm->zone].suppressed_by_hysteresis++;
     }
+    return false;
 }
 
 /**
@@ -49,7 +212,22 @@ bool check_heat(fsm_t *p_this)
  */
 bool check_comfort(fsm_t *p_this)
 {
-    return !check_heat(p_this);
+    // Retrieve the FSM structure and get the temperature sensor
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+
+    // Compare the raw measurement of the sensor with the upper limit of the band, both in ADC counts
+    uint32_t counts = port_temp_sensor_get_adc_counts(p_fsm->p_temp_sensor);
+    if (counts >= p_fsm->comfort_adc_counts)
+    {
+        return _dwell_elapsed(p_fsm, thermostat_settings[p_fsm->zone].min_on_ms);
+    }
+
+    // Above the threshold, but inside the band
+    if (counts >= p_fsm->threshold_adc_counts)
+    {
+        thermostat_stats[p_fsm->zone].suppressed_by_hysteresis++;
+    }
+    return false;
 }
 
 /* State machine output or action functions */
@@ -64,14 +242,14 @@ void do_thermostat_on(fsm_t *p_this)
     // Retrieve the FSM structure and get the LED
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
 
-    // Set the LEDs according to the thermostat status
-    port_led_on(p_fsm->p_led_heat);
-    port_led_off(p_fsm->p_led_comfort);
+    // Set the LEDs according to the thermostat status. Both change at once: a single write if they share the port
+    port_led_switch(p_fsm->p_led_heat, p_fsm->p_led_comfort);
 
-    // Store the event
-    p_fsm->last_events[p_fsm->event_idx] = ACTIVATION;
-    p_fsm->last_time_events[p_fsm->event_idx] = port_system_get_millis();
-    p_fsm->event_idx = (p_fsm->event_idx + 1) % THERMOSTAT_HISTORY;
+    // Store the event and start the dwell time of the new state
+    p_fsm->state_since_ms = port_system_get_millis();
+    _history_push(&thermostat_history[p_fsm->zone], ACTIVATION, p_fsm->state_since_ms);
+    thermostat_trace_transition(p_fsm->zone, ACTIVATION);
+    thermostat_stats[p_fsm->zone].transitions++;
 }
 
 /**
@@ -84,19 +262,19 @@ void do_thermostat_off(fsm_t *p_this)
     // Retrieve the FSM structure and get the LED
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
 
-    // Set the LEDs according to the thermostat status
-    port_led_off(p_fsm->p_led_heat);
-    port_led_on(p_fsm->p_led_comfort);
+    // Set the LEDs according to the thermostat status. Both change at once: a single write if they share the port
+    port_led_switch(p_fsm->p_led_comfort, p_fsm->p_led_heat);
 
-    // Store the event
-    p_fsm->last_events[p_fsm->event_idx] = DEACTIVATION;
-    p_fsm->last_time_events[p_fsm->event_idx] = port_system_get_millis();
-    p_fsm->event_idx = (p_fsm->event_idx + 1) % THERMOSTAT_HISTORY;
+    // Store the event and start the dwell time of the new state
+    p_fsm->state_since_ms = port_system_get_millis();
+    _history_push(&thermostat_history[p_fsm->zone], DEACTIVATION, p_fsm->state_since_ms);
+    thermostat_trace_transition(p_fsm->zone, DEACTIVATION);
+    thermostat_stats[p_fsm->zone].transitions++;
 }
 
 /* Transitions table ---------------------------------------------------------*/
 /**
- * @brief Transitions table for the thermostat
+ * @brief Transitions table for the thermostat. With `USE_FSM_TABLE`, the same transitions are compiled into the engine of `fsm_thermostat_table.cpp`, and this table only sets the initial state
  *
  */
 fsm_trans_t fsm_trans_thermostat[] = {
@@ -109,21 +287,61 @@ uint32_t fsm_thermostat_get_last_time_event(fsm_t *p_this, uint8_t event)
 {
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
 
-    // Look for the last time the event was detected, if it was detected. If not, return 0
-    for (int i = 0; i < THERMOSTAT_HISTORY; i++)
+    // Last time the event was detected, if it was detected. If not, it is 0
+    if (event >= THERMOSTAT_NUM_EVENTS)
     {
-        if (p_fsm->last_events[i] == event)
-        {
-            return p_fsm->last_time_events[i];
-        }
+        return 0;
     }
-    return 0;
+    return thermostat_history[p_fsm->zone].last_time_events[event];
 }
 
 uint8_t fsm_thermostat_get_status(fsm_t *p_this)
 {
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
-    return p_fsm->last_events[p_fsm->event_idx];
+    return thermostat_history[p_fsm->zone].last_event;
+}
+
+uint8_t fsm_thermostat_get_history(fsm_t *p_this, uint8_t *p_events, uint32_t *p_times, uint8_t max_events)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    fsm_thermostat_history_t *p_history = &thermostat_history[p_fsm->zone];
+
+    uint32_t ticks = p_history->newest_ticks;
+    uint16_t n_read = 0;
+    uint8_t count = 0;
+    while ((count < max_events) && (n_read < p_history->used))
+    {
+        // Decode backwards: head byte first, then the extension bytes. Stop if the oldest event was partially overwritten
+        uint8_t head = p_history->ring[(p_history->head + THERMOSTAT_HISTORY - 1 - n_read) % THERMOSTAT_HISTORY];
+        n_read++;
+        uint32_t delta = head & HISTORY_HEAD_MASK;
+        bool more = (head & HISTORY_EXT_BIT) != 0;
+        uint8_t shift = 6;
+        while (more)
+        {
+            if (n_read >= p_history->used)
+            {
+                return count;
+            }
+            uint8_t ext = p_history->ring[(p_history->head + THERMOSTAT_HISTORY - 1 - n_read) % THERMOSTAT_HISTORY];
+            n_read++;
+            delta |= (uint32_t)(ext & HISTORY_EXT_MASK) << shift;
+            more = (ext & HISTORY_MORE_BIT) != 0;
+            shift += 7;
+        }
+
+        if (p_events != NULL)
+        {
+            p_events[count] = (head & HISTORY_EVENT_BIT) ? DEACTIVATION : ACTIVATION;
+        }
+        if (p_times != NULL)
+        {
+            p_times[count] = ticks * THERMOSTAT_HISTORY_RESOLUTION_MS;
+        }
+        ticks -= delta;
+        count++;
+    }
+    return count;
 }
 
 /* Initialize the FSM */
@@ -136,7 +354,7 @@ uint8_t fsm_thermostat_get_status(fsm_t *p_this)
  * @param p_led_comfort Pointer to the LED structure
  * @param p_temp Pointer to the temperature sensor structure
  */
-void fsm_thermostat_init(fsm_t *p_this, port_led_hw_t *p_led_heat, port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp)
+void fsm_thermostat_init(fsm_t *p_this, const port_led_hw_t *p_led_heat, const port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp)
 {
     fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)(p_this);
     fsm_init(p_this, fsm_trans_thermostat);
@@ -146,38 +364,251 @@ void fsm_thermostat_init(fsm_t *p_this, port_led_hw_t *p_led_heat, port_led_hw_t
     p_fsm->p_led_comfort = p_led_comfort;
     p_fsm->p_temp_sensor = p_temp;
 
-    // Initialize the last time the thermostat was activated
-    memset(p_fsm->last_time_events, 0, sizeof(p_fsm->last_time_events));
+    // Initialize the event history and the last time of each event
+    fsm_thermostat_history_t *p_history = &thermostat_history[p_fsm->zone];
+    memset(p_history, 0, sizeof(fsm_thermostat_history_t));
 
     // Initialize the thermostat status
-    memset(p_fsm->last_events, UNKNOWN, sizeof(p_fsm->last_events));
+    p_history->last_event = (uint8_t)UNKNOWN;
 
-    // Initialize the event index
-    p_fsm->event_idx = 0;
+    // Initialize the counters of transitions
+    memset(&thermostat_stats[p_fsm->zone], 0, sizeof(fsm_thermostat_stats_t));
 
-    // Initialize the threshold temperature
-    p_fsm->threshold_temp_celsius = THERMOSTAT_DEFAULT_THRESHOLD;
+    // Initialize the threshold temperature, the hysteresis band and the dwell times
+    fsm_thermostat_settings_t *p_settings = &thermostat_settings[p_fsm->zone];
+    p_settings->threshold_mcelsius = THERMOSTAT_DEFAULT_THRESHOLD_MCELSIUS;
+    p_settings->hysteresis_mcelsius = THERMOSTAT_DEFAULT_HYSTERESIS_MCELSIUS;
+    p_settings->min_on_ms = THERMOSTAT_DEFAULT_MIN_ON_MS;
+    p_settings->min_off_ms = THERMOSTAT_DEFAULT_MIN_OFF_MS;
+    _update_band(p_fsm);
+    p_fsm->state_since_ms = 0;
 
-    // Initialize the timer to measure the temperature
-    p_fsm->timer_period_sec = THERMOSTAT_TIMEOUT_SEC;
+    // The guards are evaluated when the first sample arrives
+    p_fsm->last_sample_seq = port_temp_sensor_get_sample_seq(p_temp);
+    p_fsm->inputs_changed = false;
+    p_fsm->adc_watchdog = false;
 
-    // Initialize the timer
-    port_thermostat_timer_setup(p_fsm);
+    // The first thermostat starts the measurements with the default settings. The next ones join the scan as it runs, so that the period and the low-power mode set before are kept
+    bool first = (thermostat_in_use == BIT_POS_TO_MASK(p_fsm->zone));
+    if (first)
+    {
+        thermostat_scan_settings.period_ms = THERMOSTAT_DEFAULT_PERIOD_MS;
+        thermostat_scan_settings.low_power = false;
+        port_thermostat_timer_setup(p_fsm, thermostat_scan_settings.period_ms);
+    }
 
     // Initialize the peripherals
     port_led_init(p_led_heat);
     port_led_init(p_led_comfort);    
     port_temp_sensor_init(p_temp);
+
+    // Configuring the scan again selects the trigger of the timer, but the RTC starts the measurements in low-power mode
+    if (thermostat_scan_settings.low_power)
+    {
+        port_temp_sensor_set_external_trigger(p_temp, false);
+    }
 }
 
 /* Create FSM */
-fsm_t *fsm_thermostat_new(port_led_hw_t *p_led_heat, port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp)
+fsm_t *fsm_thermostat_new(const port_led_hw_t *p_led_heat, const port_led_hw_t *p_led_comfort, port_temp_hw_t *p_temp)
+{
+    // Take the first free slot of the static pool. The whole FSM structure is reserved, although I interpret it as fsm_t which is the first field of the structure so that the FSM library can work with it
+    for (uint8_t zone = 0; zone < THERMOSTAT_POOL_SIZE; zone++)
+    {
+        if (!(thermostat_in_use & BIT_POS_TO_MASK(zone)))
+        {
+            thermostat_in_use |= BIT_POS_TO_MASK(zone);
+            if (zone >= thermostat_high_water)
+            {
+                thermostat_high_water = zone + 1;
+            }
+
+            fsm_thermostat_t *p_fsm = &thermostat_pool[zone];
+            p_fsm->zone = zone;
+
+            // Initialize the FSM
+            fsm_thermostat_init(&p_fsm->f, p_led_heat, p_led_comfort, p_temp);
+            return &p_fsm->f;
+        }
+    }
+    return NULL;
+}
+
+void fsm_thermostat_destroy(fsm_t *p_this)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    if (p_fsm->adc_watchdog)
+    {
+        port_temp_sensor_unwatch(p_fsm->p_temp_sensor);
+    }
+
+    // The sensor leaves the scan unless another thermostat still uses it
+    bool shared = false;
+    for (uint8_t zone = 0; zone < thermostat_high_water; zone++)
+    {
+        if ((zone != p_fsm->zone) && (thermostat_in_use & BIT_POS_TO_MASK(zone)) && (thermostat_pool[zone].p_temp_sensor == p_fsm->p_temp_sensor))
+        {
+            shared = true;
+        }
+    }
+    if (!shared)
+    {
+        port_temp_sensor_deinit(p_fsm->p_temp_sensor);
+    }
+    thermostat_in_use &= ~BIT_POS_TO_MASK(p_fsm->zone);
+}
+
+bool fsm_thermostat_fire(fsm_t *p_this)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+
+    // Skip the guards if none of their inputs has changed
+    uint32_t sample_seq = port_temp_sensor_get_sample_seq(p_fsm->p_temp_sensor);
+    if ((sample_seq == p_fsm->last_sample_seq) && !p_fsm->inputs_changed)
+    {
+        return false;
+    }
+    p_fsm->last_sample_seq = sample_seq;
+    p_fsm->inputs_changed = false;
+
+#ifdef USE_FSM_TABLE
+    fsm_thermostat_table_fire(p_this);
+#else
+    fsm_fire(p_this);
+#endif
+
+    // Sleep until the temperature crosses the threshold (again)
+    if (p_fsm->adc_watchdog)
+    {
+        _arm_adc_watchdog(p_fsm);
+    }
+    return true;
+}
+
+uint8_t fsm_thermostat_fire_all(void)
+{
+    uint8_t fired = 0;
+    for (uint8_t zone = 0; zone < thermostat_high_water; zone++)
+    {
+        if (thermostat_in_use & BIT_POS_TO_MASK(zone))
+        {
+            fired += fsm_thermostat_fire(&thermostat_pool[zone].f);
+        }
+    }
+    return fired;
+}
+
+void fsm_thermostat_set_threshold(fsm_t *p_this, int32_t threshold_mcelsius)
 {
-    // Do malloc for the whole FSM structure to reserve memory for the rest of the FSM, although I interpret it as fsm_t which is the first field of the structure so that the FSM library can work with it
-    fsm_t *p_fsm = malloc(sizeof(fsm_thermostat_t));
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    thermostat_settings[p_fsm->zone].threshold_mcelsius = threshold_mcelsius;
+    _update_band(p_fsm);
+}
 
-    // Initialize the FSM
-    fsm_thermostat_init(p_fsm, p_led_heat, p_led_comfort, p_temp);
+bool fsm_thermostat_set_period(fsm_t *p_this, uint32_t period_ms)
+{
+    // A period of 0 or longer than the timer can hold would wrap around in the prescaler and the auto-reload value
+    if ((period_ms == 0) || (period_ms > THERMOSTAT_PERIOD_MAX_MS))
+    {
+        return false;
+    }
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    thermostat_scan_settings.period_ms = period_ms;
+    port_thermostat_timer_set_period(p_fsm, period_ms, thermostat_scan_settings.low_power);
+    return true;
+}
 
-    return p_fsm;
+void fsm_thermostat_set_low_power(fsm_t *p_this, bool enable)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    thermostat_scan_settings.low_power = enable;
+    port_thermostat_set_low_power(p_fsm, thermostat_scan_settings.period_ms, enable);
+}
+
+uint32_t fsm_thermostat_get_period(fsm_t *p_this)
+{
+    return thermostat_scan_settings.period_ms;
+}
+
+void fsm_thermostat_set_hysteresis(fsm_t *p_this, uint32_t hysteresis_mcelsius)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    thermostat_settings[p_fsm->zone].hysteresis_mcelsius = hysteresis_mcelsius;
+    _update_band(p_fsm);
+}
+
+void fsm_thermostat_set_min_dwell(fsm_t *p_this, uint32_t min_on_ms, uint32_t min_off_ms)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    fsm_thermostat_settings_t *p_settings = &thermostat_settings[p_fsm->zone];
+    p_settings->min_on_ms = min_on_ms;
+    p_settings->min_off_ms = min_off_ms;
+}
+
+void fsm_thermostat_get_stats(fsm_t *p_this, fsm_thermostat_stats_t *p_stats)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    *p_stats = thermostat_stats[p_fsm->zone];
+}
+
+void fsm_thermostat_set_adc_watchdog(fsm_t *p_this, bool enable)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    p_fsm->adc_watchdog = enable;
+
+    // The watchdog is armed after the next evaluation, which is the next sample
+    if (!enable)
+    {
+        port_temp_sensor_unwatch(p_fsm->p_temp_sensor);
+    }
+}
+
+int32_t fsm_thermostat_get_threshold(fsm_t *p_this)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    return thermostat_settings[p_fsm->zone].threshold_mcelsius;
+}
+
+void fsm_thermostat_get_config(fsm_t *p_this, thermostat_config_t *p_config)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    const fsm_thermostat_settings_t *p_settings = &thermostat_settings[p_fsm->zone];
+    p_config->threshold_mcelsius = p_settings->threshold_mcelsius;
+    p_config->period_ms = thermostat_scan_settings.period_ms;
+    p_config->hysteresis_mcelsius = p_settings->hysteresis_mcelsius;
+    p_config->min_on_ms = p_settings->min_on_ms;
+    p_config->min_off_ms = p_settings->min_off_ms;
+}
+
+bool fsm_thermostat_set_config(fsm_t *p_this, const thermostat_config_t *p_config)
+{
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_this;
+    fsm_thermostat_settings_t *p_settings = &thermostat_settings[p_fsm->zone];
+
+    // Nothing is applied if the period is not valid
+    if ((p_config->period_ms == 0) || (p_config->period_ms > THERMOSTAT_PERIOD_MAX_MS))
+    {
+        return false;
+    }
+    p_settings->threshold_mcelsius = p_config->threshold_mcelsius;
+    p_settings->hysteresis_mcelsius = p_config->hysteresis_mcelsius;
+    _update_band(p_fsm);
+    fsm_thermostat_set_min_dwell(p_this, p_config->min_on_ms, p_config->min_off_ms);
+
+    // The timer is shared by all the thermostats, and it is only reconfigured if the period changes
+    if (p_config->period_ms != thermostat_scan_settings.period_ms)
+    {
+        return fsm_thermostat_set_period(p_this, p_config->period_ms);
+    }
+    return true;
+}
+
+uint8_t fsm_thermostat_get_count(void)
+{
+    uint8_t count = 0;
+    for (uint8_t zone = 0; zone < thermostat_high_water; zone++)
+    {
+        count += (thermostat_in_use >> zone) & 0x01U;
+    }
+    return count;
 }
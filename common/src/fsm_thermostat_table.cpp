@@ -0,0 +1,35 @@
+/**
+ * @file fsm_thermostat_table.cpp
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Dispatch of the thermostat FSM with the compile-time engine of `fsm_table.hpp`. It is built when `USE_FSM_TABLE` is set, and replaces `fsm_fire()` in `fsm_thermostat_fire()`.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Project includes */
+extern "C"
+{
+#include "fsm_thermostat.h"
+
+    /* Guards and actions of the thermostat, defined in fsm_thermostat.c */
+    bool check_heat(fsm_t *p_this);
+    bool check_comfort(fsm_t *p_this);
+    void do_thermostat_on(fsm_t *p_this);
+    void do_thermostat_off(fsm_t *p_this);
+}
+#include "fsm_table.hpp"
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Engine of the thermostat. Same transitions as `fsm_trans_thermostat[]`, which only sets the initial state.
+ */
+using fsm_thermostat_engine_t = fsm_table::engine<fsm_t, THERMOSTAT_ON + 1,
+                                                  fsm_table::transition<THERMOSTAT_OFF, check_heat, THERMOSTAT_ON, do_thermostat_on>,
+                                                  fsm_table::transition<THERMOSTAT_ON, check_comfort, THERMOSTAT_OFF, do_thermostat_off>>;
+
+/* Function definitions ------------------------------------------------------*/
+extern "C" int fsm_thermostat_table_fire(fsm_t *p_this)
+{
+    return fsm_thermostat_engine_t::fire(p_this, p_this->current_state) ? 1 : 0;
+}
@@ -0,0 +1,419 @@
+/**
+ * @file thermostat_cmd.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Command interface of the thermostat over the UART.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stddef.h>
+
+/* Project includes */
+#include "thermostat_cmd.h"
+#include "thermostat_config.h"
+#include "port_uart.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define THERMOSTAT_CMD_RX_MASK (PORT_UART_RX_SIZE - 1U)                                 /*!< Mask of the positions of the circular buffer of reception */
+#define THERMOSTAT_CMD_END_REPLY 6U                                                     /*!< Longest end of a reply: `error\n` */
+#define THERMOSTAT_CMD_STATUS_REPLY 112U                                                /*!< Longest line of the reply of `status` */
+#define THERMOSTAT_CMD_HISTORY_LINE 16U                                                 /*!< Longest line of the reply of `history`: 10 digits, ` off` and `\n` */
+#define THERMOSTAT_CMD_HISTORY_REPLY (THERMOSTAT_HISTORY * THERMOSTAT_CMD_HISTORY_LINE) /*!< Longest reply of `history`: each event takes at least one byte of the history */
+
+_Static_assert(THERMOSTAT_HISTORY <= UINT8_MAX, "The events of the history are counted in 8 bits");
+_Static_assert(THERMOSTAT_CMD_TX_SIZE >= THERMOSTAT_CMD_HISTORY_REPLY + THERMOSTAT_CMD_END_REPLY, "The buffer of the replies must hold the dump of a full history");
+_Static_assert(THERMOSTAT_CMD_MAX_LINE < PORT_UART_RX_SIZE, "A command line must fit in the circular buffer of reception");
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Cursor over a line of the circular buffer of reception. The line is read in place: it may wrap around the end of the buffer.
+ */
+typedef struct
+{
+    const volatile uint8_t *p_ring; /*!< Circular buffer of reception */
+    uint32_t pos;                   /*!< Position of the next byte to read */
+    uint32_t remaining;             /*!< Bytes of the line left to read */
+} thermostat_cmd_cursor_t;
+
+/**
+ * @brief Command of the interface.
+ */
+typedef struct
+{
+    const char *p_name;                               /*!< Name of the command: first word of the line */
+    uint32_t max_reply;                               /*!< Longest reply of the command before its end (`ok` or `error`) */
+    bool (*execute)(thermostat_cmd_cursor_t *p_args); /*!< Executes the command with the rest of the line and appends its reply. It returns false if the arguments are wrong */
+} thermostat_cmd_t;
+
+/* Global variables -----------------------------------------------------------*/
+static fsm_t *p_cmd_fsm = NULL;                   /*!< Thermostat controlled by the commands */
+static uint32_t rx_tail = 0;                      /*!< Position of the first byte of the next command line */
+static uint32_t rx_scan = 0;                      /*!< Position of the next byte to check for the end of a line */
+static uint8_t tx_buffer[THERMOSTAT_CMD_TX_SIZE]; /*!< Replies being composed or sent by the DMA */
+static uint32_t tx_length = 0;                    /*!< Bytes of the replies being composed */
+
+/* Private functions: parsing --------------------------------------------------*/
+/**
+ * @brief Gets the next byte of a line without consuming it.
+ *
+ * @param p_cursor Cursor over the line.
+ * @return uint8_t Next byte, or 0 at the end of the line.
+ */
+static uint8_t _peek(const thermostat_cmd_cursor_t *p_cursor)
+{
+    return (p_cursor->remaining > 0) ? p_cursor->p_ring[p_cursor->pos] : 0U;
+}
+
+/**
+ * @brief Consumes the next byte of a line.
+ *
+ * @param p_cursor Cursor over the line.
+ */
+static void _advance(thermostat_cmd_cursor_t *p_cursor)
+{
+    p_cursor->pos = (p_cursor->pos + 1U) & THERMOSTAT_CMD_RX_MASK;
+    p_cursor->remaining--;
+}
+
+/**
+ * @brief Consumes the spaces and tabs of a line up to the next word.
+ *
+ * @param p_cursor Cursor over the line.
+ */
+static void _skip_spaces(thermostat_cmd_cursor_t *p_cursor)
+{
+    while ((_peek(p_cursor) == ' ') || (_peek(p_cursor) == '\t'))
+    {
+        _advance(p_cursor);
+    }
+}
+
+/**
+ * @brief Consumes the next word of a line if it is the given one.
+ *
+ * @param p_cursor Cursor over the line.
+ * @param p_word Word to match.
+ * @return true if the next word is `p_word`. Otherwise, the cursor does not move.
+ */
+static bool _match_word(thermostat_cmd_cursor_t *p_cursor, const char *p_word)
+{
+    thermostat_cmd_cursor_t cursor = *p_cursor;
+    while (*p_word != '\0')
+    {
+        if ((cursor.remaining == 0) || (_peek(&cursor) != (uint8_t)*p_word))
+        {
+            return false;
+        }
+        _advance(&cursor);
+        p_word++;
+    }
+
+    // The word must end there
+    uint8_t next = _peek(&cursor);
+    if ((next != 0U) && (next != ' ') && (next != '\t'))
+    {
+        return false;
+    }
+    *p_cursor = cursor;
+    return true;
+}
+
+/**
+ * @brief Consumes a decimal integer of a line, with an optional sign.
+ *
+ * @param p_cursor Cursor over the line.
+ * @param p_value Pointer to store the number.
+ * @return true if there is a number that fits in 32 bits with sign, false otherwise.
+ */
+static bool _parse_int(thermostat_cmd_cursor_t *p_cursor, int32_t *p_value)
+{
+    _skip_spaces(p_cursor);
+    bool negative = (_peek(p_cursor) == '-');
+    if (negative || (_peek(p_cursor) == '+'))
+    {
+        _advance(p_cursor);
+    }
+
+    uint32_t limit = negative ? 0x80000000U : 0x7FFFFFFFU;
+    uint32_t magnitude = 0;
+    uint8_t digits = 0;
+    while ((_peek(p_cursor) >= '0') && (_peek(p_cursor) <= '9'))
+    {
+        uint32_t digit = (uint32_t)(_peek(p_cursor) - '0');
+        if (magnitude > (limit - digit) / 10U)
+        {
+            return false;
+        }
+        magnitude = magnitude * 10U + digit;
+        digits++;
+        _advance(p_cursor);
+    }
+    if (digits == 0)
+    {
+        return false;
+    }
+    *p_value = negative ? (int32_t)(0U - magnitude) : (int32_t)magnitude;
+    return true;
+}
+
+/**
+ * @brief Checks that nothing but spaces is left in a line.
+ *
+ * @param p_cursor Cursor over the line.
+ * @return true if the line has been fully read.
+ */
+static bool _at_end(thermostat_cmd_cursor_t *p_cursor)
+{
+    _skip_spaces(p_cursor);
+    return p_cursor->remaining == 0;
+}
+
+/* Private functions: replies ----------------------------------------------------*/
+/**
+ * @brief Appends a string to the replies.
+ *
+ * @param p_text String to append.
+ */
+static void _append(const char *p_text)
+{
+    while ((*p_text != '\0') && (tx_length < THERMOSTAT_CMD_TX_SIZE))
+    {
+        tx_buffer[tx_length++] = (uint8_t)*p_text++;
+    }
+}
+
+/**
+ * @brief Appends an unsigned number in decimal to the replies.
+ *
+ * @param value Number to append.
+ */
+static void _append_uint(uint32_t value)
+{
+    char digits[11];
+    uint8_t n = sizeof(digits) - 1U;
+    digits[n] = '\0';
+    do
+    {
+        digits[--n] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value > 0);
+    _append(&digits[n]);
+}
+
+/**
+ * @brief Appends a signed number in decimal to the replies.
+ *
+ * @param value Number to append.
+ */
+static void _append_int(int32_t value)
+{
+    if (value < 0)
+    {
+        _append("-");
+        _append_uint(0U - (uint32_t)value);
+    }
+    else
+    {
+        _append_uint((uint32_t)value);
+    }
+}
+
+/* Private functions: commands ---------------------------------------------------*/
+/**
+ * @brief Command `threshold <m°C>`.
+ *
+ * @param p_args Arguments of the command.
+ * @return true if the threshold has been set.
+ */
+static bool _cmd_threshold(thermostat_cmd_cursor_t *p_args)
+{
+    int32_t threshold_mcelsius;
+    if (!_parse_int(p_args, &threshold_mcelsius) || !_at_end(p_args))
+    {
+        return false;
+    }
+    fsm_thermostat_set_threshold(p_cmd_fsm, threshold_mcelsius);
+    return true;
+}
+
+/**
+ * @brief Command `period <ms>`.
+ *
+ * @param p_args Arguments of the command.
+ * @return true if the period has been set.
+ */
+static bool _cmd_period(thermostat_cmd_cursor_t *p_args)
+{
+    int32_t period_ms;
+    if (!_parse_int(p_args, &period_ms) || !_at_end(p_args) || (period_ms <= 0))
+    {
+        return false;
+    }
+    return fsm_thermostat_set_period(p_cmd_fsm, (uint32_t)period_ms);
+}
+
+/**
+ * @brief Command `status`.
+ *
+ * @param p_args Arguments of the command.
+ * @return true if there are no arguments.
+ */
+static bool _cmd_status(thermostat_cmd_cursor_t *p_args)
+{
+    if (!_at_end(p_args))
+    {
+        return false;
+    }
+    fsm_thermostat_t *p_fsm = (fsm_thermostat_t *)p_cmd_fsm;
+    fsm_thermostat_stats_t stats;
+    fsm_thermostat_get_stats(p_cmd_fsm, &stats);
+
+    _append((p_fsm->f.current_state == THERMOSTAT_ON) ? "state=on" : "state=off");
+    _append(" temperature=");
+    _append_int(port_temp_sensor_get_temperature_mcelsius(p_fsm->p_temp_sensor));
+    _append(" threshold=");
+    _append_int(fsm_thermostat_get_threshold(p_cmd_fsm));
+    _append(" period=");
+    _append_uint(fsm_thermostat_get_period(p_cmd_fsm));
+    _append(" transitions=");
+    _append_uint(stats.transitions);
+    _append("\n");
+    return true;
+}
+
+/**
+ * @brief Command `history`: all the events of the history in one reply.
+ *
+ * @param p_args Arguments of the command.
+ * @return true if there are no arguments.
+ */
+static bool _cmd_history(thermostat_cmd_cursor_t *p_args)
+{
+    if (!_at_end(p_args))
+    {
+        return false;
+    }
+    uint8_t events[THERMOSTAT_HISTORY];
+    uint32_t times[THERMOSTAT_HISTORY];
+    uint8_t n_events = fsm_thermostat_get_history(p_cmd_fsm, events, times, THERMOSTAT_HISTORY);
+    for (uint8_t i = 0; i < n_events; i++)
+    {
+        _append_uint(times[i]);
+        _append((events[i] == ACTIVATION) ? " on\n" : " off\n");
+    }
+    return true;
+}
+
+/**
+ * @brief Command `save`: the configuration of the thermostat is stored in flash.
+ *
+ * @param p_args Arguments of the command.
+ * @return true if the configuration has been stored.
+ */
+static bool _cmd_save(thermostat_cmd_cursor_t *p_args)
+{
+    if (!_at_end(p_args))
+    {
+        return false;
+    }
+    thermostat_config_t config;
+    fsm_thermostat_get_config(p_cmd_fsm, &config);
+    return thermostat_config_save(&config);
+}
+
+static const thermostat_cmd_t commands[] = {
+    {"threshold", 0U, _cmd_threshold},
+    {"period", 0U, _cmd_period},
+    {"status", THERMOSTAT_CMD_STATUS_REPLY, _cmd_status},
+    {"history", THERMOSTAT_CMD_HISTORY_REPLY, _cmd_history},
+    {"save", 0U, _cmd_save},
+}; /*!< Commands of the interface */
+
+/**
+ * @brief Finds the command of a line and consumes its name.
+ *
+ * @param p_line Cursor over the line.
+ * @return const thermostat_cmd_t* Command, or NULL if the first word of the line is not a command.
+ */
+static const thermostat_cmd_t *_find_command(thermostat_cmd_cursor_t *p_line)
+{
+    _skip_spaces(p_line);
+    for (uint8_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+    {
+        if (_match_word(p_line, commands[i].p_name))
+        {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+/* Function definitions ------------------------------------------------------*/
+void thermostat_cmd_init(fsm_t *p_fsm)
+{
+    p_cmd_fsm = p_fsm;
+    port_uart_init();
+    rx_tail = port_uart_get_rx_head();
+    rx_scan = rx_tail;
+    tx_length = 0;
+}
+
+uint32_t thermostat_cmd_process(void)
+{
+    // The buffer of the replies is still being sent: the commands wait in the buffer of reception
+    if (port_uart_tx_busy())
+    {
+        return 0;
+    }
+
+    const volatile uint8_t *p_ring = port_uart_get_rx_buffer();
+    uint32_t head = port_uart_get_rx_head();
+    uint32_t executed = 0;
+    bool full = false;
+    tx_length = 0;
+
+    while (rx_scan != head)
+    {
+        uint8_t byte = p_ring[rx_scan];
+        if ((byte != '\n') && (byte != '\r'))
+        {
+            rx_scan = (rx_scan + 1U) & THERMOSTAT_CMD_RX_MASK;
+            continue;
+        }
+
+        // A complete line between the tail and the end of line. Empty lines (e.g., the `\n` of `\r\n`) are skipped
+        thermostat_cmd_cursor_t line = {.p_ring = p_ring, .pos = rx_tail, .remaining = (rx_scan - rx_tail) & THERMOSTAT_CMD_RX_MASK};
+        if (!_at_end(&line))
+        {
+            const thermostat_cmd_t *p_command = _find_command(&line);
+            uint32_t max_reply = ((p_command != NULL) ? p_command->max_reply : 0U) + THERMOSTAT_CMD_END_REPLY;
+            if (tx_length + max_reply > THERMOSTAT_CMD_TX_SIZE)
+            {
+                // No room for the reply: the line is executed after this transfer
+                full = true;
+                break;
+            }
+            bool ok = (p_command != NULL) && p_command->execute(&line);
+            _append(ok ? "ok\n" : "error\n");
+            executed++;
+        }
+        rx_scan = (rx_scan + 1U) & THERMOSTAT_CMD_RX_MASK;
+        rx_tail = rx_scan;
+    }
+
+    // A line too long to be a command: discard what has been received of it
+    if (!full && (((rx_scan - rx_tail) & THERMOSTAT_CMD_RX_MASK) > THERMOSTAT_CMD_MAX_LINE))
+    {
+        rx_tail = rx_scan;
+        _append("error\n");
+    }
+
+    // All the replies in one transfer
+    if (tx_length > 0)
+    {
+        port_uart_send(tx_buffer, tx_length);
+    }
+    return executed;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file thermostat_config.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Persistent configuration of the thermostat: log of records in a sector of flash.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <string.h>
+
+/* Project includes */
+#include "thermostat_config.h"
+#include "port_flash.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define THERMOSTAT_CONFIG_SLOTS (PORT_FLASH_SECTOR_SIZE / THERMOSTAT_CONFIG_RECORD_BYTES) /*!< Records that fit in the sector */
+#define THERMOSTAT_CONFIG_WORD_HEADER 0U                                                /*!< Index of the header in a record */
+#define THERMOSTAT_CONFIG_WORD_SEQ 1U                                                   /*!< Index of the sequence number in a record */
+#define THERMOSTAT_CONFIG_WORD_CONFIG 2U                                                /*!< Index of the first word of the configuration in a record */
+#define THERMOSTAT_CONFIG_WORD_CRC (THERMOSTAT_CONFIG_RECORD_WORDS - 1U)                /*!< Index of the CRC-32 in a record: it covers the previous words */
+
+_Static_assert(sizeof(thermostat_config_t) == (THERMOSTAT_CONFIG_RECORD_WORDS - 3U) * sizeof(uint32_t), "The configuration must fill the record between the sequence number and the CRC");
+_Static_assert(THERMOSTAT_CONFIG_HEADER != PORT_FLASH_ERASED_WORD, "The header marks the used records");
+_Static_assert(THERMOSTAT_CONFIG_SLOTS > THERMOSTAT_CONFIG_MAX_BACKTRACK, "The sector must hold several records");
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief State of the log in RAM.
+ */
+typedef struct
+{
+    uint32_t next_slot;         /*!< First free record of the sector */
+    uint32_t seq;               /*!< Sequence number of the newest valid record, or 0 if there is none */
+    uint32_t erases;            /*!< Erases of the sector since the boot */
+    thermostat_config_t config; /*!< Configuration of the newest valid record */
+} thermostat_config_log_t;
+
+/* Global variables -----------------------------------------------------------*/
+static thermostat_config_log_t config_log; /*!< State of the log */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of words, least significant byte first. A table of 16 entries is used: 2 steps per byte.
+ *
+ * @param p_words Words to check.
+ * @param n_words Number of words.
+ * @return uint32_t CRC-32 of the words.
+ */
+static uint32_t _crc32(const uint32_t *p_words, uint32_t n_words)
+{
+    static const uint32_t nibble_table[16] = {
+        0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+        0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU};
+    uint32_t crc = 0xFFFFFFFFU;
+    for (uint32_t i = 0; i < n_words; i++)
+    {
+        uint32_t word = p_words[i];
+        for (uint8_t nibble = 0; nibble < 8; nibble++)
+        {
+            crc = (crc >> 4) ^ nibble_table[(crc ^ word) & 0x0FU];
+            word >>= 4;
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Checks if a record of the sector has been written. Only its first word is read.
+ *
+ * @param slot Index of the record.
+ * @return true if the record is used (valid or not), false if it is erased.
+ */
+static bool _slot_used(uint32_t slot)
+{
+    uint32_t header;
+    port_flash_read(slot * THERMOSTAT_CONFIG_RECORD_BYTES, &header, 1);
+    return header != PORT_FLASH_ERASED_WORD;
+}
+
+/**
+ * @brief Reads a record of the sector and checks it.
+ *
+ * @param slot Index of the record.
+ * @param p_record Array of `THERMOSTAT_CONFIG_RECORD_WORDS` words to store the record.
+ * @return true if the record is valid: right header and CRC-32.
+ */
+static bool _read_record(uint32_t slot, uint32_t *p_record)
+{
+    port_flash_read(slot * THERMOSTAT_CONFIG_RECORD_BYTES, p_record, THERMOSTAT_CONFIG_RECORD_WORDS);
+    return (p_record[THERMOSTAT_CONFIG_WORD_HEADER] == THERMOSTAT_CONFIG_HEADER) && (p_record[THERMOSTAT_CONFIG_WORD_CRC] == _crc32(p_record, THERMOSTAT_CONFIG_WORD_CRC));
+}
+
+/* Function definitions ------------------------------------------------------*/
+void thermostat_config_init(void)
+{
+    memset(&config_log, 0, sizeof(config_log));
+
+    // The used records are a prefix of the sector: binary search of the first erased one
+    uint32_t low = 0;
+    uint32_t high = THERMOSTAT_CONFIG_SLOTS;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2U;
+        if (_slot_used(mid))
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    config_log.next_slot = low;
+
+    // The newest valid record is one of the last ones: only a reset in the middle of a write leaves an invalid record
+    uint32_t record[THERMOSTAT_CONFIG_RECORD_WORDS];
+    for (uint32_t back = 1; (back <= THERMOSTAT_CONFIG_MAX_BACKTRACK) && (back <= low); back++)
+    {
+        if (_read_record(low - back, record))
+        {
+            config_log.seq = record[THERMOSTAT_CONFIG_WORD_SEQ];
+            memcpy(&config_log.config, &record[THERMOSTAT_CONFIG_WORD_CONFIG], sizeof(thermostat_config_t));
+            return;
+        }
+    }
+}
+
+bool thermostat_config_load(thermostat_config_t *p_config)
+{
+    if (config_log.seq == 0)
+    {
+        return false;
+    }
+    *p_config = config_log.config;
+    return true;
+}
+
+bool thermostat_config_save(const thermostat_config_t *p_config)
+{
+    // Wear: an update that changes nothing is not written
+    if ((config_log.seq != 0) && (memcmp(&config_log.config, p_config, sizeof(thermostat_config_t)) == 0))
+    {
+        return true;
+    }
+
+    // Erase only when the sector is full. The newest configuration is kept in RAM and written right after
+    if (config_log.next_slot >= THERMOSTAT_CONFIG_SLOTS)
+    {
+        if (!port_flash_erase())
+        {
+            return false;
+        }
+        config_log.next_slot = 0;
+        config_log.erases++;
+    }
+
+    uint32_t record[THERMOSTAT_CONFIG_RECORD_WORDS];
+    record[THERMOSTAT_CONFIG_WORD_HEADER] = THERMOSTAT_CONFIG_HEADER;
+    record[THERMOSTAT_CONFIG_WORD_SEQ] = config_log.seq + 1U;
+    memcpy(&record[THERMOSTAT_CONFIG_WORD_CONFIG], p_config, sizeof(thermostat_config_t));
+    record[THERMOSTAT_CONFIG_WORD_CRC] = _crc32(record, THERMOSTAT_CONFIG_WORD_CRC);
+
+    // The record is used from its first word on, even if the write fails: the next one goes after it
+    uint32_t slot = config_log.next_slot++;
+    if (!port_flash_program(slot * THERMOSTAT_CONFIG_RECORD_BYTES, record, THERMOSTAT_CONFIG_RECORD_WORDS))
+    {
+        return false;
+    }
+    config_log.seq = record[THERMOSTAT_CONFIG_WORD_SEQ];
+    config_log.config = *p_config;
+    return true;
+}
+
+void thermostat_config_get_stats(thermostat_config_stats_t *p_stats)
+{
+    p_stats->slots = THERMOSTAT_CONFIG_SLOTS;
+    p_stats->used_slots = config_log.next_slot;
+    p_stats->seq = config_log.seq;
+    p_stats->erases = config_log.erases;
+}
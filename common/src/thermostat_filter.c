@@ -0,0 +1,151 @@
+/**
+ * @file thermostat_filter.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Filters of the measurements of the temperature sensors.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "thermostat_filter.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define THERMOSTAT_FILTER_MAX_AVERAGE_SHIFT 4U /*!< log2(`THERMOSTAT_FILTER_MAX_WINDOW`) */
+
+_Static_assert((1U << THERMOSTAT_FILTER_MAX_AVERAGE_SHIFT) == THERMOSTAT_FILTER_MAX_WINDOW, "The window of the moving average must be a power of 2");
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Fills the window with the first sample, so that the filter has no transient.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param counts First sample.
+ */
+static void _prime(thermostat_filter_t *p_filter, uint16_t counts)
+{
+    for (uint8_t i = 0; i < p_filter->window; i++)
+    {
+        p_filter->ring[i] = counts;
+        p_filter->sorted[i] = counts;
+    }
+    p_filter->index = 0;
+    p_filter->acc = (p_filter->type == THERMOSTAT_FILTER_EMA) ? ((uint32_t)counts << THERMOSTAT_FILTER_EMA_FRACTION_BITS) : ((uint32_t)counts << p_filter->shift);
+    p_filter->primed = true;
+}
+
+/**
+ * @brief Replaces the oldest sample of the window by a new one.
+ *
+ * @param p_filter Pointer to the filter.
+ * @param counts New sample.
+ * @return uint16_t Oldest sample, which leaves the window.
+ */
+static uint16_t _push(thermostat_filter_t *p_filter, uint16_t counts)
+{
+    uint16_t oldest = p_filter->ring[p_filter->index];
+    p_filter->ring[p_filter->index] = counts;
+    p_filter->index = (p_filter->index + 1U == p_filter->window) ? 0 : p_filter->index + 1U;
+    return oldest;
+}
+
+/* Function definitions ------------------------------------------------------*/
+void thermostat_filter_init_ema(thermostat_filter_t *p_filter, uint8_t shift)
+{
+    p_filter->type = THERMOSTAT_FILTER_EMA;
+    p_filter->shift = (shift > THERMOSTAT_FILTER_MAX_EMA_SHIFT) ? THERMOSTAT_FILTER_MAX_EMA_SHIFT : shift;
+    p_filter->window = 0;
+    thermostat_filter_reset(p_filter);
+}
+
+void thermostat_filter_init_moving_average(thermostat_filter_t *p_filter, uint8_t shift)
+{
+    p_filter->type = THERMOSTAT_FILTER_MOVING_AVERAGE;
+    p_filter->shift = (shift > THERMOSTAT_FILTER_MAX_AVERAGE_SHIFT) ? THERMOSTAT_FILTER_MAX_AVERAGE_SHIFT : shift;
+    p_filter->window = (uint8_t)(1U << p_filter->shift);
+    thermostat_filter_reset(p_filter);
+}
+
+void thermostat_filter_init_median(thermostat_filter_t *p_filter, uint8_t window)
+{
+    if (window >= THERMOSTAT_FILTER_MAX_WINDOW)
+    {
+        window = THERMOSTAT_FILTER_MAX_WINDOW - 1U;
+    }
+    if ((window % 2U) == 0)
+    {
+        window = (window == 0) ? 1U : window - 1U;
+    }
+    p_filter->type = THERMOSTAT_FILTER_MEDIAN;
+    p_filter->shift = 0;
+    p_filter->window = window;
+    thermostat_filter_reset(p_filter);
+}
+
+void thermostat_filter_reset(thermostat_filter_t *p_filter)
+{
+    p_filter->primed = false;
+    p_filter->index = 0;
+    p_filter->acc = 0;
+}
+
+uint32_t thermostat_filter_update(thermostat_filter_t *p_filter, uint32_t counts)
+{
+    uint16_t sample = (counts > UINT16_MAX) ? UINT16_MAX : (uint16_t)counts;
+    if (p_filter->type == THERMOSTAT_FILTER_NONE)
+    {
+        return counts;
+    }
+    if (!p_filter->primed)
+    {
+        _prime(p_filter, sample);
+        return sample;
+    }
+
+    switch (p_filter->type)
+    {
+    case THERMOSTAT_FILTER_EMA:
+    {
+        // The accumulator has fractional bits, so that the steps smaller than 2^shift counts still move the output. The arithmetic shift of a negative difference rounds towards minus infinity, so the output converges to the input from both sides
+        int32_t diff = (int32_t)((uint32_t)sample << THERMOSTAT_FILTER_EMA_FRACTION_BITS) - (int32_t)p_filter->acc;
+        p_filter->acc = (uint32_t)((int32_t)p_filter->acc + (diff >> p_filter->shift));
+        return (p_filter->acc + (1U << (THERMOSTAT_FILTER_EMA_FRACTION_BITS - 1U))) >> THERMOSTAT_FILTER_EMA_FRACTION_BITS;
+    }
+    case THERMOSTAT_FILTER_MOVING_AVERAGE:
+    {
+        // The running sum is updated with the sample that enters and the one that leaves the window
+        p_filter->acc += sample;
+        p_filter->acc -= _push(p_filter, sample);
+        return (p_filter->acc + ((1U << p_filter->shift) >> 1)) >> p_filter->shift;
+    }
+    case THERMOSTAT_FILTER_MEDIAN:
+    {
+        // The new sample takes the place of the oldest one in the sorted window, and slides to its position: no full sort
+        uint16_t oldest = _push(p_filter, sample);
+        uint8_t j = 0;
+        while (p_filter->sorted[j] != oldest)
+        {
+            j++;
+        }
+        if (sample > oldest)
+        {
+            while ((j + 1U < p_filter->window) && (p_filter->sorted[j + 1U] < sample))
+            {
+                p_filter->sorted[j] = p_filter->sorted[j + 1U];
+                j++;
+            }
+        }
+        else
+        {
+            while ((j > 0) && (p_filter->sorted[j - 1U] > sample))
+            {
+                p_filter->sorted[j] = p_filter->sorted[j - 1U];
+                j--;
+            }
+        }
+        p_filter->sorted[j] = sample;
+        return p_filter->sorted[p_filter->window / 2U];
+    }
+    default:
+        return counts;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file thermostat_log.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Lock-free log of the thermostat.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdatomic.h>
+
+/* Project includes */
+#include "thermostat_log.h"
+#include "thermostat_telemetry.h"
+#include "port_system.h"
+
+_Static_assert((THERMOSTAT_LOG_SIZE & (THERMOSTAT_LOG_SIZE - 1)) == 0, "The size of the log must be a power of 2");
+
+/* Global variables -----------------------------------------------------------*/
+static thermostat_log_record_t log_ring[THERMOSTAT_LOG_SIZE]; /*!< Ring of records */
+static volatile uint32_t log_head = 0;                        /*!< Free-running index of the next record to write. Only written by the producer */
+static volatile uint32_t log_tail = 0;                        /*!< Free-running index of the next record to read. Only written by the consumer */
+static volatile uint32_t log_dropped = 0;                     /*!< Number of dropped records. Only written by the producer */
+static uint32_t log_dropped_reported = 0;                     /*!< Number of dropped records already reported by the consumer */
+
+/* Function definitions ------------------------------------------------------*/
+bool thermostat_log_push(uint16_t code, uint8_t source, int32_t arg)
+{
+    uint32_t head = log_head;
+    if ((head - log_tail) >= THERMOSTAT_LOG_SIZE)
+    {
+        log_dropped++;
+        return false;
+    }
+
+    thermostat_log_record_t *p_record = &log_ring[head & (THERMOSTAT_LOG_SIZE - 1)];
+    p_record->timestamp_ms = port_system_get_millis();
+    p_record->code = code;
+    p_record->source = source;
+    p_record->arg = arg;
+
+    // The record must be complete before the consumer sees the new head
+    atomic_signal_fence(memory_order_release);
+    log_head = head + 1;
+    return true;
+}
+
+bool thermostat_log_pop(thermostat_log_record_t *p_record)
+{
+    uint32_t tail = log_tail;
+    if (tail == log_head)
+    {
+        return false;
+    }
+
+    // Do not read the record before the head that published it
+    atomic_signal_fence(memory_order_acquire);
+    *p_record = log_ring[tail & (THERMOSTAT_LOG_SIZE - 1)];
+
+    // The record must be copied before the producer can overwrite it
+    atomic_signal_fence(memory_order_release);
+    log_tail = tail + 1;
+    return true;
+}
+
+uint32_t thermostat_log_drain(void)
+{
+    thermostat_log_record_t record;
+    uint32_t count = 0;
+
+    while (thermostat_log_pop(&record))
+    {
+        if (record.code == THERMOSTAT_LOG_TEMPERATURE)
+        {
+            thermostat_telemetry_sample(record.source, record.timestamp_ms, record.arg);
+        }
+        count++;
+    }
+
+    uint32_t dropped = log_dropped;
+    if (dropped != log_dropped_reported)
+    {
+        thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_LOG_DROPPED, port_system_get_millis(), dropped);
+        log_dropped_reported = dropped;
+    }
+    return count;
+}
+
+uint32_t thermostat_log_get_dropped(void)
+{
+    return log_dropped;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file thermostat_profile.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Cycle profiler of the thermostat.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+/* Project includes */
+#include "thermostat_profile.h"
+#include "port_system.h"
+
+/* Global variables -----------------------------------------------------------*/
+static thermostat_profile_stats_t profile_stats[THERMOSTAT_PROFILE_REGIONS_COUNT]; /*!< Statistics of each region. Each one is only written by the context of its region */
+
+static const char *const profile_names[THERMOSTAT_PROFILE_REGIONS_COUNT] = {
+    [THERMOSTAT_PROFILE_TIMEBASE_ISR] = "timebase_isr",
+    [THERMOSTAT_PROFILE_DMA_ISR] = "dma_isr",
+    [THERMOSTAT_PROFILE_ADC_ISR] = "adc_isr",
+    [THERMOSTAT_PROFILE_RTC_ISR] = "rtc_isr",
+    [THERMOSTAT_PROFILE_UART_ISR] = "uart_isr",
+    [THERMOSTAT_PROFILE_FSM_FIRE] = "fsm_fire",
+    [THERMOSTAT_PROFILE_LOG_DRAIN] = "log_drain",
+    [THERMOSTAT_PROFILE_CMD] = "cmd",
+}; /*!< Names of the regions in the dump */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Formats a line and writes it to the text output of the trace, apart from the frames of the telemetry.
+ *
+ * @param p_format Format of `printf()`.
+ */
+static void _trace_printf(const char *p_format, ...) __attribute__((format(printf, 1, 2)));
+
+static void _trace_printf(const char *p_format, ...)
+{
+    char line[96];
+    va_list args;
+    va_start(args, p_format);
+    int len = vsnprintf(line, sizeof(line), p_format, args);
+    va_end(args);
+    if (len > 0)
+    {
+        port_system_trace_write_text(line, ((size_t)len < sizeof(line)) ? (uint32_t)len : (uint32_t)(sizeof(line) - 1U));
+    }
+}
+
+/* Function definitions ------------------------------------------------------*/
+uint8_t thermostat_profile_bucket(uint32_t cycles)
+{
+    return (cycles > 1U) ? (uint8_t)(31 - __builtin_clz(cycles)) : 0U;
+}
+
+void thermostat_profile_record(uint8_t region, uint32_t cycles)
+{
+    if (region >= THERMOSTAT_PROFILE_REGIONS_COUNT)
+    {
+        return;
+    }
+
+    thermostat_profile_stats_t *p_stats = &profile_stats[region];
+    if ((p_stats->count == 0) || (cycles < p_stats->min_cycles))
+    {
+        p_stats->min_cycles = cycles;
+    }
+    if (cycles > p_stats->max_cycles)
+    {
+        p_stats->max_cycles = cycles;
+    }
+    p_stats->total_cycles += cycles;
+    p_stats->histogram[thermostat_profile_bucket(cycles)]++;
+    p_stats->count++;
+}
+
+bool thermostat_profile_get_stats(uint8_t region, thermostat_profile_stats_t *p_stats)
+{
+    if (region >= THERMOSTAT_PROFILE_REGIONS_COUNT)
+    {
+        return false;
+    }
+    *p_stats = profile_stats[region];
+    return true;
+}
+
+void thermostat_profile_reset(void)
+{
+    memset(profile_stats, 0, sizeof(profile_stats));
+}
+
+uint32_t thermostat_profile_dump(void)
+{
+    uint32_t regions = 0;
+    for (uint8_t region = 0; region < THERMOSTAT_PROFILE_REGIONS_COUNT; region++)
+    {
+        // Copy the statistics first: the ISRs may update them while they are written
+        thermostat_profile_stats_t stats = profile_stats[region];
+        if (stats.count == 0)
+        {
+            continue;
+        }
+
+        _trace_printf("%s: n=%" PRIu32 " min=%" PRIu32 " mean=%" PRIu32 " max=%" PRIu32 " cycles\n", profile_names[region], stats.count, stats.min_cycles, (uint32_t)(stats.total_cycles / stats.count), stats.max_cycles);
+        for (uint8_t k = 0; k < THERMOSTAT_PROFILE_BUCKETS; k++)
+        {
+            if (stats.histogram[k] != 0)
+            {
+                _trace_printf("  [%" PRIu32 ", %" PRIu64 "): %" PRIu32 "\n", (k == 0U) ? 0U : ((uint32_t)1U << k), (uint64_t)1U << (k + 1U), stats.histogram[k]);
+            }
+        }
+        regions++;
+    }
+    return regions;
+}
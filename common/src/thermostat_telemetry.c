@@ -0,0 +1,459 @@
+/**
+ * @file thermostat_telemetry.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Binary telemetry stream of the thermostat and its decoder.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <string.h>
+
+/* Project includes */
+#include "thermostat_telemetry.h"
+#include "fsm_thermostat.h"
+#include "port_system.h"
+#include "port_temp_sensor.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define TELEMETRY_TYPE_POS 6U     /*!< Tag byte: position of the type of the record */
+#define TELEMETRY_FLAG_BIT 0x20U  /*!< Tag byte: event of a transition, or sample at the predicted time */
+#define TELEMETRY_ID_MASK 0x1FU   /*!< Tag byte: mask of the sensor, zone or counter */
+#define TELEMETRY_MORE_BIT 0x80U  /*!< Variable-length number: more bytes follow */
+
+_Static_assert(THERMOSTAT_TELEMETRY_FRAME_SIZE >= (6U + THERMOSTAT_TELEMETRY_MAX_RECORD_BYTES + 1U), "A frame must hold its header, the longest record and the CRC");
+_Static_assert(THERMOSTAT_TELEMETRY_FRAME_SIZE <= 254U, "A frame must be COBS-encoded with a single code byte");
+_Static_assert(THERMOSTAT_TELEMETRY_MAX_IDS == (TELEMETRY_ID_MASK + 1U), "The ids must fit in the tag byte");
+_Static_assert(THERMOSTAT_POOL_SIZE <= THERMOSTAT_TELEMETRY_MAX_IDS, "The zone of a transition must fit in the tag byte");
+_Static_assert(TEMP_SENSOR_SCAN_MAX_SENSORS <= THERMOSTAT_TELEMETRY_MAX_SENSORS, "The previous sample of each sensor must be kept");
+
+/* Global variables -----------------------------------------------------------*/
+static uint8_t telemetry_frame[THERMOSTAT_TELEMETRY_FRAME_SIZE + THERMOSTAT_TELEMETRY_MAX_RECORD_BYTES]; /*!< Frame being filled, and room to encode a record in place before checking that it fits */
+static uint32_t telemetry_length = 0;                                                                    /*!< Bytes of the frame being filled, or 0 if it has no record */
+static uint32_t telemetry_last_ms = 0;                                                                   /*!< Time of the last record of the frame */
+static thermostat_telemetry_frame_state_t telemetry_state;                                               /*!< State of the frame being filled */
+static thermostat_telemetry_output_t telemetry_output = NULL;                                            /*!< Output of the frames, or NULL for the trace output */
+
+/**
+ * @brief CRC-8 (polynomial 0x07) of a nibble, to compute the CRC of a byte in two lookups.
+ */
+static const uint8_t crc8_nibble[16] = {0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D};
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Computes the CRC-8 (polynomial 0x07, initial value 0) of some bytes.
+ */
+static uint8_t _crc8(const uint8_t *p_data, uint32_t length)
+{
+    uint8_t crc = 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= p_data[i];
+        crc = (uint8_t)(crc << 4) ^ crc8_nibble[crc >> 4];
+        crc = (uint8_t)(crc << 4) ^ crc8_nibble[crc >> 4];
+    }
+    return crc;
+}
+
+/**
+ * @brief Encodes a variable-length number: 7 bits per byte, LSBs first.
+ *
+ * @param p_out Buffer for the bytes.
+ * @param value Number to encode.
+ * @return uint8_t Number of bytes (1 to 5).
+ */
+static uint8_t _put_varint(uint8_t *p_out, uint32_t value)
+{
+    uint8_t n = 0;
+    while (value >= TELEMETRY_MORE_BIT)
+    {
+        p_out[n++] = (uint8_t)(value | TELEMETRY_MORE_BIT);
+        value >>= 7;
+    }
+    p_out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief Decodes a variable-length number.
+ *
+ * @param p_in Bytes of the number.
+ * @param available Bytes that can be read.
+ * @param p_value Pointer to store the number.
+ * @return uint8_t Number of bytes read, or 0 if the number is truncated.
+ */
+static uint8_t _get_varint(const uint8_t *p_in, uint32_t available, uint32_t *p_value)
+{
+    uint32_t value = 0;
+    for (uint8_t n = 0; (n < 5U) && (n < available); n++)
+    {
+        value |= (uint32_t)(p_in[n] & ~TELEMETRY_MORE_BIT) << (7U * n);
+        if (!(p_in[n] & TELEMETRY_MORE_BIT))
+        {
+            *p_value = value;
+            return n + 1U;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a signed number to an unsigned one with the smallest magnitudes first: 0, -1, 1, -2...
+ */
+static uint32_t _zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Inverse of `_zigzag()`.
+ */
+static int32_t _unzigzag(uint32_t value)
+{
+    return (int32_t)((value >> 1) ^ (0U - (value & 1U)));
+}
+
+/**
+ * @brief Encodes a record against the state of a frame, without changing it.
+ *
+ * @param p_state State of the frame.
+ * @param p_out Buffer for the bytes (`THERMOSTAT_TELEMETRY_MAX_RECORD_BYTES`).
+ * @param tag Tag byte of the record.
+ * @param time_ms Time of the record. It must not be before the base time of the frame.
+ * @param value Value of the record.
+ * @return uint8_t Bytes of the record.
+ */
+static uint8_t _encode(const thermostat_telemetry_frame_state_t *p_state, uint8_t *p_out, uint8_t tag, uint32_t time_ms, int32_t value)
+{
+    uint8_t n = 0;
+    p_out[n++] = tag;
+    switch (tag >> TELEMETRY_TYPE_POS)
+    {
+    case THERMOSTAT_TELEMETRY_SAMPLE:
+    {
+        uint8_t sensor = tag & (THERMOSTAT_TELEMETRY_MAX_SENSORS - 1U);
+        if (p_state->sensors & (1U << sensor))
+        {
+            // A periodic sample is on time: the flag replaces its time
+            uint32_t predicted_ms = p_state->sample_ms[sensor] + p_state->period_ms[sensor];
+            if (time_ms == predicted_ms)
+            {
+                p_out[0] |= TELEMETRY_FLAG_BIT;
+            }
+            else
+            {
+                n += _put_varint(&p_out[n], _zigzag((int32_t)(time_ms - predicted_ms)));
+            }
+            n += _put_varint(&p_out[n], _zigzag((int32_t)((uint32_t)value - (uint32_t)p_state->mcelsius[sensor])));
+        }
+        else
+        {
+            n += _put_varint(&p_out[n], _zigzag((int32_t)(time_ms - p_state->base_ms)));
+            n += _put_varint(&p_out[n], _zigzag(value));
+        }
+        break;
+    }
+    case THERMOSTAT_TELEMETRY_COUNTER:
+        n += _put_varint(&p_out[n], time_ms - p_state->base_ms);
+        n += _put_varint(&p_out[n], (uint32_t)value);
+        break;
+    default:
+        n += _put_varint(&p_out[n], time_ms - p_state->base_ms);
+        break;
+    }
+    return n;
+}
+
+/**
+ * @brief Updates the state of a frame with a record that has been encoded or decoded.
+ */
+static void _update(thermostat_telemetry_frame_state_t *p_state, uint8_t tag, uint32_t time_ms, int32_t value)
+{
+    if ((tag >> TELEMETRY_TYPE_POS) != THERMOSTAT_TELEMETRY_SAMPLE)
+    {
+        return;
+    }
+    uint8_t sensor = tag & (THERMOSTAT_TELEMETRY_MAX_SENSORS - 1U);
+    uint32_t mask = 1U << sensor;
+    p_state->period_ms[sensor] = (p_state->sensors & mask) ? (time_ms - p_state->sample_ms[sensor]) : 0;
+    p_state->sample_ms[sensor] = time_ms;
+    p_state->mcelsius[sensor] = value;
+    p_state->sensors |= mask;
+}
+
+/**
+ * @brief Starts a new frame with a record at a given time: version and base time.
+ */
+static void _start_frame(uint32_t time_ms)
+{
+    telemetry_frame[0] = THERMOSTAT_TELEMETRY_VERSION;
+    telemetry_length = 1U + _put_varint(&telemetry_frame[1], time_ms);
+    telemetry_state.base_ms = time_ms;
+    telemetry_state.sensors = 0;
+}
+
+/**
+ * @brief Writes a frame to the trace output, the default output of the telemetry.
+ */
+static void _trace_output(const uint8_t *p_data, uint32_t length)
+{
+    port_system_trace_write((const char *)p_data, length);
+}
+
+/**
+ * @brief Adds a record to the frame. The frame is sent before if the record does not fit or goes back in time, and after if it has reached the maximum latency.
+ */
+static void _add(uint8_t tag, uint32_t time_ms, int32_t value)
+{
+    if ((telemetry_length > 0) && ((int32_t)(time_ms - telemetry_last_ms) < 0))
+    {
+        thermostat_telemetry_flush();
+    }
+    if (telemetry_length == 0)
+    {
+        _start_frame(time_ms);
+    }
+
+    uint8_t n = _encode(&telemetry_state, &telemetry_frame[telemetry_length], tag, time_ms, value);
+    if ((telemetry_length + n + 1U) > THERMOSTAT_TELEMETRY_FRAME_SIZE)
+    {
+        // The record is encoded again, as the first one of a new frame. Room for the CRC is kept
+        thermostat_telemetry_flush();
+        _start_frame(time_ms);
+        n = _encode(&telemetry_state, &telemetry_frame[telemetry_length], tag, time_ms, value);
+    }
+    telemetry_length += n;
+    telemetry_last_ms = time_ms;
+    _update(&telemetry_state, tag, time_ms, value);
+
+    if ((time_ms - telemetry_state.base_ms) >= THERMOSTAT_TELEMETRY_MAX_LATENCY_MS)
+    {
+        thermostat_telemetry_flush();
+    }
+}
+
+/**
+ * @brief Discards the frame being received by a decoder.
+ */
+static void _restart_frame(thermostat_telemetry_decoder_t *p_decoder)
+{
+    p_decoder->length = 0;
+    p_decoder->offset = 0;
+    p_decoder->block = 0;
+    p_decoder->pending_zero = false;
+    p_decoder->overflow = false;
+}
+
+/**
+ * @brief Checks a frame received by a decoder, and gets ready to decode its records.
+ *
+ * @return true if the frame is valid, false otherwise.
+ */
+static bool _check_frame(thermostat_telemetry_decoder_t *p_decoder)
+{
+    uint32_t length = p_decoder->length;
+    if (p_decoder->overflow || (p_decoder->block != 0) || (length < 3U) || (_crc8(p_decoder->frame, length - 1U) != p_decoder->frame[length - 1U]) || (p_decoder->frame[0] != THERMOSTAT_TELEMETRY_VERSION))
+    {
+        return false;
+    }
+    uint8_t n = _get_varint(&p_decoder->frame[1], length - 2U, &p_decoder->state.base_ms);
+    if (n == 0)
+    {
+        return false;
+    }
+    p_decoder->length = length - 1U; // The CRC is not a record
+    p_decoder->offset = 1U + n;
+    p_decoder->state.sensors = 0;
+    return true;
+}
+
+/* Function definitions ------------------------------------------------------*/
+void thermostat_telemetry_init(thermostat_telemetry_output_t output)
+{
+    telemetry_output = output;
+    telemetry_length = 0;
+}
+
+void thermostat_telemetry_sample(uint8_t sensor, uint32_t time_ms, int32_t mcelsius)
+{
+    _add((uint8_t)((THERMOSTAT_TELEMETRY_SAMPLE << TELEMETRY_TYPE_POS) | (sensor & (THERMOSTAT_TELEMETRY_MAX_SENSORS - 1U))), time_ms, mcelsius);
+}
+
+void thermostat_telemetry_transition(uint8_t zone, uint8_t event, uint32_t time_ms)
+{
+    _add((uint8_t)((THERMOSTAT_TELEMETRY_TRANSITION << TELEMETRY_TYPE_POS) | ((event != 0U) ? TELEMETRY_FLAG_BIT : 0U) | (zone & TELEMETRY_ID_MASK)), time_ms, 0);
+}
+
+void thermostat_telemetry_counter(uint8_t counter, uint32_t time_ms, uint32_t value)
+{
+    _add((uint8_t)((THERMOSTAT_TELEMETRY_COUNTER << TELEMETRY_TYPE_POS) | (counter & TELEMETRY_ID_MASK)), time_ms, (int32_t)value);
+}
+
+void thermostat_telemetry_flush(void)
+{
+    if (telemetry_length == 0)
+    {
+        return;
+    }
+    telemetry_frame[telemetry_length] = _crc8(telemetry_frame, telemetry_length);
+    telemetry_length++;
+
+    // COBS: each byte 0 is replaced by the distance to the next one. The frame is shorter than 254 bytes, so there is no other overhead
+    uint8_t encoded[THERMOSTAT_TELEMETRY_MAX_ENCODED_BYTES];
+    uint32_t code_index = 0;
+    uint32_t n = 1;
+    for (uint32_t i = 0; i < telemetry_length; i++)
+    {
+        if (telemetry_frame[i] == 0U)
+        {
+            encoded[code_index] = (uint8_t)(n - code_index);
+            code_index = n++;
+        }
+        else
+        {
+            encoded[n++] = telemetry_frame[i];
+        }
+    }
+    encoded[code_index] = (uint8_t)(n - code_index);
+    encoded[n++] = 0U;
+    telemetry_length = 0;
+
+    if (telemetry_output != NULL)
+    {
+        telemetry_output(encoded, n);
+    }
+    else
+    {
+        _trace_output(encoded, n);
+    }
+}
+
+void thermostat_telemetry_decoder_init(thermostat_telemetry_decoder_t *p_decoder)
+{
+    memset(p_decoder, 0, sizeof(thermostat_telemetry_decoder_t));
+}
+
+bool thermostat_telemetry_decoder_push(thermostat_telemetry_decoder_t *p_decoder, uint8_t byte)
+{
+    p_decoder->bytes++;
+
+    // A valid frame whose records have been read is discarded at the first byte of the next one
+    if (p_decoder->offset != 0)
+    {
+        _restart_frame(p_decoder);
+    }
+
+    if (byte == 0U)
+    {
+        // End of a frame. Two delimiters in a row are not an error
+        bool empty = (p_decoder->length == 0) && (p_decoder->block == 0) && !p_decoder->pending_zero;
+        bool valid = !empty && _check_frame(p_decoder);
+        if (valid)
+        {
+            p_decoder->frames++;
+            p_decoder->block = 0;
+            p_decoder->pending_zero = false;
+            return true;
+        }
+        if (!empty)
+        {
+            p_decoder->bad_frames++;
+        }
+        _restart_frame(p_decoder);
+        return false;
+    }
+
+    uint8_t decoded = byte;
+    if (p_decoder->block == 0)
+    {
+        // Code byte: the previous block ended with a byte 0, unless it was the last one
+        bool zero = p_decoder->pending_zero;
+        p_decoder->block = byte - 1U;
+        p_decoder->pending_zero = (byte != 0xFFU);
+        if (!zero)
+        {
+            return false;
+        }
+        decoded = 0U;
+    }
+    else
+    {
+        p_decoder->block--;
+    }
+
+    if (p_decoder->length < THERMOSTAT_TELEMETRY_FRAME_SIZE)
+    {
+        p_decoder->frame[p_decoder->length++] = decoded;
+    }
+    else
+    {
+        p_decoder->overflow = true;
+    }
+    return false;
+}
+
+bool thermostat_telemetry_decoder_next(thermostat_telemetry_decoder_t *p_decoder, thermostat_telemetry_record_t *p_record)
+{
+    uint32_t offset = p_decoder->offset;
+    if (offset >= p_decoder->length)
+    {
+        return false;
+    }
+    const uint8_t *p_in = &p_decoder->frame[offset];
+    uint32_t available = p_decoder->length - offset;
+    thermostat_telemetry_frame_state_t *p_state = &p_decoder->state;
+    uint8_t tag = p_in[0];
+    uint8_t type = tag >> TELEMETRY_TYPE_POS;
+    uint8_t sensor = tag & (THERMOSTAT_TELEMETRY_MAX_SENSORS - 1U);
+    bool known = (type == THERMOSTAT_TELEMETRY_SAMPLE) && (p_state->sensors & (1U << sensor));
+    bool on_time = (type == THERMOSTAT_TELEMETRY_SAMPLE) && (tag & TELEMETRY_FLAG_BIT);
+    if ((type > THERMOSTAT_TELEMETRY_COUNTER) || (on_time && !known))
+    {
+        return false;
+    }
+
+    // Time, unless the sample is on time, and value, unless the record is a transition
+    uint32_t length = 1;
+    uint32_t time = 0;
+    uint32_t value = 0;
+    uint8_t n = 1;
+    if (!on_time)
+    {
+        n = _get_varint(&p_in[length], available - length, &time);
+        length += n;
+    }
+    if ((n != 0) && (type != THERMOSTAT_TELEMETRY_TRANSITION))
+    {
+        n = _get_varint(&p_in[length], available - length, &value);
+        length += n;
+    }
+    if (n == 0)
+    {
+        return false;
+    }
+
+    p_record->type = type;
+    p_record->id = tag & TELEMETRY_ID_MASK;
+    p_record->time_ms = p_state->base_ms + time;
+    p_record->value = (int32_t)value;
+    if (type == THERMOSTAT_TELEMETRY_TRANSITION)
+    {
+        p_record->value = (tag & TELEMETRY_FLAG_BIT) ? DEACTIVATION : ACTIVATION;
+    }
+    else if (known)
+    {
+        // Same differences as the encoder, from the samples already decoded
+        uint32_t predicted_ms = p_state->sample_ms[sensor] + p_state->period_ms[sensor];
+        p_record->time_ms = on_time ? predicted_ms : (predicted_ms + (uint32_t)_unzigzag(time));
+        p_record->value = (int32_t)((uint32_t)p_state->mcelsius[sensor] + (uint32_t)_unzigzag(value));
+    }
+    else if (type == THERMOSTAT_TELEMETRY_SAMPLE)
+    {
+        p_record->time_ms = p_state->base_ms + (uint32_t)_unzigzag(time);
+        p_record->value = _unzigzag(value);
+    }
+    _update(p_state, tag, p_record->time_ms, p_record->value);
+    p_decoder->offset += length;
+    return true;
+}
@@ -0,0 +1,332 @@
+/**
+ * @file thermostat_trace.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Binary trace recorder of the thermostat and its replay driver.
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <string.h>
+
+/* Project includes */
+#include "thermostat_trace.h"
+#include "fsm_thermostat.h"
+#include "port_system.h"
+#include "port_temp_sensor.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define TRACE_TYPE_POS 6U     /*!< Tag byte: position of the type of the record */
+#define TRACE_ZONE_POS 1U     /*!< Tag byte: position of the zone of a transition */
+#define TRACE_ZONE_MASK 0x1FU /*!< Tag byte: mask of the zone of a transition (after the shift) */
+#define TRACE_SENSOR_MASK 0x3FU /*!< Tag byte: mask of the sensor of a sample */
+#define TRACE_EVENT_BIT 0x01U /*!< Tag byte: event of a transition */
+#define TRACE_MORE_BIT 0x80U  /*!< Variable-length number: more bytes follow */
+
+_Static_assert((THERMOSTAT_TRACE_SIZE & (THERMOSTAT_TRACE_SIZE - 1)) == 0, "The size of the trace must be a power of 2");
+_Static_assert(THERMOSTAT_POOL_SIZE <= (TRACE_ZONE_MASK + 1U), "The zone of a transition must fit in the tag byte");
+_Static_assert(TEMP_SENSOR_SCAN_MAX_SENSORS <= (TRACE_SENSOR_MASK + 1U), "The sensor of a sample must fit in the tag byte");
+
+/* Global variables -----------------------------------------------------------*/
+static uint8_t trace_ring[THERMOSTAT_TRACE_SIZE]; /*!< Ring of records */
+static uint32_t trace_head = 0;                   /*!< Free-running index of the next byte to write */
+static uint32_t trace_tail = 0;                   /*!< Free-running index of the first byte of the oldest record */
+static uint32_t trace_base_ms = 0;                /*!< Time reference of the delta of the oldest record */
+static uint32_t trace_newest_ms = 0;              /*!< Time of the newest record */
+static uint32_t trace_dropped = 0;                /*!< Records dropped because the ring was full */
+static bool trace_empty = true;                   /*!< No record since the last clear: the next one sets the time reference */
+static volatile bool trace_enabled = true;        /*!< The recorder accepts new records */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Encodes a variable-length number: 7 bits per byte, LSBs first.
+ *
+ * @param p_out Buffer for the bytes.
+ * @param value Number to encode.
+ * @return uint8_t Number of bytes (1 to 5).
+ */
+static uint8_t _put_varint(uint8_t *p_out, uint32_t value)
+{
+    uint8_t n = 0;
+    while (value >= TRACE_MORE_BIT)
+    {
+        p_out[n++] = (uint8_t)(value | TRACE_MORE_BIT);
+        value >>= 7;
+    }
+    p_out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief Decodes a variable-length number, either from an image or from the ring.
+ *
+ * @param p_bytes Bytes of an image, or NULL to read the ring.
+ * @param index Index of the first byte (masked with the size of the ring when reading the ring).
+ * @param available Bytes that can be read.
+ * @param p_value Pointer to store the number.
+ * @return uint8_t Number of bytes read, or 0 if the number is truncated.
+ */
+static uint8_t _get_varint(const uint8_t *p_bytes, uint32_t index, uint32_t available, uint32_t *p_value)
+{
+    uint32_t value = 0;
+    for (uint8_t n = 0; (n < 5U) && (n < available); n++)
+    {
+        uint8_t byte = (p_bytes != NULL) ? p_bytes[index + n] : trace_ring[(index + n) & (THERMOSTAT_TRACE_SIZE - 1U)];
+        value |= (uint32_t)(byte & ~TRACE_MORE_BIT) << (7U * n);
+        if (!(byte & TRACE_MORE_BIT))
+        {
+            *p_value = value;
+            return n + 1U;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes a record.
+ *
+ * @param p_bytes Bytes of an image, or NULL to decode the ring.
+ * @param index Index of the tag byte.
+ * @param available Bytes that can be read.
+ * @param p_record Pointer to store the type, zone and value of the record. Its `time_ms` is set to the delta.
+ * @return uint32_t Bytes of the record, or 0 if it is truncated.
+ */
+static uint32_t _decode(const uint8_t *p_bytes, uint32_t index, uint32_t available, thermostat_trace_record_t *p_record)
+{
+    if (available == 0)
+    {
+        return 0;
+    }
+    uint8_t tag = (p_bytes != NULL) ? p_bytes[index] : trace_ring[index & (THERMOSTAT_TRACE_SIZE - 1U)];
+    uint32_t length = 1;
+
+    uint8_t n = _get_varint(p_bytes, index + length, available - length, &p_record->time_ms);
+    if (n == 0)
+    {
+        return 0;
+    }
+    length += n;
+
+    p_record->type = tag >> TRACE_TYPE_POS;
+    if (p_record->type == THERMOSTAT_TRACE_TRANSITION)
+    {
+        p_record->zone = (tag >> TRACE_ZONE_POS) & TRACE_ZONE_MASK;
+        p_record->value = tag & TRACE_EVENT_BIT;
+        return length;
+    }
+    p_record->zone = tag & TRACE_SENSOR_MASK;
+
+    n = _get_varint(p_bytes, index + length, available - length, &p_record->value);
+    return (n == 0) ? 0 : length + n;
+}
+
+/**
+ * @brief Appends a record to the ring. The oldest records are dropped until it fits.
+ *
+ * The samples come from an ISR and the transitions from the main loop, so the record is written with the interrupts masked.
+ *
+ * @param tag Tag byte of the record.
+ * @param has_value The record has a value (sample).
+ * @param value Value of the record.
+ */
+static void _append(uint8_t tag, bool has_value, uint32_t value)
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+
+    uint32_t state = port_system_critical_enter();
+    uint32_t now_ms = port_system_get_millis();
+    if (trace_empty)
+    {
+        trace_base_ms = now_ms;
+        trace_newest_ms = now_ms;
+        trace_empty = false;
+    }
+
+    uint8_t bytes[THERMOSTAT_TRACE_MAX_RECORD_BYTES];
+    uint8_t n = 0;
+    bytes[n++] = tag;
+    n += _put_varint(&bytes[n], now_ms - trace_newest_ms);
+    if (has_value)
+    {
+        n += _put_varint(&bytes[n], value);
+    }
+
+    // Drop whole records from the tail: the time of the new oldest record becomes the reference
+    while ((THERMOSTAT_TRACE_SIZE - (trace_head - trace_tail)) < n)
+    {
+        thermostat_trace_record_t oldest = {0};
+        uint32_t length = _decode(NULL, trace_tail, trace_head - trace_tail, &oldest);
+        trace_base_ms += oldest.time_ms;
+        trace_tail += length;
+        trace_dropped++;
+    }
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        trace_ring[(trace_head + i) & (THERMOSTAT_TRACE_SIZE - 1U)] = bytes[i];
+    }
+    trace_head += n;
+    trace_newest_ms = now_ms;
+    port_system_critical_exit(state);
+}
+
+/**
+ * @brief Writes a 32-bit word in little endian.
+ */
+static void _put_u32(uint8_t *p_out, uint32_t value)
+{
+    for (uint8_t i = 0; i < 4U; i++)
+    {
+        p_out[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+/**
+ * @brief Reads a 32-bit word in little endian.
+ */
+static uint32_t _get_u32(const uint8_t *p_in)
+{
+    return (uint32_t)p_in[0] | ((uint32_t)p_in[1] << 8) | ((uint32_t)p_in[2] << 16) | ((uint32_t)p_in[3] << 24);
+}
+
+/* Function definitions ------------------------------------------------------*/
+void thermostat_trace_sample(uint8_t sensor, uint32_t counts)
+{
+    _append((uint8_t)((THERMOSTAT_TRACE_SAMPLE << TRACE_TYPE_POS) | (sensor & TRACE_SENSOR_MASK)), true, counts);
+}
+
+void thermostat_trace_transition(uint8_t zone, uint8_t event)
+{
+    _append((uint8_t)((THERMOSTAT_TRACE_TRANSITION << TRACE_TYPE_POS) | ((zone & TRACE_ZONE_MASK) << TRACE_ZONE_POS) | (event & TRACE_EVENT_BIT)), false, 0);
+}
+
+void thermostat_trace_enable(bool enable)
+{
+    trace_enabled = enable;
+}
+
+void thermostat_trace_clear(void)
+{
+    uint32_t state = port_system_critical_enter();
+    trace_head = 0;
+    trace_tail = 0;
+    trace_dropped = 0;
+    trace_empty = true;
+    port_system_critical_exit(state);
+}
+
+uint32_t thermostat_trace_get_dropped(void)
+{
+    return trace_dropped;
+}
+
+uint32_t thermostat_trace_export(uint8_t *p_image, uint32_t max_length)
+{
+    uint32_t state = port_system_critical_enter();
+    uint32_t length = trace_head - trace_tail;
+    if ((THERMOSTAT_TRACE_HEADER_BYTES + length) > max_length)
+    {
+        port_system_critical_exit(state);
+        return 0;
+    }
+
+    _put_u32(&p_image[0], THERMOSTAT_TRACE_MAGIC);
+    _put_u32(&p_image[4], trace_base_ms);
+    _put_u32(&p_image[8], length);
+    _put_u32(&p_image[12], trace_dropped);
+    for (uint32_t i = 0; i < length; i++)
+    {
+        p_image[THERMOSTAT_TRACE_HEADER_BYTES + i] = trace_ring[(trace_tail + i) & (THERMOSTAT_TRACE_SIZE - 1U)];
+    }
+    port_system_critical_exit(state);
+    return THERMOSTAT_TRACE_HEADER_BYTES + length;
+}
+
+bool thermostat_trace_reader_init(thermostat_trace_reader_t *p_reader, const uint8_t *p_image, uint32_t length)
+{
+    if ((length < THERMOSTAT_TRACE_HEADER_BYTES) || (_get_u32(&p_image[0]) != THERMOSTAT_TRACE_MAGIC) || (_get_u32(&p_image[8]) > (length - THERMOSTAT_TRACE_HEADER_BYTES)))
+    {
+        return false;
+    }
+    p_reader->p_records = &p_image[THERMOSTAT_TRACE_HEADER_BYTES];
+    p_reader->time_ms = _get_u32(&p_image[4]);
+    p_reader->length = _get_u32(&p_image[8]);
+    p_reader->dropped = _get_u32(&p_image[12]);
+    p_reader->offset = 0;
+    return true;
+}
+
+bool thermostat_trace_reader_next(thermostat_trace_reader_t *p_reader, thermostat_trace_record_t *p_record)
+{
+    uint32_t length = _decode(p_reader->p_records, p_reader->offset, p_reader->length - p_reader->offset, p_record);
+    if (length == 0)
+    {
+        return false;
+    }
+    p_reader->offset += length;
+    p_reader->time_ms += p_record->time_ms;
+    p_record->time_ms = p_reader->time_ms;
+    return true;
+}
+
+bool thermostat_trace_replay(const uint8_t *p_image, uint32_t length, fsm_t *p_fsm, uint8_t zone, uint8_t sensor, thermostat_trace_replay_result_t *p_result)
+{
+    thermostat_trace_reader_t reader;
+    memset(p_result, 0, sizeof(thermostat_trace_replay_result_t));
+    if (!thermostat_trace_reader_init(&reader, p_image, length))
+    {
+        return false;
+    }
+
+    port_temp_hw_t *p_temp = ((fsm_thermostat_t *)p_fsm)->p_temp_sensor;
+    fsm_thermostat_stats_t stats;
+    fsm_thermostat_get_stats(p_fsm, &stats);
+    uint32_t transitions = stats.transitions;
+    int16_t pending = UNKNOWN; // Replayed transition not yet matched with a recorded one
+
+    thermostat_trace_enable(false);
+    thermostat_trace_record_t record;
+    while (thermostat_trace_reader_next(&reader, &record))
+    {
+        if ((record.type == THERMOSTAT_TRACE_SAMPLE) && (record.zone == sensor))
+        {
+            // Feed the sample at the time it was recorded, and evaluate it at once
+            port_system_set_millis(record.time_ms);
+            port_temp_sensor_save_adc_value(p_temp, record.value);
+            fsm_thermostat_fire(p_fsm);
+            p_result->samples++;
+
+            fsm_thermostat_get_stats(p_fsm, &stats);
+            if (stats.transitions != transitions)
+            {
+                transitions = stats.transitions;
+                p_result->replayed_transitions++;
+                if (pending != UNKNOWN)
+                {
+                    p_result->mismatches++;
+                }
+                pending = fsm_thermostat_get_status(p_fsm);
+            }
+        }
+        else if ((record.type == THERMOSTAT_TRACE_TRANSITION) && (record.zone == zone))
+        {
+            // The recorded transition follows the sample that caused it
+            p_result->recorded_transitions++;
+            if (pending != (int16_t)record.value)
+            {
+                p_result->mismatches++;
+            }
+            pending = UNKNOWN;
+        }
+    }
+    if (pending != UNKNOWN)
+    {
+        p_result->mismatches++;
+    }
+    thermostat_trace_enable(true);
+    return true;
+}
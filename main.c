@@ -8,13 +8,20 @@
  */
 
 /* INCLUDES */
-#include <stdio.h>
 #include "port_system.h"
 #include "port_led.h"
 #include "fsm_thermostat.h"
+#include "thermostat_log.h"
+#include "thermostat_profile.h"
+#include "thermostat_filter.h"
+#include "thermostat_config.h"
+#include "thermostat_cmd.h"
+#include "thermostat_telemetry.h"
 
 /* Defines and macros --------------------------------------------------------*/
 //#define USE_LED_ON
+//#define USE_LOW_POWER
+//#define USE_MEDIAN_FILTER
 
 /* MAIN FUNCTION */
 
@@ -27,10 +34,16 @@ int main()
 {
     // Local variables
     uint8_t previous_thermostat_status = UNKNOWN;
+#ifdef USE_MEDIAN_FILTER
+    static thermostat_filter_t temp_filter;
+#endif
 
     /* Init board */
     port_system_init();
 
+    // Send the telemetry in binary frames to the trace output (ITM), to be decoded in the host with tools/telemetry_decode
+    thermostat_telemetry_init(NULL);
+
 #ifdef USE_LED_ON
     // Initialize the GPIOs for the LED on which might be off and it is not part of the FSM
     port_led_init(&led_on);
@@ -42,25 +55,89 @@ int main()
     // Create an thermostat FSM and get a pointer to it
     fsm_t *p_fsm_thermostat = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
 
+    // Restore the settings saved before the last reset, if any. Only the end of the log in flash is read
+    thermostat_config_t config;
+    thermostat_config_init();
+    if (thermostat_config_load(&config))
+    {
+        fsm_thermostat_set_config(p_fsm_thermostat, &config);
+    }
+
+    // Listen to the commands of the host on the UART (virtual COM port of the ST-LINK)
+    thermostat_cmd_init(p_fsm_thermostat);
+
+#ifdef USE_MEDIAN_FILTER
+    // Remove the spikes of the measurements before the thermostat evaluates them
+    thermostat_filter_init_median(&temp_filter, 5);
+    port_temp_sensor_set_filter(&temp_sensor_thermostat, &temp_filter);
+#endif
+
+#ifdef USE_LOW_POWER
+    // Measure with the RTC and enter STOP mode between the measurements
+    fsm_thermostat_set_low_power(p_fsm_thermostat, true);
+#endif
+
     while (1)
     {
-        // Launch the FSM
-        fsm_fire(p_fsm_thermostat);
+        // Sleep until an ISR posts work (e.g., a new temperature sample). No events means that nothing can wake up the system anymore (end of the simulation in the native platform)
+        if (port_system_wait_for_events() == 0)
+        {
+            break;
+        }
+
+        // Send the records logged by the ISRs to the telemetry
+        THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_LOG_DRAIN);
+        thermostat_log_drain();
+        THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_LOG_DRAIN);
+
+        // Execute the commands received by the UART and send their replies, if any
+        THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_CMD);
+        thermostat_cmd_process();
+        THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_CMD);
+
+        // Launch the thermostat FSMs. They only evaluate their guards when there is a new sample
+        THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_FSM_FIRE);
+        uint8_t fired = fsm_thermostat_fire_all();
+        THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_FSM_FIRE);
+        if (fired == 0)
+        {
+            continue;
+        }
 
         uint8_t current_thermostat_status = fsm_thermostat_get_status(p_fsm_thermostat);
         if (current_thermostat_status != previous_thermostat_status)
         {
             uint32_t last_time_activated = fsm_thermostat_get_last_time_event(p_fsm_thermostat, current_thermostat_status);
-            if (current_thermostat_status == ACTIVATION)
-            {
-                printf("Thermostat ON at %ld\n", last_time_activated);
-            }
-            else if (current_thermostat_status == DEACTIVATION)
+            if ((current_thermostat_status == ACTIVATION) || (current_thermostat_status == DEACTIVATION))
             {
-                printf("Thermostat OFF at %ld\n", last_time_activated);
+                thermostat_telemetry_transition(((fsm_thermostat_t *)p_fsm_thermostat)->zone, current_thermostat_status, last_time_activated);
             }
             previous_thermostat_status = current_thermostat_status;
+
+            // Time spent awake since the system started, in tenths of percent
+            port_system_power_stats_t power_stats;
+            port_system_get_power_stats(&power_stats);
+            uint64_t total_us = power_stats.asleep_us + power_stats.awake_us;
+            uint32_t awake_permille = (total_us > 0) ? (uint32_t)((power_stats.awake_us * 1000U) / total_us) : 0;
+            fsm_thermostat_stats_t stats;
+            fsm_thermostat_get_stats(p_fsm_thermostat, &stats);
+            uint32_t now_ms = port_system_get_millis();
+            thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_AWAKE_PERMILLE, now_ms, awake_permille);
+            thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_SLEEPS, now_ms, power_stats.sleeps);
+            thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_STOPS, now_ms, power_stats.stops);
+            thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_TRANSITIONS, now_ms, stats.transitions);
+
+            // A transition is sent at once, without waiting for the frame to be full
+            thermostat_telemetry_flush();
+
+#if THERMOSTAT_PROFILE
+            // Cycles of the ISRs and of the FSMs since the system started
+            thermostat_profile_dump();
+#endif
         }
     }
+
+    // Send the records of the last frame before the simulation ends
+    thermostat_telemetry_flush();
     return 0;
 }
\ No newline at end of file
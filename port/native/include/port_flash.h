@@ -0,0 +1,66 @@
+/**
+ * @file port_flash.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the flash port layer of the native platform.
+ *
+ * The sector of the configuration is emulated in RAM with the rules of the NOR flash of the STM32F4: an erase sets all the bits to 1, and a word can only be programmed once after it has been erased. The emulated sector keeps its contents when `port_system_init()` is called again, as the real flash across a reset. The emulator counts the erases and the words read, and can cut the power in the middle of a write.
+ *
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_FLASH_H
+#define PORT_FLASH_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and macros --------------------------------------------------------*/
+// Simulated HW: a small sector, so that the tests fill it quickly
+#ifndef PORT_FLASH_SECTOR_SIZE
+#define PORT_FLASH_SECTOR_SIZE 2048U /*!< Size in bytes of the sector of the configuration */
+#endif
+#define PORT_FLASH_ERASED_WORD 0xFFFFFFFFU /*!< Value of a word of an erased sector */
+
+/* Global variables -----------------------------------------------------------*/
+extern uint32_t port_flash_sim_erases;     /*!< Number of erases of the sector since the program started */
+extern uint32_t port_flash_sim_words_read; /*!< Number of words read from the sector since the program started */
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Erases the sector of the configuration: all its words become `PORT_FLASH_ERASED_WORD`.
+ *
+ * @return true if the sector has been erased, false otherwise.
+ */
+bool port_flash_erase(void);
+
+/**
+ * @brief Programs words of the sector of the configuration, in order.
+ *
+ * @param offset Offset in bytes of the first word from the start of the sector. It must be a multiple of 4.
+ * @param p_words Words to program.
+ * @param n_words Number of words to program.
+ * @return true if all the words have been programmed, false if a word is out of the sector or was not erased, or if the power was cut.
+ */
+bool port_flash_program(uint32_t offset, const uint32_t *p_words, uint32_t n_words);
+
+/**
+ * @brief Reads words of the sector of the configuration.
+ *
+ * @param offset Offset in bytes of the first word from the start of the sector. It must be a multiple of 4.
+ * @param p_words Array to store the words.
+ * @param n_words Number of words to read.
+ */
+void port_flash_read(uint32_t offset, uint32_t *p_words, uint32_t n_words);
+
+/**
+ * @brief Cuts the power after a number of words have been programmed: the following words of that write are not programmed, as after a reset in the middle of it.
+ *
+ * @param n_words Words that will still be programmed, or `UINT32_MAX` to never cut the power.
+ */
+void port_flash_sim_cut_power_after(uint32_t n_words);
+
+#endif /* PORT_FLASH_H */
@@ -0,0 +1,84 @@
+/**
+ * @file port_led.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the LED port layer of the native platform.
+ * @date 01-01-2024
+ */
+#ifndef PORT_LED_H_
+#define PORT_LED_H_
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdbool.h>
+
+/* HW dependent includes */
+#include "port_system.h"
+
+/* Defines and macros --------------------------------------------------------*/
+// Simulated HW (same pinout as the Nucleo-STM32F446RE):
+#define LED_HEAT_PORT B                                     /*!< GPIO port letter of the heating LED */
+#define LED_HEAT_GPIO PORT_SYSTEM_GPIO(LED_HEAT_PORT)       /*!< GPIO port of the heating LED */
+#define LED_HEAT_PIN 4                                      /*!< GPIO pin of the heating LED */
+#define LED_COMFORT_PORT B                                  /*!< GPIO port letter of the deactivation LED */
+#define LED_COMFORT_GPIO PORT_SYSTEM_GPIO(LED_COMFORT_PORT) /*!< GPIO port of the deactivation LED */
+#define LED_COMFORT_PIN 5                                   /*!< GPIO pin of the deactivation LED */
+#define LED_ON_PORT B                                       /*!< GPIO port letter of the general purpose LED */
+#define LED_ON_GPIO PORT_SYSTEM_GPIO(LED_ON_PORT)           /*!< GPIO port of the general purpose LED */
+#define LED_ON_PIN 3                                        /*!< GPIO pin of the general purpose LED */
+
+/* Typedefs --------------------------------------------------------------------*/
+/**
+ * @brief Structure to define the HW dependencies of a LED: a const descriptor of its pin, built with `PORT_SYSTEM_GPIO_PIN()`.
+ */
+typedef port_system_gpio_pin_t port_led_hw_t;
+
+/* Global variables -----------------------------------------------------------*/
+extern const port_led_hw_t led_heater_active;       /*!< Heating LED of the thermostat. */
+extern const port_led_hw_t led_comfort_temperature; /*!< Cooling LED of the thermostat. */
+extern const port_led_hw_t led_on;                  /*!< General purpose LED. */
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Initializes the LED.
+ *
+ * @param p_led Pointer to the LED structure.
+ */
+void port_led_init(const port_led_hw_t *p_led);
+
+/**
+ * @brief Returns the current state of the LED.
+ *
+ * @return true if the LED is on
+ * @return false if the LED is off
+ */
+bool port_led_get_status(const port_led_hw_t *p_led);
+
+/**
+ * @brief Turn on the LED
+ *
+ */
+void port_led_on(const port_led_hw_t *p_led);
+
+/**
+ * @brief Turn off the LED
+ *
+ */
+void port_led_off(const port_led_hw_t *p_led);
+
+/**
+ * @brief Toggles the LED state.
+ *
+ */
+void port_led_toggle(const port_led_hw_t *p_led);
+
+/**
+ * @brief Turns on a LED and turns off another one at the same time.
+ *
+ * If both LEDs are on the same GPIO port, they change in a single atomic write of its BSRR: there is no instant with both LEDs on or off.
+ *
+ * @param p_led_on Pointer to the LED to turn on.
+ * @param p_led_off Pointer to the LED to turn off.
+ */
+void port_led_switch(const port_led_hw_t *p_led_on, const port_led_hw_t *p_led_off);
+
+#endif // PORT_LED_H_
@@ -0,0 +1,638 @@
+/**
+ * @file port_system.h
+ * @brief Header for port_system.c file of the native (host) platform.
+ *
+ * The native platform simulates the peripherals used by the thermostat (GPIOs, ADC and the measurement timer) on top of a discrete-event **virtual clock**. Instead of sleeping, the virtual clock jumps straight to the next pending event (timer update, end of ADC conversion) and runs its simulated ISR. This way, days of simulated time run in milliseconds.
+ *
+ * @author Sistemas Digitales II
+ * @date 2024-01-01
+ */
+
+#ifndef PORT_SYSTEM_H_
+#define PORT_SYSTEM_H_
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and enums ----------------------------------------------------------*/
+/* Defines */
+#define BIT_POS_TO_MASK(x) (0x01U << (x))    /*!< Convert the index of a bit into a mask by left shifting */
+#define BASE_MASK_TO_POS(m, p) ((m) << (p)) /*!< Move a mask defined in the LSBs to upper positions by shifting left p bits */
+
+/* Virtual clock */
+#define PORT_SYSTEM_SIM_MAX_EVENTS 16U /*!< Maximum number of events that can be pending in the virtual clock at the same time */
+#define PORT_SYSTEM_SIM_NO_EVENT -1    /*!< Identifier returned when an event cannot be scheduled */
+
+/* Events posted by the ISRs to the main loop */
+#define PORT_SYSTEM_EVENT_SAMPLE BIT_POS_TO_MASK(0)  /*!< A new temperature sample has been saved */
+#define PORT_SYSTEM_EVENT_TIMEOUT BIT_POS_TO_MASK(1) /*!< The wake-up time set with `port_system_set_wakeup_us()` has been reached */
+#define PORT_SYSTEM_EVENT_UART BIT_POS_TO_MASK(2)    /*!< The UART has received a burst of bytes (idle line) or finished a transmission */
+
+/* GPIOs */
+#define HIGH true /*!< Logic 1 */
+#define LOW false /*!< Logic 0 */
+
+#define GPIO_MODE_IN 0x00        /*!< GPIO as input */
+#define GPIO_MODE_OUT 0x01       /*!< GPIO as output */
+#define GPIO_MODE_ALTERNATE 0x02 /*!< GPIO as alternate function */
+#define GPIO_MODE_ANALOG 0x03    /*!< GPIO as analog */
+
+#define GPIO_PUPDR_NOPULL 0x00 /*!< GPIO no pull up or down */
+#define GPIO_PUPDR_PUP 0x01    /*!< GPIO pull up */
+#define GPIO_PUPDR_PDOWN 0x02  /*!< GPIO pull down */
+
+#define PORT_SYSTEM_SIM_GPIO_PORTS 3U    /*!< Number of simulated GPIO ports */
+#define GPIOA (&port_system_sim_gpio[0]) /*!< Simulated GPIO port A */
+#define GPIOB (&port_system_sim_gpio[1]) /*!< Simulated GPIO port B */
+#define GPIOC (&port_system_sim_gpio[2]) /*!< Simulated GPIO port C */
+#define RCC (&port_system_sim_rcc)         /*!< Simulated reset and clock control */
+#define RCC_AHB1ENR_GPIOAEN BIT_POS_TO_MASK(0) /*!< Clock enable bit of GPIOA */
+#define RCC_AHB1ENR_GPIOBEN BIT_POS_TO_MASK(1) /*!< Clock enable bit of GPIOB */
+#define RCC_AHB1ENR_GPIOCEN BIT_POS_TO_MASK(2) /*!< Clock enable bit of GPIOC */
+
+/* GPIO pin descriptors */
+#define PORT_SYSTEM_GPIO(letter) PORT_SYSTEM_GPIO_(letter)         /*!< GPIO port of a letter, e.g., `PORT_SYSTEM_GPIO(B)` is `GPIOB`. The letter can be a macro */
+#define PORT_SYSTEM_GPIO_(letter) GPIO##letter                     /*!< Helper of `PORT_SYSTEM_GPIO()` */
+#define PORT_SYSTEM_GPIO_CLOCK(letter) PORT_SYSTEM_GPIO_CLOCK_(letter) /*!< Clock enable bit of the GPIO port of a letter in `RCC->AHB1ENR` */
+#define PORT_SYSTEM_GPIO_CLOCK_(letter) RCC_AHB1ENR_GPIO##letter##EN /*!< Helper of `PORT_SYSTEM_GPIO_CLOCK()` */
+#define PORT_SYSTEM_GPIO_PIN(letter, pin_number, pin_mode, pin_pupd) {.p_port = PORT_SYSTEM_GPIO(letter), .clock_mask = PORT_SYSTEM_GPIO_CLOCK(letter), .mask = (uint16_t)BIT_POS_TO_MASK(pin_number), .pin = (pin_number), .mode = (pin_mode), .pupd = (pin_pupd)} /*!< Initializer of a `port_system_gpio_pin_t`: everything is resolved at compile time */
+
+/* Timers */
+#define PORT_SYSTEM_TIMER_CLOCK_HZ 16000000U /*!< Clock of the simulated timers in Hz (HSI of the STM32F4) */
+#define PORT_SYSTEM_CORE_CLOCK_HZ 16000000U  /*!< Clock of the simulated core in Hz. It gives the simulated cycle counter */
+#define TIMER_TICKS_MS(ms) ((uint64_t)(ms) * (PORT_SYSTEM_TIMER_CLOCK_HZ / 1000U))                                    /*!< Ticks of the timer clock in a period given in milliseconds */
+#define TIMER_TICKS_US(us) ((uint64_t)(us) * (PORT_SYSTEM_TIMER_CLOCK_HZ / 1000000U))                                 /*!< Ticks of the timer clock in a period given in microseconds */
+#define TIMER_PSC(ticks, arr_max) ((uint32_t)(((uint64_t)(ticks) - 1U) / ((uint64_t)(arr_max) + 1U)))                  /*!< Smallest prescaler (PSC) that fits a period of `ticks` in a counter of `arr_max`: it gives the finest resolution of ARR */
+#define TIMER_ARR(ticks, arr_max) ((uint32_t)(((uint64_t)(ticks) + (TIMER_PSC(ticks, arr_max) + 1U) / 2U) / (TIMER_PSC(ticks, arr_max) + 1U) - 1U)) /*!< Auto-reload value (ARR) of a period of `ticks` with the prescaler `TIMER_PSC()`, rounded to the nearest count */
+#define TIMER_PERIOD_TICKS(psc, arr) (((uint64_t)(psc) + 1U) * ((uint64_t)(arr) + 1U))                               /*!< Actual period in ticks of the timer clock of a pair of PSC and ARR */
+
+/* ADC */
+#define ADC_VREF_MV 3300U /*!< ADC reference voltage in mV */
+#define ADC_STABILIZATION_US 3U /*!< Power-up time of the simulated ADC (tSTAB of the STM32F446) in microseconds. The ADC ignores the triggers until it has elapsed */
+
+#define ADC_CR1_RES_Pos 24U                            /*!< Position of the resolution field (same as STM32F4 ADC_CR1) */
+#define ADC_CR1_RES_Msk (0x03U << ADC_CR1_RES_Pos)     /*!< Mask of the resolution field */
+#define ADC_CR1_EOCIE_Pos 5U                           /*!< Position of the end of conversion interrupt enable bit */
+#define ADC_CR1_EOCIE_Msk (0x01U << ADC_CR1_EOCIE_Pos) /*!< Mask of the end of conversion interrupt enable bit */
+#define ADC_CR1_AWDCH 0x1FU                            /*!< Analog watchdog channel selection field */
+#define ADC_CR1_AWDCH_Pos 0U                           /*!< Position of the analog watchdog channel selection field */
+#define ADC_CR1_AWDIE 0x40U                            /*!< Analog watchdog interrupt enable bit */
+#define ADC_CR1_SCAN 0x100U                            /*!< Scan mode bit */
+#define ADC_CR1_AWDSGL 0x200U                          /*!< Analog watchdog on a single channel bit */
+#define ADC_CR1_AWDEN 0x800000U                        /*!< Analog watchdog enable on regular channels bit */
+#define ADC_CR2_ADON 0x01U                             /*!< ADC on bit */
+#define ADC_CR2_DMA 0x100U                             /*!< DMA mode bit */
+#define ADC_CR2_DDS 0x200U                             /*!< DMA disable selection bit (keep issuing requests) */
+#define ADC_CR2_EXTSEL_Pos 24U                         /*!< Position of the external trigger selection field for regular channels */
+#define ADC_CR2_EXTSEL (0x0FU << ADC_CR2_EXTSEL_Pos)   /*!< Mask of the external trigger selection field for regular channels */
+#define ADC_CR2_EXTEN_Pos 28U                          /*!< Position of the external trigger enable field for regular channels */
+#define ADC_CR2_EXTEN (0x03U << ADC_CR2_EXTEN_Pos)     /*!< Mask of the external trigger enable field for regular channels */
+#define ADC_CR2_EXTEN_0 (0x01U << ADC_CR2_EXTEN_Pos)   /*!< External trigger on the rising edge */
+#define ADC_SR_AWD 0x01U                               /*!< Analog watchdog flag */
+#define ADC_SR_EOC 0x02U                               /*!< End of conversion flag */
+
+#define ADC_RESOLUTION_12B (0x00U << ADC_CR1_RES_Pos) /*!< 12-bit resolution */
+#define ADC_RESOLUTION_10B (0x01U << ADC_CR1_RES_Pos) /*!< 10-bit resolution */
+#define ADC_RESOLUTION_8B (0x02U << ADC_CR1_RES_Pos)  /*!< 8-bit resolution */
+#define ADC_RESOLUTION_6B (0x03U << ADC_CR1_RES_Pos)  /*!< 6-bit resolution */
+
+#define ADC_EOC_INTERRUPT_ENABLE (0x01U << ADC_CR1_EOCIE_Pos) /*!< End of conversion interrupt enable */
+
+#define ADC_EXTERNAL_TRIGGER_TIM2_TRGO (0x06U << ADC_CR2_EXTSEL_Pos) /*!< Regular conversions triggered by TIM2 TRGO (EXTSEL = 0110, as in the STM32F4) */
+#define ADC_EXTERNAL_TRIGGER_SOFTWARE UINT32_MAX                     /*!< No external trigger: the regular conversions are started by software (`port_system_adc_start_scan()`) */
+
+#define ADC_DMA_MAX_CONVERSIONS 16U     /*!< Maximum number of conversions of a regular sequence */
+#define ADC_DMA_HALF_TRANSFER 0x01U     /*!< The DMA has filled the first half of the circular buffer */
+#define ADC_DMA_TRANSFER_COMPLETE 0x02U /*!< The DMA has filled the second half of the circular buffer */
+
+#define PORT_SYSTEM_SIM_ADCS 3U               /*!< Number of simulated ADCs */
+#define PORT_SYSTEM_SIM_ADC_CONVERSION_US 2U /*!< Duration of a simulated conversion in microseconds (3 + 12 cycles at 8 MHz, rounded up) */
+#define ADC1 (&port_system_sim_adc[0])        /*!< Simulated ADC1 */
+#define ADC2 (&port_system_sim_adc[1])        /*!< Simulated ADC2 */
+#define ADC3 (&port_system_sim_adc[2])        /*!< Simulated ADC3 */
+
+/* Timers */
+#define PORT_SYSTEM_SIM_TIMERS 1U      /*!< Number of simulated timers */
+#define TIM2 (&port_system_sim_tim[0]) /*!< Simulated TIM2 */
+
+#define TIM_CR2_MMS_Pos 4U                       /*!< Position of the master mode selection field */
+#define TIM_CR2_MMS (0x07U << TIM_CR2_MMS_Pos)   /*!< Mask of the master mode selection field */
+#define TIM_CR2_MMS_1 (0x02U << TIM_CR2_MMS_Pos) /*!< Master mode "update": the update event is the trigger output (TRGO) */
+
+/* Typedefs --------------------------------------------------------------------*/
+/**
+ * @brief Callback of an event of the virtual clock. It plays the role of an ISR.
+ *
+ * @param p_arg Argument given when the event was scheduled.
+ */
+typedef void (*port_system_sim_callback_t)(void *p_arg);
+
+/**
+ * @brief Model of the analog input of a simulated ADC.
+ *
+ * @param channel ADC channel being converted.
+ * @param now_us Virtual time of the conversion in microseconds.
+ * @return uint32_t Analog value as counts of a 12-bit conversion.
+ */
+typedef uint32_t (*port_system_sim_adc_source_t)(uint8_t channel, uint64_t now_us);
+
+/**
+ * @brief Simulated GPIO port. It only keeps the registers used by the port layer.
+ */
+typedef struct
+{
+    uint32_t MODER;           /*!< Mode register */
+    uint32_t PUPDR;           /*!< Pull-up/pull-down register */
+    uint32_t ODR;             /*!< Output data register */
+    uint32_t BSRR;            /*!< Bit set/reset register: its last write, which `port_system_gpio_write()` applies to ODR at once */
+    uint32_t sim_bsrr_writes; /*!< Number of writes to BSRR, i.e., of bus transactions to change the outputs */
+} GPIO_TypeDef;
+
+/**
+ * @brief Simulated reset and clock control. It only keeps the clock enables of the GPIO ports.
+ */
+typedef struct
+{
+    uint32_t AHB1ENR; /*!< AHB1 peripheral clock enable register */
+} RCC_TypeDef;
+
+/**
+ * @brief Descriptor of a GPIO pin: port, clock enable bit, mask and configuration, resolved at compile time with `PORT_SYSTEM_GPIO_PIN()`. Descriptors are `const`, so tables of pins live in flash and need no initialization code.
+ */
+typedef struct
+{
+    GPIO_TypeDef *p_port; /*!< GPIO port of the pin */
+    uint32_t clock_mask;  /*!< Clock enable bit of the port in `RCC->AHB1ENR` */
+    uint16_t mask;        /*!< Mask of the pin in the registers of the port */
+    uint8_t pin;          /*!< Pin/line of the GPIO (index from 0 to 15) */
+    uint8_t mode;         /*!< Input, output, alternate, or analog */
+    uint8_t pupd;         /*!< Pull-up, pull-down, or no-pull */
+} port_system_gpio_pin_t;
+
+/**
+ * @brief Simulated ADC. It only keeps the registers used by the port layer plus the model of the analog input.
+ */
+typedef struct
+{
+    uint32_t SR;                               /*!< Status register */
+    uint32_t CR1;                              /*!< Control register 1 (resolution and interrupts) */
+    uint32_t CR2;                              /*!< Control register 2 (ADC on) */
+    uint32_t DR;                               /*!< Data register */
+    uint32_t HTR;                              /*!< Watchdog high threshold register */
+    uint32_t LTR;                              /*!< Watchdog low threshold register */
+    uint8_t sequence[ADC_DMA_MAX_CONVERSIONS]; /*!< Channel of each conversion of the regular sequence (SQR1 to SQR3) */
+    uint8_t n_conversions;                     /*!< Length of the regular sequence (L + 1 in SQR1) */
+    port_system_sim_adc_source_t source;       /*!< Model of the analog input */
+    volatile uint16_t *p_dma_buffer;           /*!< Circular buffer of the DMA stream of the ADC */
+    uint16_t dma_length;                       /*!< Number of samples of the circular buffer */
+    uint16_t dma_index;                        /*!< Next sample of the circular buffer written by the DMA */
+    uint32_t dma_flags;                        /*!< Half and full transfer flags of the DMA stream */
+    bool dma_interrupts;                       /*!< Half and full transfer interrupts of the DMA stream enabled (HTIE and TCIE) */
+    uint64_t ready_us;                         /*!< Virtual time at which the ADC has stabilized since it was powered up */
+} ADC_TypeDef;
+
+/**
+ * @brief Simulated timer. The update event is an event of the virtual clock.
+ */
+typedef struct
+{
+    uint32_t CR2;                        /*!< Control register 2 (master mode selection) */
+    uint32_t PSC;                        /*!< Prescaler */
+    uint32_t ARR;                        /*!< Auto-reload register */
+    uint64_t period_us;                  /*!< Period of the update event in microseconds */
+    int8_t event_id;                     /*!< Identifier of the update event in the virtual clock */
+    port_system_sim_callback_t callback; /*!< Simulated ISR of the update event, or NULL if the update interrupt is disabled */
+} TIM_TypeDef;
+
+/**
+ * @brief Time spent by the core asleep (waiting for events) and awake since the system started.
+ */
+typedef struct
+{
+    uint64_t asleep_us; /*!< Time asleep in microseconds (SLEEP or STOP mode) */
+    uint64_t awake_us;  /*!< Time awake in microseconds */
+    uint32_t sleeps;    /*!< Number of times the core has gone to sleep */
+    uint32_t stops;     /*!< Number of times the core has entered STOP mode */
+} port_system_power_stats_t;
+
+/* Global variables -----------------------------------------------------------*/
+extern GPIO_TypeDef port_system_sim_gpio[PORT_SYSTEM_SIM_GPIO_PORTS]; /*!< Simulated GPIO ports */
+extern RCC_TypeDef port_system_sim_rcc;                               /*!< Simulated reset and clock control */
+extern ADC_TypeDef port_system_sim_adc[PORT_SYSTEM_SIM_ADCS];         /*!< Simulated ADCs */
+extern TIM_TypeDef port_system_sim_tim[PORT_SYSTEM_SIM_TIMERS];       /*!< Simulated timers */
+
+/* Function prototypes and explanation -------------------------------------------------*/
+/**
+ * @brief Initializes the simulated system: virtual time goes back to 0, all pending events are discarded and all simulated peripherals are reset.
+ *
+ * @retval Init status
+ */
+size_t port_system_init(void);
+
+/**
+ * @brief Get the virtual time in milliseconds
+ *
+ */
+uint32_t port_system_get_millis(void);
+
+/**
+ * @brief Sets the virtual time in milliseconds.
+ * @warning Pending events are not moved. Use it only to set the time reference before scheduling events.
+ *
+ * @param ms New number of milliseconds since the system started.
+ */
+void port_system_set_millis(uint32_t ms);
+
+/**
+ * @brief Wait for some milliseconds.
+ *
+ * The virtual clock jumps from event to event running their callbacks until the given time has elapsed.
+ *
+ * @param ms Number of milliseconds to wait
+ *
+ * @retval None
+ */
+void port_system_delay_ms(uint32_t ms);
+
+/**
+ * @brief Wait for some milliseconds from a time reference.
+ *
+ * @note It also updates the time reference to the system time at return.
+ *
+ * @param p_t Pointer to the time reference
+ * @param ms Number of milliseconds to wait
+ *
+ * @retval None
+ */
+void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms);
+
+/**
+ * @brief Wait for some microseconds. The virtual clock runs exactly the given time, as the cycle counter of the DWT does in the target.
+ *
+ * @param us Number of microseconds to wait
+ */
+void port_system_delay_us(uint32_t us);
+
+/**
+ * @brief Get the number of cycles of the simulated core since the system started: the virtual time at `PORT_SYSTEM_CORE_CLOCK_HZ`. It wraps around every 2^32 cycles, as `CYCCNT` does.
+ *
+ * @return uint32_t Cycles of the core
+ */
+uint32_t port_system_get_cycles(void);
+
+/**
+ * @brief Write to the trace output: `stdout` in the native platform, as the stimulus port 0 of the ITM in the target. It carries the binary frames of the telemetry.
+ *
+ * @param p_data Pointer to the text
+ * @param length Number of characters
+ */
+void port_system_trace_write(const char *p_data, uint32_t length);
+
+/**
+ * @brief Write text for the developer (e.g., the dump of the profiler): `stderr` in the native platform, as a second stimulus port of the ITM in the target, so that it does not corrupt the binary frames of the trace output.
+ *
+ * @param p_data Pointer to the text
+ * @param length Number of characters
+ */
+void port_system_trace_write_text(const char *p_data, uint32_t length);
+
+/**
+ * @brief Get the virtual time in microseconds. It is monotonic and it does not wrap around, as the time base of the target in tickless mode.
+ *
+ * @return uint64_t Microseconds since the system started.
+ */
+uint64_t port_system_get_time_us(void);
+
+/**
+ * @brief Sets the time to wake up the main loop. `PORT_SYSTEM_EVENT_TIMEOUT` is posted at that time. Only one wake-up time is kept: it replaces the previous one.
+ *
+ * @param t_us Time in microseconds (see `port_system_get_time_us()`). If it has already passed, the event is posted immediately.
+ */
+void port_system_set_wakeup_us(uint64_t t_us);
+
+/**
+ * @brief Cancels the wake-up time set with `port_system_set_wakeup_us()`.
+ */
+void port_system_cancel_wakeup(void);
+
+/**
+ * @brief Enters a critical section. The simulated ISRs only run from the virtual clock, so there is nothing to mask in the native platform.
+ *
+ * @return uint32_t Previous state of the mask, for `port_system_critical_exit()`.
+ */
+uint32_t port_system_critical_enter(void);
+
+/**
+ * @brief Leaves a critical section.
+ *
+ * @param state Value returned by `port_system_critical_enter()`.
+ */
+void port_system_critical_exit(uint32_t state);
+
+/**
+ * @brief Post events to the main loop.
+ *
+ * @param events Mask of events (`PORT_SYSTEM_EVENT_*`) to post.
+ */
+void port_system_post_event(uint32_t events);
+
+/**
+ * @brief Sleep until an ISR posts an event, and return all the pending events.
+ *
+ * The virtual clock jumps from event to event until a simulated ISR posts an event. If there are no pending events in the virtual clock, nothing can ever wake up the system: it returns 0 at once, and the caller ends the simulation (e.g., `main()` returns).
+ *
+ * @return uint32_t Mask of the pending events. They are cleared. 0 if the simulation has ended.
+ */
+uint32_t port_system_wait_for_events(void);
+
+/**
+ * @brief Enables or disables the STOP mode while waiting for events. In the simulation, it only changes the statistics of the sleeps.
+ *
+ * @param enable true to enter STOP mode while waiting for events, false to enter SLEEP mode.
+ */
+void port_system_set_stop_mode(bool enable);
+
+/**
+ * @brief Prevents or allows the STOP mode, e.g., while the ADC is converting a sequence that has been started by software.
+ *
+ * @param inhibit true while a peripheral needs its clock, false when it has finished.
+ */
+void port_system_inhibit_stop(bool inhibit);
+
+/**
+ * @brief Starts the periodic wake-up timer of the simulated RTC. It calls `RTC_WKUP_IRQHandler()` every period of virtual time.
+ *
+ * @param period_ms Period in milliseconds.
+ */
+void port_system_rtc_wakeup_start(uint32_t period_ms);
+
+/**
+ * @brief Stops the wake-up timer of the simulated RTC.
+ */
+void port_system_rtc_wakeup_stop(void);
+
+/**
+ * @brief Handles the interrupt of the wake-up timer of the RTC. To be called from `RTC_WKUP_IRQHandler()`. The virtual clock does not stop in STOP mode, so there is no time to add to the time base.
+ */
+void port_system_rtc_wakeup_handle(void);
+
+/**
+ * @brief Gets the time spent by the core asleep and awake since the system started.
+ *
+ * @param p_stats Pointer to the structure to store the statistics.
+ */
+void port_system_get_power_stats(port_system_power_stats_t *p_stats);
+
+/**
+ * @brief Checks if the simulated core would be in STOP mode while waiting for events now.
+ *
+ * @return true if the STOP mode is enabled and no peripheral inhibits it.
+ */
+bool port_system_sim_stop_allowed(void);
+
+/**
+ * @brief Configure the mode and pull of a simulated GPIO
+ *
+ * @param p_port Port of the GPIO
+ * @param pin Pin/line of the GPIO (index from 0 to 15)
+ * @param mode Input, output, alternate, or analog
+ * @param pupd Pull-up, pull-down, or no-pull
+ *
+ * @retval None
+ */
+void port_system_gpio_config(GPIO_TypeDef *p_port, uint8_t pin, uint8_t mode, uint8_t pupd);
+
+/**
+ * @brief Configures a GPIO pin from its descriptor. The clock of the port is enabled with the bit of the descriptor: no look-up of the port.
+ *
+ * @param p_pin Descriptor of the pin.
+ */
+void port_system_gpio_config_pin(const port_system_gpio_pin_t *p_pin);
+
+/**
+ * @brief Sets and clears several output pins of a port at once: an output group.
+ *
+ * It is a single write to the bit set/reset register (BSRR), so it is atomic (no read-modify-write of ODR that an ISR could interrupt), all the pins change in the same bus transaction (no glitch between them), and the other pins of the port are not touched. If a pin is in both masks, it is set.
+ *
+ * @param p_port Port of the GPIOs.
+ * @param set_mask Pins to set (bit i is pin i).
+ * @param reset_mask Pins to clear (bit i is pin i).
+ */
+void port_system_gpio_write(GPIO_TypeDef *p_port, uint16_t set_mask, uint16_t reset_mask);
+
+/**
+ * @brief Configure the simulated ADC peripheral for a single channel
+ *
+ * @param p_adc ADC peripheral
+ * @param channel Channel number (from 0 to 15)
+ * @param cr_mode Control register mode. It supports the resolution and the end of conversion interrupt.
+ */
+void port_system_adc_single_ch_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode);
+
+/**
+ * @brief Enable the simulated ADC global interrupt. The simulated `ADC_IRQHandler()` is called at the end of each conversion.
+ *
+ * @param priority Ignored in the native platform
+ * @param subpriority Ignored in the native platform
+ */
+void port_system_adc_interrupt_enable(uint8_t priority, uint8_t subpriority);
+
+/**
+ * @brief Enable the simulated ADC peripheral to work. It waits until the ADC stabilizes (`ADC_STABILIZATION_US`).
+ *
+ * @param p_adc ADC peripheral
+ */
+void port_system_adc_enable(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Starts the power-up of the simulated ADC and returns without waiting for it to stabilize.
+ *
+ * @param p_adc ADC peripheral
+ */
+void port_system_adc_power_up_start(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Checks if the simulated ADC has stabilized since `port_system_adc_power_up_start()`.
+ *
+ * @param p_adc ADC peripheral
+ * @return true if the ADC is ready to convert, false otherwise.
+ */
+bool port_system_adc_power_up_ready(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Disable the simulated ADC peripheral
+ *
+ * @param p_adc ADC peripheral
+ */
+void port_system_adc_disable(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Start the conversion of the simulated ADC peripheral
+ *
+ * It schedules the end of conversion `PORT_SYSTEM_SIM_ADC_CONVERSION_US` microseconds later. At that time, the analog model of the ADC is sampled, the value is stored in DR and the EOC flag is set.
+ *
+ * @param p_adc ADC peripheral
+ * @param channel Channel number (from 0 to 15)
+ */
+void port_system_adc_start_conversion(ADC_TypeDef *p_adc, uint8_t channel);
+
+/**
+ * @brief Configure the simulated ADC peripheral to convert a channel several times per trigger and move the results to memory with the DMA
+ *
+ * Each trigger converts `n_conversions` times the channel and stores the results in the circular buffer. The half and full transfer flags are set when each half of the buffer is full, and then the simulated `DMA2_Stream0_IRQHandler()` is called if enabled.
+ *
+ * @note Only the stream of ADC1 (DMA2 stream 0) is simulated.
+ *
+ * @param p_adc ADC peripheral
+ * @param channel Channel number (from 0 to 15)
+ * @param cr_mode Control register mode. It supports the resolution.
+ * @param p_buffer Circular buffer of `2 * n_conversions` samples
+ * @param n_conversions Number of conversions of each sequence (from 1 to `ADC_DMA_MAX_CONVERSIONS`)
+ */
+void port_system_adc_dma_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode, volatile uint16_t *p_buffer, uint8_t n_conversions);
+
+/**
+ * @brief Configure the simulated ADC peripheral to convert a sequence of channels per trigger and move the results to memory with the DMA.
+ *
+ * It is the same as `port_system_adc_dma_init()`, but each conversion of the sequence samples the analog model of its own channel.
+ *
+ * @param p_adc ADC peripheral
+ * @param p_channels Channel of each conversion of the sequence (from 0 to 15)
+ * @param n_conversions Number of conversions of each sequence (from 1 to `ADC_DMA_MAX_CONVERSIONS`)
+ * @param cr_mode Control register mode. It supports the resolution.
+ * @param p_buffer Circular buffer of `2 * n_conversions` samples
+ */
+void port_system_adc_dma_scan_init(ADC_TypeDef *p_adc, const uint8_t *p_channels, uint8_t n_conversions, uint32_t cr_mode, volatile uint16_t *p_buffer);
+
+/**
+ * @brief Enable the simulated interrupt of the DMA stream of an ADC.
+ *
+ * @param p_adc ADC peripheral
+ * @param priority Ignored in the native platform
+ * @param subpriority Ignored in the native platform
+ */
+void port_system_adc_dma_interrupt_enable(ADC_TypeDef *p_adc, uint8_t priority, uint8_t subpriority);
+
+/**
+ * @brief Get and clear the half and full transfer flags of the DMA stream of an ADC.
+ *
+ * @param p_adc ADC peripheral
+ * @return uint32_t Mask of `ADC_DMA_HALF_TRANSFER` and `ADC_DMA_TRANSFER_COMPLETE`
+ */
+uint32_t port_system_adc_dma_get_and_clear_flags(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Enable or disable the half and full transfer interrupts of the DMA stream of a simulated ADC. The flags of the transfers that ended while they were disabled are cleared before enabling them.
+ *
+ * @param p_adc ADC peripheral
+ * @param enable true to enable the interrupts, false to disable them
+ */
+void port_system_adc_dma_set_interrupts(ADC_TypeDef *p_adc, bool enable);
+
+/**
+ * @brief Enable the analog watchdog of the simulated ADC peripheral on a single regular channel
+ *
+ * At the end of a sequence, if any conversion of the channel was above `high` or below `low`, the analog watchdog flag is set and the simulated `ADC_IRQHandler()` is called, if enabled.
+ *
+ * @param p_adc ADC peripheral
+ * @param channel Channel number (from 0 to 15)
+ * @param low Low threshold in counts of 12 bits (LTR)
+ * @param high High threshold in counts of 12 bits (HTR)
+ */
+void port_system_adc_watchdog_enable(ADC_TypeDef *p_adc, uint8_t channel, uint16_t low, uint16_t high);
+
+/**
+ * @brief Disable the analog watchdog of the simulated ADC peripheral and its interrupt, and clear its flag.
+ *
+ * @param p_adc ADC peripheral
+ */
+void port_system_adc_watchdog_disable(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Select the external trigger that starts the regular sequence of the simulated ADC peripheral, on its rising edge.
+ *
+ * @param p_adc ADC peripheral
+ * @param trigger External trigger (`ADC_EXTERNAL_TRIGGER_*`)
+ */
+void port_system_adc_set_external_trigger(ADC_TypeDef *p_adc, uint32_t trigger);
+
+/**
+ * @brief Start the conversion of the regular sequence of the simulated ADC peripheral, as configured by `port_system_adc_dma_init()`.
+ *
+ * The end of the sequence is scheduled `n_conversions * PORT_SYSTEM_SIM_ADC_CONVERSION_US` microseconds later. Each conversion samples the analog model at its own time.
+ *
+ * @param p_adc ADC peripheral
+ */
+void port_system_adc_start_scan(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Set the model of the analog input of a simulated ADC.
+ *
+ * @param p_adc ADC peripheral
+ * @param source Function that returns the counts of a 12-bit conversion for a given channel and virtual time.
+ */
+void port_system_sim_adc_set_source(ADC_TypeDef *p_adc, port_system_sim_adc_source_t source);
+
+/**
+ * @brief Start the periodic update event of a simulated timer.
+ *
+ * At every update event, if the master mode of the timer is "update" (`TIM_CR2_MMS_1` in CR2), the trigger output starts the regular sequence of the ADCs whose external trigger is this timer. Then, the callback is called.
+ *
+ * @param p_tim Timer
+ * @param period_us Period of the update event in microseconds
+ * @param callback Simulated ISR of the update event, or NULL if the update interrupt is not used. Its argument is the timer.
+ */
+void port_system_sim_timer_start(TIM_TypeDef *p_tim, uint64_t period_us, port_system_sim_callback_t callback);
+
+/**
+ * @brief Stop the update event of a simulated timer.
+ *
+ * @param p_tim Timer
+ */
+void port_system_sim_timer_stop(TIM_TypeDef *p_tim);
+
+/**
+ * @brief Get the virtual time in microseconds.
+ *
+ * @return uint64_t Virtual time in microseconds.
+ */
+uint64_t port_system_sim_get_time_us(void);
+
+/**
+ * @brief Schedule an event in the virtual clock.
+ *
+ * @param delay_us Time from now to the first occurrence of the event in microseconds
+ * @param period_us Period of the event in microseconds. 0 for a one-shot event.
+ * @param callback Function to call when the event occurs
+ * @param p_arg Argument given to the callback
+ * @return int8_t Identifier of the event, or `PORT_SYSTEM_SIM_NO_EVENT` if there is no room for more events.
+ */
+int8_t port_system_sim_schedule(uint64_t delay_us, uint64_t period_us, port_system_sim_callback_t callback, void *p_arg);
+
+/**
+ * @brief Cancel a pending event of the virtual clock.
+ *
+ * @param event_id Identifier of the event returned by `port_system_sim_schedule()`.
+ */
+void port_system_sim_cancel(int8_t event_id);
+
+/**
+ * @brief Jump to the next pending event and run its callback.
+ *
+ * Events due at the same time run in the order they were scheduled.
+ *
+ * @return true if an event was run, false if there are no pending events.
+ */
+bool port_system_sim_step(void);
+
+/**
+ * @brief Run all the events due up to a given virtual time, and leave the virtual clock at that time.
+ *
+ * @param t_us Virtual time to reach in microseconds.
+ */
+void port_system_sim_run_until_us(uint64_t t_us);
+
+#endif /* PORT_SYSTEM_H_ */
@@ -0,0 +1,203 @@
+/**
+ * @file port_temp_sensor.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the temperature sensor port layer of the native platform.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_TEMP_SENSOR_H
+#define PORT_TEMP_SENSOR_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdbool.h>
+
+/* HW dependent includes */
+#include "port_system.h"
+
+/* Other includes */
+#include "thermostat_filter.h"
+
+/* Defines and macros --------------------------------------------------------*/
+// Simulated HW (same pinout as the Nucleo-STM32F446RE):
+#define TEMP_SENSOR_THERMOSTAT_GPIO GPIOA    /*!< GPIO port of the temperature sensor */
+#define TEMP_SENSOR_THERMOSTAT_PIN 0         /*!< GPIO pin of the temperature sensor */
+#define TEMP_SENSOR_THERMOSTAT_ADC ADC1      /*!< ADC of the temperature sensor */
+#define TEMP_SENSOR_THERMOSTAT_ADC_TRIGGER ADC_EXTERNAL_TRIGGER_TIM2_TRGO /*!< External trigger of the conversions: the trigger output of the measurement timer */
+#define TEMP_SENSOR_THERMOSTAT_ADC_CHANNEL 0 /*!< ADC channel of the temperature sensor */
+
+#ifndef TEMP_SENSOR_OVERSAMPLING_BITS
+#define TEMP_SENSOR_OVERSAMPLING_BITS 2U /*!< Extra bits of resolution obtained by oversampling and decimation. Each extra bit takes 4 times more conversions */
+#endif
+#define TEMP_SENSOR_OVERSAMPLING (1U << (2U * TEMP_SENSOR_OVERSAMPLING_BITS)) /*!< Number of conversions of each measurement */
+#define TEMP_SENSOR_ADC_BITS (12U + TEMP_SENSOR_OVERSAMPLING_BITS)            /*!< Effective resolution of a measurement in bits */
+#define TEMP_SENSOR_SCAN_MAX_SENSORS ADC_DMA_MAX_CONVERSIONS                    /*!< Maximum number of sensors converted by one trigger of an ADC: one slot of the regular sequence each */
+
+/* Typedefs --------------------------------------------------------------------*/
+/**
+ * @brief Structure to define the HW dependencies of a temperature sensor.
+ */
+typedef struct
+{
+    GPIO_TypeDef *p_port;          /*!< GPIO where the temperature is connected */
+    uint8_t pin;                   /*!< Pin/line where the temperature is connected */
+    ADC_TypeDef *p_adc;            /*!< ADC where the temperature is connected */
+    uint32_t adc_channel;          /*!< ADC channel where the temperature is connected */
+    volatile uint32_t adc_counts;  /*!< Last measurement in counts of `TEMP_SENSOR_ADC_BITS` bits */
+    volatile uint32_t sample_seq;  /*!< Sequence number of the last sample. It is incremented in the ISR every time a new sample is saved */
+    uint8_t scan_slot;             /*!< Position of the sensor in the scan of its ADC */
+    thermostat_filter_t *p_filter; /*!< Filter of the measurements, or NULL to keep them as they are */
+} port_temp_hw_t;
+
+/**
+ * @brief Structure to define the scan of the sensors of an ADC: all of them are converted by one trigger, and their measurements are routed to each sensor at the end of the sequence.
+ *
+ * The regular sequence holds `n_sensors` channels, interleaved `4^oversampling_bits` times: the conversion `r * n_sensors + i` is the round `r` of the sensor `i`. The oversampling is the largest one (up to `TEMP_SENSOR_OVERSAMPLING`) whose sequence fits in `ADC_DMA_MAX_CONVERSIONS` slots.
+ */
+typedef struct
+{
+    ADC_TypeDef *p_adc;                                        /*!< ADC of the sensors */
+    port_temp_hw_t *p_sensors[TEMP_SENSOR_SCAN_MAX_SENSORS];   /*!< Sensors of the scan, in the order of the sequence */
+    uint8_t n_sensors;                                         /*!< Number of sensors of the scan */
+    uint8_t oversampling_bits;                                 /*!< Extra bits of each measurement obtained by oversampling and decimation with this number of sensors */
+    uint8_t n_conversions;                                     /*!< Number of conversions of each sequence */
+    volatile bool watched;                                     /*!< The analog watchdog is armed and the DMA interrupts are disabled */
+    volatile uint16_t adc_buffer[2 * ADC_DMA_MAX_CONVERSIONS]; /*!< Circular buffer filled by the DMA: two sequences of conversions, one being processed while the other is filled */
+} port_temp_scan_t;
+
+/* Global variables -----------------------------------------------------------*/
+extern port_temp_hw_t temp_sensor_thermostat; /*!< Temperature sensor of the thermostat system. Public for access to interrupt handlers. */
+extern port_temp_scan_t temp_sensor_scan;      /*!< Scan of the sensors of `TEMP_SENSOR_THERMOSTAT_ADC`. Public for access to interrupt handlers. */
+
+/**
+ * @brief Gets the temperature of the temperature sensor in milli-degrees Celsius.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @return int32_t Temperature in milli-degrees Celsius.
+ */
+int32_t port_temp_sensor_get_temperature_mcelsius(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Gets the last measurement of the temperature sensor in raw ADC counts.
+ *
+ * The counts grow with the temperature, so they can be compared directly with a threshold converted with `port_temp_sensor_mcelsius_to_adc_counts()`.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @return uint32_t Measurement in counts of `TEMP_SENSOR_ADC_BITS` bits.
+ */
+uint32_t port_temp_sensor_get_adc_counts(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Converts a temperature into raw ADC counts of the temperature sensor.
+ *
+ * It returns the smallest measurement whose temperature is not below the given one, so that `counts < port_temp_sensor_mcelsius_to_adc_counts(p_temp, t)` is the same as `temperature < t`. Temperatures out of the range of the ADC are saturated.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @param mcelsius Temperature in milli-degrees Celsius.
+ * @return uint32_t Counts of `TEMP_SENSOR_ADC_BITS` bits (from 0 to 2^`TEMP_SENSOR_ADC_BITS`).
+ */
+uint32_t port_temp_sensor_mcelsius_to_adc_counts(port_temp_hw_t *p_temp, int32_t mcelsius);
+
+/**
+ * @brief Gets the sequence number of the last sample of the temperature sensor.
+ *
+ * The sequence number changes every time a new sample is saved, so the consumers of the temperature can skip their work when it has not changed since their last read.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @return uint32_t Sequence number of the last sample.
+ */
+uint32_t port_temp_sensor_get_sample_seq(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Saves the ADC value of the temperature sensor. It also increments the sequence number of the samples.
+ *
+ * If the sensor has a filter, the value is passed through it first: the consumers only see the filtered measurement. The trace records the value before the filter, so that a replay goes through the same filter.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @param adc_value ADC value of the temperature sensor with a resolution of `TEMP_SENSOR_ADC_BITS` bits.
+ */
+void port_temp_sensor_save_adc_value(port_temp_hw_t *p_temp, uint32_t adc_value);
+
+/**
+ * @brief Saves a sequence of conversions of a scan: the measurement of each sensor is routed to it.
+ *
+ * The conversions of each sensor are oversampled and decimated: the sum of 4^n samples of 12 bits is shifted right n bits, which gives a measurement of 12 + n bits with less noise. It is scaled to `TEMP_SENSOR_ADC_BITS` bits and saved with `port_temp_sensor_save_adc_value()`, so each thermostat sees a new sample of its own sensor.
+ *
+ * @param p_scan Pointer to the scan.
+ * @param p_samples Half of the DMA buffer that has just been filled.
+ */
+void port_temp_sensor_scan_save_samples(port_temp_scan_t *p_scan, const volatile uint16_t *p_samples);
+
+/**
+ * @brief Attaches a filter to the temperature sensor, e.g., a running median to remove the spikes of the measurements before the thermostat evaluates them. The filter is reset.
+ *
+ * The filter runs in the ISR of the DMA, with every new measurement. When the analog watchdog is used, the watchdog compares the raw conversions, so the filter only sees the measurements around the crossings of the threshold.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @param p_filter Pointer to the filter, initialized with one of the `thermostat_filter_init_*()` functions, or NULL to remove the filter.
+ */
+void port_temp_sensor_set_filter(port_temp_hw_t *p_temp, thermostat_filter_t *p_filter);
+
+/**
+ * @brief Selects how the measurements of the temperature sensor are started: by the trigger output of the measurement timer (`TEMP_SENSOR_THERMOSTAT_ADC_TRIGGER`), or by software with `port_temp_sensor_start_measurement()`.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @param enable true to use the external trigger, false to start the measurements by software.
+ */
+void port_temp_sensor_set_external_trigger(port_temp_hw_t *p_temp, bool enable);
+
+/**
+ * @brief Starts a measurement of the temperature sensor by software, e.g., from the wake-up ISR of the RTC in low-power mode.
+ *
+ * The STOP mode is inhibited until the DMA has moved the whole sequence of conversions and the measurement has been saved. While the analog watchdog is armed, the DMA does not interrupt at the end of the sequence, so the STOP mode is not inhibited: the ADC only misses its clock while the core is stopped, and the watchdog checks the conversions when it resumes.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ */
+void port_temp_sensor_start_measurement(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Stops the measurements until the temperature leaves a window, using the analog watchdog of the ADC.
+ *
+ * The analog watchdog belongs to the ADC and the DMA interrupts are shared by the whole scan, so it is only armed if the sensor is alone in its scan. Otherwise, the sensor keeps being measured at every trigger.
+ *
+ * The DMA keeps moving the conversions, but its interrupts are disabled: the CPU is not woken up while the conversions stay inside the window, and a measurement in progress does not inhibit the STOP mode anymore. The window is checked in hardware on each single conversion of 12 bits, so its limits are rounded to 12 bits. When a conversion leaves the window, `port_temp_sensor_watchdog_triggered()` enables the interrupts of the DMA again, and the next measurement is saved as usual.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ * @param low_counts The watchdog triggers below this measurement, in counts of `TEMP_SENSOR_ADC_BITS` bits. 0 to disable the low limit.
+ * @param high_counts The watchdog triggers above this measurement, in counts of `TEMP_SENSOR_ADC_BITS` bits.
+ */
+void port_temp_sensor_watch(port_temp_hw_t *p_temp, uint32_t low_counts, uint32_t high_counts);
+
+/**
+ * @brief Stops the analog watchdog of the temperature sensor and resumes the measurement of every sequence.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ */
+void port_temp_sensor_unwatch(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Handles the analog watchdog of the temperature sensor. To be called from the ADC ISR when the watchdog flag is set.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ */
+void port_temp_sensor_watchdog_triggered(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Initializes the temperature sensor and adds it to the scan of its ADC.
+ *
+ * The regular sequence of the ADC is configured again with all the sensors of the scan, so that one trigger converts all of them and the DMA interrupts once per sequence. All the sensors must be connected to `TEMP_SENSOR_THERMOSTAT_ADC`. Initializing a sensor of the scan again only configures the ADC again.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ */
+void port_temp_sensor_init(port_temp_hw_t *p_temp);
+
+/**
+ * @brief Removes the temperature sensor from the scan of its ADC. The sequence is configured again with the remaining sensors.
+ *
+ * @param p_temp Pointer to the temperature sensor structure.
+ */
+void port_temp_sensor_deinit(port_temp_hw_t *p_temp);
+
+#endif /* PORT_TEMP_SENSOR_H */
@@ -0,0 +1,56 @@
+/**
+ * @file port_thermostat.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the thermostat system port layer of the native platform.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_THERMOSTAT_H
+#define PORT_THERMOSTAT_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+
+/* HW dependent includes */
+#include "port_system.h"
+#include "fsm_thermostat.h"
+
+/* Defines and macros --------------------------------------------------------*/
+// Simulated HW:
+#define THERMOSTAT_MEASUREMENT_TIMER TIM2 /*!< Timer to measure the temperature */
+#define THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX 0xFFFFFFFFU /*!< Maximum auto-reload value of the measurement timer: TIM2 has a 32-bit counter */
+#define THERMOSTAT_MEASUREMENT_TIMER_PSC_MAX 0xFFFFU /*!< Maximum prescaler of the measurement timer: PSC has 16 bits */
+#define THERMOSTAT_MEASUREMENT_TIMER_MAX_TICKS TIMER_PERIOD_TICKS(THERMOSTAT_MEASUREMENT_TIMER_PSC_MAX, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX) /*!< Longest period of the measurement timer in ticks of its clock */
+#define THERMOSTAT_PERIOD_MAX_MS ((THERMOSTAT_MEASUREMENT_TIMER_MAX_TICKS / TIMER_TICKS_MS(1)) > UINT32_MAX ? UINT32_MAX : (uint32_t)(THERMOSTAT_MEASUREMENT_TIMER_MAX_TICKS / TIMER_TICKS_MS(1))) /*!< Longest period of the measurements in milliseconds that the measurement timer can hold */
+
+/**
+ * @brief Initializes the timer of the thermostat. Its update event, which triggers the ADC, happens every `period_ms` of virtual time, rounded as the prescaler and the auto-reload value of the real timer.
+ *
+ * @param p_thermostat Pointer to the thermostat structure.
+ * @param period_ms Period of the measurements in milliseconds.
+ */
+void port_thermostat_timer_setup(fsm_thermostat_t *p_thermostat, uint32_t period_ms);
+
+/**
+ * @brief Changes the period of the measurements of the thermostat: the period of its timer or, in low-power mode, of the wake-up timer of the RTC. Only integer arithmetic is used.
+ *
+ * @param p_thermostat Pointer to the thermostat structure.
+ * @param period_ms Period of the measurements in milliseconds.
+ * @param low_power true if the thermostat is in low-power mode.
+ */
+void port_thermostat_timer_set_period(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool low_power);
+
+/**
+ * @brief Enables or disables the low-power mode of the thermostat.
+ *
+ * In low-power mode, the measurement timer is stopped and the wake-up timer of the RTC triggers the measurements every `period_ms`, because it keeps running in STOP mode. The core enters STOP mode between the measurements.
+ *
+ * @param p_thermostat Pointer to the thermostat structure.
+ * @param period_ms Period of the measurements in milliseconds.
+ * @param enable true to enable the low-power mode, false to go back to the measurement timer.
+ */
+void port_thermostat_set_low_power(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool enable);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file port_uart.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the UART port layer of the native platform.
+ *
+ * The USART2 and its DMA streams are simulated on the virtual clock with the timing of a 8N1 line at `PORT_UART_BAUDRATE`:
+ * - Reception: `port_uart_sim_receive()` plays the host. Its bytes are written into the circular buffer as the DMA would, and the simulated `USART2_IRQHandler()` is called one frame after the last byte (idle line).
+ * - Transmission: `port_uart_send()` starts a transfer that lasts one frame per byte. At its end, the bytes are appended to `port_uart_sim_tx` and the simulated `DMA1_Stream6_IRQHandler()` is called.
+ *
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_UART_H
+#define PORT_UART_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and macros --------------------------------------------------------*/
+// Simulated HW:
+#define PORT_UART_BAUDRATE 115200U                                                            /*!< Baud rate of the UART: 8 data bits, no parity, 1 stop bit */
+#define PORT_UART_SIM_FRAME_US ((10U * 1000000U + PORT_UART_BAUDRATE - 1U) / PORT_UART_BAUDRATE) /*!< Duration of a frame (start, 8 data and stop bits) in microseconds, rounded up */
+#ifndef PORT_UART_RX_SIZE
+#define PORT_UART_RX_SIZE 256U /*!< Size in bytes of the circular buffer of reception. It must be a power of 2 */
+#endif
+#ifndef PORT_UART_SIM_TX_SIZE
+#define PORT_UART_SIM_TX_SIZE 4096U /*!< Size in bytes of the record of the transmitted bytes. The bytes beyond it are counted but not kept */
+#endif
+
+/* Global variables -----------------------------------------------------------*/
+extern uint8_t port_uart_sim_tx[PORT_UART_SIM_TX_SIZE]; /*!< Bytes transmitted since `port_uart_init()`, as the host receives them */
+extern uint32_t port_uart_sim_tx_length;               /*!< Number of bytes transmitted since `port_uart_init()` */
+extern uint32_t port_uart_sim_tx_transfers;            /*!< Number of transfers of the DMA of transmission since `port_uart_init()` */
+extern uint32_t port_uart_sim_rx_irqs;                 /*!< Number of idle line interrupts since `port_uart_init()` */
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Configures the simulated UART and its DMA streams, and starts the reception. The circular buffer is cleared and the record of the transmitted bytes is emptied.
+ *
+ */
+void port_uart_init(void);
+
+/**
+ * @brief Gets the circular buffer in which the DMA writes the received bytes.
+ *
+ * @return const volatile uint8_t* Buffer of `PORT_UART_RX_SIZE` bytes.
+ */
+const volatile uint8_t *port_uart_get_rx_buffer(void);
+
+/**
+ * @brief Gets the position of the circular buffer in which the DMA will write the next received byte.
+ *
+ * @return uint32_t Index from 0 to `PORT_UART_RX_SIZE` - 1.
+ */
+uint32_t port_uart_get_rx_head(void);
+
+/**
+ * @brief Starts the transmission of a buffer by the DMA. It does not wait: `PORT_SYSTEM_EVENT_UART` is posted when the transfer ends.
+ *
+ * @param p_data Bytes to send. They must stay valid and unchanged until the end of the transfer.
+ * @param length Number of bytes to send (up to 65535).
+ * @return true if the transfer has started, false if the previous one has not ended yet.
+ */
+bool port_uart_send(const uint8_t *p_data, uint32_t length);
+
+/**
+ * @brief Checks if a transmission is in progress.
+ *
+ * @return true if the DMA has not finished the last transfer, false otherwise.
+ */
+bool port_uart_tx_busy(void);
+
+/**
+ * @brief Gets and clears the idle line flag of the UART. To be called from `USART2_IRQHandler()`.
+ *
+ * @return true if the line has become idle after a burst of received bytes.
+ */
+bool port_uart_get_and_clear_rx_idle(void);
+
+/**
+ * @brief Gets and clears the transfer complete flag of the DMA stream of transmission. To be called from `DMA1_Stream6_IRQHandler()`.
+ *
+ * @return true if the DMA has finished a transfer.
+ */
+bool port_uart_get_and_clear_tx_complete(void);
+
+/**
+ * @brief Simulates the reception of a burst of bytes sent by the host. The bytes are in the circular buffer at once, and the idle line interrupt comes one frame after the time the last byte takes to arrive.
+ *
+ * @param p_data Bytes received.
+ * @param length Number of bytes received.
+ */
+void port_uart_sim_receive(const char *p_data, uint32_t length);
+
+#endif /* PORT_UART_H */
@@ -0,0 +1,122 @@
+/**
+ * @file interr.c
+ * @brief Simulated interrupt service routines for the native platform. They are called by the virtual clock.
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @date 2024-04-01
+ */
+// Include headers of different port elements:
+#include "port_system.h"
+#include "port_temp_sensor.h"
+#include "port_uart.h"
+#include "thermostat_profile.h"
+
+//------------------------------------------------------
+// INTERRUPT SERVICE ROUTINES
+//------------------------------------------------------
+/**
+ * @brief Simulated interrupt service routine for the DMA2 stream 0 (ADC1).
+ *
+ * @note This ISR is called by the virtual clock at the end of a sequence of conversions, when the DMA has filled one half of the circular buffer of the scan of the temperature sensors.
+ *
+ */
+void DMA2_Stream0_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_DMA_ISR);
+
+  uint32_t flags = port_system_adc_dma_get_and_clear_flags(temp_sensor_scan.p_adc);
+
+  // The DMA keeps filling the other half of the buffer while this one is processed. Each half holds the whole sequence of the scan, which is routed to every sensor
+  if (flags & ADC_DMA_HALF_TRANSFER)
+  {
+    port_temp_sensor_scan_save_samples(&temp_sensor_scan, &temp_sensor_scan.adc_buffer[0]);
+  }
+  if (flags & ADC_DMA_TRANSFER_COMPLETE)
+  {
+    port_temp_sensor_scan_save_samples(&temp_sensor_scan, &temp_sensor_scan.adc_buffer[temp_sensor_scan.n_conversions]);
+  }
+
+  // Wake up the main loop
+  if (flags != 0)
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_SAMPLE);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_DMA_ISR);
+}
+
+/**
+ * @brief Simulated interrupt service routine for all the ADCs.
+ *
+ * @note This ISR is called by the virtual clock at the end of a sequence of conversions if the analog watchdog flag is set.
+ *
+ */
+void ADC_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_ADC_ISR);
+
+  // Identify if the ADC that generated the interrupt is the same as the temperature sensor
+  if ((temp_sensor_thermostat.p_adc->CR1 & ADC_CR1_AWDIE) && (temp_sensor_thermostat.p_adc->SR & ADC_SR_AWD))
+  {
+    // The temperature has left the window of the watchdog: measure it again
+    port_temp_sensor_watchdog_triggered(&temp_sensor_thermostat);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_ADC_ISR);
+}
+
+/**
+ * @brief Simulated interrupt service routine for the wake-up timer of the RTC.
+ *
+ * @note This ISR is called by the virtual clock every period of the wake-up timer of the RTC. In low-power mode, it starts the measurement of the temperature instead of the measurement timer.
+ *
+ */
+void RTC_WKUP_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_RTC_ISR);
+
+  port_system_rtc_wakeup_handle();
+
+  // The ADC is triggered by software: the timers are stopped in STOP mode
+  if (!(temp_sensor_thermostat.p_adc->CR2 & ADC_CR2_EXTEN))
+  {
+    port_temp_sensor_start_measurement(&temp_sensor_thermostat);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_RTC_ISR);
+}
+
+/**
+ * @brief Simulated interrupt service routine for USART2.
+ *
+ * @note This ISR is called by the virtual clock one frame after the end of a burst of bytes given to `port_uart_sim_receive()`. The bytes are parsed by the main loop.
+ *
+ */
+void USART2_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_UART_ISR);
+
+  if (port_uart_get_and_clear_rx_idle())
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_UART);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_UART_ISR);
+}
+
+/**
+ * @brief Simulated interrupt service routine for the DMA1 stream 6 (USART2_TX).
+ *
+ * @note This ISR is called by the virtual clock when the simulated DMA has sent the last byte of a transmission. The main loop may then send the next reply.
+ *
+ */
+void DMA1_Stream6_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_UART_ISR);
+
+  if (port_uart_get_and_clear_tx_complete())
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_UART);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_UART_ISR);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file port_flash.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Port layer for the flash in the native platform: the sector of the configuration is emulated in RAM.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+/* Standard C includes */
+#include <string.h>
+
+/* HW dependent includes */
+#include "port_flash.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define PORT_FLASH_SECTOR_WORDS (PORT_FLASH_SECTOR_SIZE / sizeof(uint32_t)) /*!< Words of the sector */
+
+_Static_assert((PORT_FLASH_SECTOR_SIZE % sizeof(uint32_t)) == 0, "The sector is made of words");
+
+/* Global variables -----------------------------------------------------------*/
+uint32_t port_flash_sim_erases = 0;
+uint32_t port_flash_sim_words_read = 0;
+
+static uint32_t sim_sector[PORT_FLASH_SECTOR_WORDS]; /*!< Emulated sector */
+static bool sim_formatted = false;                   /*!< The emulated sector has been erased once: the flash of a new device is erased */
+static uint32_t sim_power_budget = UINT32_MAX;       /*!< Words that can still be programmed before the power is cut */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Erases the emulated sector the first time it is used, as a new device comes with its flash erased.
+ */
+static void _format(void)
+{
+    if (!sim_formatted)
+    {
+        memset(sim_sector, 0xFF, sizeof(sim_sector));
+        sim_formatted = true;
+    }
+}
+
+/* Function definitions ------------------------------------------------------*/
+bool port_flash_erase(void)
+{
+    memset(sim_sector, 0xFF, sizeof(sim_sector));
+    sim_formatted = true;
+    port_flash_sim_erases++;
+    return true;
+}
+
+bool port_flash_program(uint32_t offset, const uint32_t *p_words, uint32_t n_words)
+{
+    _format();
+    uint32_t first = offset / sizeof(uint32_t);
+    if (((offset % sizeof(uint32_t)) != 0) || (first + n_words > PORT_FLASH_SECTOR_WORDS))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < n_words; i++)
+    {
+        // The NOR flash cannot set a bit back to 1 without an erase
+        if ((sim_power_budget == 0) || (sim_sector[first + i] != PORT_FLASH_ERASED_WORD))
+        {
+            return false;
+        }
+        sim_sector[first + i] = p_words[i];
+        if (sim_power_budget != UINT32_MAX)
+        {
+            sim_power_budget--;
+        }
+    }
+    return true;
+}
+
+void port_flash_read(uint32_t offset, uint32_t *p_words, uint32_t n_words)
+{
+    _format();
+    memcpy(p_words, &sim_sector[offset / sizeof(uint32_t)], n_words * sizeof(uint32_t));
+    port_flash_sim_words_read += n_words;
+}
+
+void port_flash_sim_cut_power_after(uint32_t n_words)
+{
+    sim_power_budget = n_words;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file port_led.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Port layer for a LED in the native platform.
+ * @date 01-03-2024
+ */
+/* HW dependent includes */
+#include "port_led.h"
+#include "port_system.h"
+
+/* Global variables -----------------------------------------------------------*/
+const port_led_hw_t led_heater_active = PORT_SYSTEM_GPIO_PIN(LED_HEAT_PORT, LED_HEAT_PIN, GPIO_MODE_OUT, GPIO_PUPDR_NOPULL);
+const port_led_hw_t led_comfort_temperature = PORT_SYSTEM_GPIO_PIN(LED_COMFORT_PORT, LED_COMFORT_PIN, GPIO_MODE_OUT, GPIO_PUPDR_NOPULL);
+const port_led_hw_t led_on = PORT_SYSTEM_GPIO_PIN(LED_ON_PORT, LED_ON_PIN, GPIO_MODE_OUT, GPIO_PUPDR_NOPULL);
+
+bool port_led_get_status(const port_led_hw_t *p_led)
+{
+    return (p_led->p_port->ODR & p_led->mask) != 0;
+}
+
+void port_led_on(const port_led_hw_t *p_led)
+{
+    port_system_gpio_write(p_led->p_port, p_led->mask, 0);
+}
+
+void port_led_off(const port_led_hw_t *p_led)
+{
+    port_system_gpio_write(p_led->p_port, 0, p_led->mask);
+}
+
+void port_led_toggle(const port_led_hw_t *p_led)
+{
+    // Only the state of this LED is read: the write does not touch the rest of the port
+    if (p_led->p_port->ODR & p_led->mask)
+    {
+        port_system_gpio_write(p_led->p_port, 0, p_led->mask);
+    }
+    else
+    {
+        port_system_gpio_write(p_led->p_port, p_led->mask, 0);
+    }
+}
+
+void port_led_switch(const port_led_hw_t *p_led_on, const port_led_hw_t *p_led_off)
+{
+    if (p_led_on->p_port == p_led_off->p_port)
+    {
+        port_system_gpio_write(p_led_on->p_port, p_led_on->mask, p_led_off->mask);
+        return;
+    }
+    port_system_gpio_write(p_led_off->p_port, 0, p_led_off->mask);
+    port_system_gpio_write(p_led_on->p_port, p_led_on->mask, 0);
+}
+
+void port_led_init(const port_led_hw_t *p_led)
+{
+    port_system_gpio_config_pin(p_led);
+}
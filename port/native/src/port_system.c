@@ -0,0 +1,658 @@
+/**
+ * @file port_system.c
+ * @brief File that defines the virtual clock and the simulated peripherals of the native platform.
+ * @author Sistemas Digitales II
+ * @date 2024-01-01
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "port_system.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define ADC_DEFAULT_COUNTS 248U /*!< Default analog model: 200 mV, i.e., 20 ºC with a LM35 */
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief Pending event of the virtual clock.
+ */
+typedef struct
+{
+    bool active;                         /*!< The slot holds a pending event */
+    uint64_t due_us;                     /*!< Virtual time of the next occurrence */
+    uint64_t period_us;                  /*!< Period of the event. 0 for one-shot events */
+    uint32_t seq;                        /*!< Scheduling order, to run simultaneous events in FIFO order */
+    port_system_sim_callback_t callback; /*!< Simulated ISR */
+    void *p_arg;                         /*!< Argument of the callback */
+} sim_event_t;
+
+/* GLOBAL VARIABLES */
+GPIO_TypeDef port_system_sim_gpio[PORT_SYSTEM_SIM_GPIO_PORTS];
+RCC_TypeDef port_system_sim_rcc;
+ADC_TypeDef port_system_sim_adc[PORT_SYSTEM_SIM_ADCS];
+TIM_TypeDef port_system_sim_tim[PORT_SYSTEM_SIM_TIMERS];
+
+static const uint32_t sim_tim_trgo[PORT_SYSTEM_SIM_TIMERS] = {ADC_EXTERNAL_TRIGGER_TIM2_TRGO}; /*!< External trigger of the ADCs mapped to the trigger output of each timer */
+
+static uint64_t sim_time_us = 0;                          /*!< Virtual time in microseconds */
+static uint32_t sim_seq = 0;                              /*!< Scheduling order counter */
+static sim_event_t sim_events[PORT_SYSTEM_SIM_MAX_EVENTS]; /*!< Pending events */
+static bool adc_interrupt_enabled = false;                /*!< Simulated NVIC enable of the ADC global interrupt */
+static bool dma_interrupt_enabled = false;                /*!< Simulated NVIC enable of the interrupt of DMA2 stream 0 */
+static uint32_t pending_events = 0;                       /*!< Events posted by the simulated ISRs and not yet consumed by the main loop */
+static bool stop_mode = false;                            /*!< The core enters STOP mode while waiting for events */
+static bool stop_inhibited = false;                       /*!< A peripheral needs its clock: the core enters SLEEP mode instead of STOP */
+static int8_t rtc_event_id = PORT_SYSTEM_SIM_NO_EVENT;    /*!< Identifier of the wake-up event of the RTC in the virtual clock */
+static port_system_power_stats_t power_stats;             /*!< Time asleep and number of sleeps (the time awake is computed when it is read) */
+static int8_t wakeup_event_id = PORT_SYSTEM_SIM_NO_EVENT; /*!< Identifier of the wake-up event in the virtual clock (compare match of the time base) */
+
+//------------------------------------------------------
+// DEFAULT HANDLERS
+//------------------------------------------------------
+/**
+ * @brief Default handler of the ADC global interrupt. As in the startup file of the STM32F4, it is a weak symbol that `interr.c` may override.
+ */
+__attribute__((weak)) void ADC_IRQHandler(void)
+{
+}
+
+/**
+ * @brief Default handler of the interrupt of DMA2 stream 0 (ADC1). As in the startup file of the STM32F4, it is a weak symbol that `interr.c` may override.
+ */
+__attribute__((weak)) void DMA2_Stream0_IRQHandler(void)
+{
+}
+
+/**
+ * @brief Default handler of the interrupt of the wake-up timer of the RTC. As in the startup file of the STM32F4, it is a weak symbol that `interr.c` may override.
+ */
+__attribute__((weak)) void RTC_WKUP_IRQHandler(void)
+{
+    port_system_rtc_wakeup_handle();
+}
+
+//------------------------------------------------------
+// SYSTEM CONFIGURATION
+//------------------------------------------------------
+/**
+ * @brief Default model of the analog input: a constant temperature.
+ *
+ * @param channel ADC channel being converted
+ * @param now_us Virtual time of the conversion
+ * @return uint32_t Counts of a 12-bit conversion
+ */
+static uint32_t _adc_default_source(uint8_t channel, uint64_t now_us)
+{
+    return ADC_DEFAULT_COUNTS;
+}
+
+size_t port_system_init()
+{
+    sim_time_us = 0;
+    sim_seq = 0;
+    memset(sim_events, 0, sizeof(sim_events));
+    adc_interrupt_enabled = false;
+    dma_interrupt_enabled = false;
+    pending_events = 0;
+    wakeup_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+    rtc_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+    stop_mode = false;
+    stop_inhibited = false;
+    memset(&power_stats, 0, sizeof(power_stats));
+
+    memset(port_system_sim_gpio, 0, sizeof(port_system_sim_gpio));
+    memset(&port_system_sim_rcc, 0, sizeof(port_system_sim_rcc));
+    memset(port_system_sim_adc, 0, sizeof(port_system_sim_adc));
+    for (uint8_t i = 0; i < PORT_SYSTEM_SIM_ADCS; i++)
+    {
+        port_system_sim_adc[i].source = _adc_default_source;
+        port_system_sim_adc[i].n_conversions = 1;
+    }
+    for (uint8_t i = 0; i < PORT_SYSTEM_SIM_TIMERS; i++)
+    {
+        port_system_sim_tim[i].CR2 = 0;
+        port_system_sim_tim[i].period_us = 0;
+        port_system_sim_tim[i].event_id = PORT_SYSTEM_SIM_NO_EVENT;
+        port_system_sim_tim[i].callback = NULL;
+    }
+    return 0;
+}
+
+//------------------------------------------------------
+// VIRTUAL CLOCK
+//------------------------------------------------------
+uint64_t port_system_sim_get_time_us()
+{
+    return sim_time_us;
+}
+
+int8_t port_system_sim_schedule(uint64_t delay_us, uint64_t period_us, port_system_sim_callback_t callback, void *p_arg)
+{
+    for (uint8_t i = 0; i < PORT_SYSTEM_SIM_MAX_EVENTS; i++)
+    {
+        if (!sim_events[i].active)
+        {
+            sim_events[i].active = true;
+            sim_events[i].due_us = sim_time_us + delay_us;
+            sim_events[i].period_us = period_us;
+            sim_events[i].seq = sim_seq++;
+            sim_events[i].callback = callback;
+            sim_events[i].p_arg = p_arg;
+            return (int8_t)i;
+        }
+    }
+    return PORT_SYSTEM_SIM_NO_EVENT;
+}
+
+void port_system_sim_cancel(int8_t event_id)
+{
+    if ((event_id >= 0) && (event_id < (int8_t)PORT_SYSTEM_SIM_MAX_EVENTS))
+    {
+        sim_events[event_id].active = false;
+    }
+}
+
+/**
+ * @brief Find the next pending event.
+ *
+ * @return sim_event_t* Pointer to the next event, or NULL if there are no pending events.
+ */
+static sim_event_t *_next_event(void)
+{
+    sim_event_t *p_next = NULL;
+    for (uint8_t i = 0; i < PORT_SYSTEM_SIM_MAX_EVENTS; i++)
+    {
+        sim_event_t *p_ev = &sim_events[i];
+        if (p_ev->active && ((p_next == NULL) || (p_ev->due_us < p_next->due_us) || ((p_ev->due_us == p_next->due_us) && (p_ev->seq < p_next->seq))))
+        {
+            p_next = p_ev;
+        }
+    }
+    return p_next;
+}
+
+bool port_system_sim_step()
+{
+    sim_event_t *p_ev = _next_event();
+    if (p_ev == NULL)
+    {
+        return false;
+    }
+
+    // Jump to the event. Copy the callback before re-arming the slot, since the callback may schedule or cancel events
+    sim_time_us = p_ev->due_us;
+    port_system_sim_callback_t callback = p_ev->callback;
+    void *p_arg = p_ev->p_arg;
+    if (p_ev->period_us > 0)
+    {
+        p_ev->due_us += p_ev->period_us;
+        p_ev->seq = sim_seq++;
+    }
+    else
+    {
+        p_ev->active = false;
+    }
+    callback(p_arg);
+    return true;
+}
+
+void port_system_sim_run_until_us(uint64_t t_us)
+{
+    sim_event_t *p_ev = _next_event();
+    while ((p_ev != NULL) && (p_ev->due_us <= t_us))
+    {
+        port_system_sim_step();
+        p_ev = _next_event();
+    }
+    if (t_us > sim_time_us)
+    {
+        sim_time_us = t_us;
+    }
+}
+
+//------------------------------------------------------
+// TIMER RELATED FUNCTIONS
+//------------------------------------------------------
+uint32_t port_system_get_millis()
+{
+    return (uint32_t)(sim_time_us / 1000U);
+}
+
+void port_system_set_millis(uint32_t ms)
+{
+    sim_time_us = (uint64_t)ms * 1000U;
+}
+
+void port_system_delay_ms(uint32_t ms)
+{
+    port_system_sim_run_until_us(sim_time_us + (uint64_t)ms * 1000U);
+}
+
+void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms)
+{
+    uint32_t until = *p_t + ms;
+    uint32_t now = port_system_get_millis();
+    if ((int32_t)(until - now) > 0)
+    {
+        port_system_delay_ms(until - now);
+    }
+    *p_t = port_system_get_millis();
+}
+
+void port_system_delay_us(uint32_t us)
+{
+    port_system_sim_run_until_us(sim_time_us + us);
+}
+
+uint32_t port_system_get_cycles()
+{
+    return (uint32_t)(sim_time_us * (PORT_SYSTEM_CORE_CLOCK_HZ / 1000000U));
+}
+
+void port_system_trace_write(const char *p_data, uint32_t length)
+{
+    fwrite(p_data, 1, length, stdout);
+}
+
+void port_system_trace_write_text(const char *p_data, uint32_t length)
+{
+    fwrite(p_data, 1, length, stderr);
+}
+
+uint64_t port_system_get_time_us()
+{
+    return sim_time_us;
+}
+
+/**
+ * @brief Compare match of the time base: wakes up the main loop.
+ *
+ * @param p_arg Not used
+ */
+static void _wakeup_event(void *p_arg)
+{
+    wakeup_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+    port_system_post_event(PORT_SYSTEM_EVENT_TIMEOUT);
+}
+
+void port_system_set_wakeup_us(uint64_t t_us)
+{
+    port_system_cancel_wakeup();
+    if (t_us <= sim_time_us)
+    {
+        port_system_post_event(PORT_SYSTEM_EVENT_TIMEOUT);
+        return;
+    }
+    wakeup_event_id = port_system_sim_schedule(t_us - sim_time_us, 0, _wakeup_event, NULL);
+}
+
+void port_system_cancel_wakeup()
+{
+    port_system_sim_cancel(wakeup_event_id);
+    wakeup_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+}
+
+/**
+ * @brief Update event of a simulated timer. It drives the trigger output and calls the simulated ISR, if any.
+ *
+ * @param p_arg Pointer to the timer
+ */
+static void _timer_update_event(void *p_arg)
+{
+    TIM_TypeDef *p_tim = (TIM_TypeDef *)p_arg;
+
+    // Trigger output: start the regular sequence of the ADCs triggered by this timer
+    if ((p_tim->CR2 & TIM_CR2_MMS) == TIM_CR2_MMS_1)
+    {
+        uint32_t trigger = sim_tim_trgo[p_tim - port_system_sim_tim];
+        for (uint8_t i = 0; i < PORT_SYSTEM_SIM_ADCS; i++)
+        {
+            ADC_TypeDef *p_adc = &port_system_sim_adc[i];
+            if ((p_adc->CR2 & ADC_CR2_EXTEN) && ((p_adc->CR2 & ADC_CR2_EXTSEL) == trigger))
+            {
+                port_system_adc_start_scan(p_adc);
+            }
+        }
+    }
+
+    if (p_tim->callback != NULL)
+    {
+        p_tim->callback(p_tim);
+    }
+}
+
+void port_system_sim_timer_start(TIM_TypeDef *p_tim, uint64_t period_us, port_system_sim_callback_t callback)
+{
+    port_system_sim_timer_stop(p_tim);
+    p_tim->period_us = period_us;
+    p_tim->callback = callback;
+    p_tim->event_id = port_system_sim_schedule(period_us, period_us, _timer_update_event, p_tim);
+}
+
+void port_system_sim_timer_stop(TIM_TypeDef *p_tim)
+{
+    port_system_sim_cancel(p_tim->event_id);
+    p_tim->event_id = PORT_SYSTEM_SIM_NO_EVENT;
+}
+
+//------------------------------------------------------
+// POWER RELATED FUNCTIONS
+//------------------------------------------------------
+uint32_t port_system_critical_enter(void)
+{
+    return 0;
+}
+
+void port_system_critical_exit(uint32_t state)
+{
+}
+
+void port_system_post_event(uint32_t events)
+{
+    pending_events |= events;
+}
+
+uint32_t port_system_wait_for_events(void)
+{
+    while (pending_events == 0)
+    {
+        uint64_t t_sleep = sim_time_us;
+        bool stop = port_system_sim_stop_allowed();
+        if (!port_system_sim_step())
+        {
+            // Nothing can ever post an event: the caller decides how the simulation ends. The message does not go to `stdout`, which is the trace output
+            fprintf(stderr, "[%lu ms] No pending events. End of simulation\n", (unsigned long)port_system_get_millis());
+            return 0;
+        }
+        power_stats.asleep_us += sim_time_us - t_sleep;
+        power_stats.sleeps++;
+        power_stats.stops += stop;
+    }
+    uint32_t events = pending_events;
+    pending_events = 0;
+    return events;
+}
+
+void port_system_set_stop_mode(bool enable)
+{
+    stop_mode = enable;
+}
+
+void port_system_inhibit_stop(bool inhibit)
+{
+    stop_inhibited = inhibit;
+}
+
+bool port_system_sim_stop_allowed()
+{
+    return stop_mode && !stop_inhibited;
+}
+
+/**
+ * @brief Wake-up event of the simulated RTC: calls its ISR.
+ *
+ * @param p_arg Not used
+ */
+static void _rtc_wakeup_event(void *p_arg)
+{
+    RTC_WKUP_IRQHandler();
+}
+
+void port_system_rtc_wakeup_start(uint32_t period_ms)
+{
+    port_system_rtc_wakeup_stop();
+    uint64_t period_us = (uint64_t)period_ms * 1000U;
+    rtc_event_id = port_system_sim_schedule(period_us, period_us, _rtc_wakeup_event, NULL);
+}
+
+void port_system_rtc_wakeup_stop()
+{
+    port_system_sim_cancel(rtc_event_id);
+    rtc_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+}
+
+void port_system_rtc_wakeup_handle()
+{
+}
+
+void port_system_get_power_stats(port_system_power_stats_t *p_stats)
+{
+    *p_stats = power_stats;
+    p_stats->awake_us = sim_time_us - power_stats.asleep_us;
+}
+
+//------------------------------------------------------
+// GPIO RELATED FUNCTIONS
+//------------------------------------------------------
+void port_system_gpio_config(GPIO_TypeDef *p_port, uint8_t pin, uint8_t mode, uint8_t pupd)
+{
+    // The clock enable bits follow the order of the ports
+    RCC->AHB1ENR |= BIT_POS_TO_MASK((uint32_t)(p_port - port_system_sim_gpio));
+
+    p_port->MODER &= ~(0x03U << (pin * 2U));
+    p_port->MODER |= ((uint32_t)mode << (pin * 2U));
+
+    p_port->PUPDR &= ~(0x03U << (pin * 2U));
+    p_port->PUPDR |= ((uint32_t)pupd << (pin * 2U));
+}
+
+void port_system_gpio_config_pin(const port_system_gpio_pin_t *p_pin)
+{
+    RCC->AHB1ENR |= p_pin->clock_mask;
+
+    p_pin->p_port->MODER &= ~(0x03U << (p_pin->pin * 2U));
+    p_pin->p_port->MODER |= ((uint32_t)p_pin->mode << (p_pin->pin * 2U));
+
+    p_pin->p_port->PUPDR &= ~(0x03U << (p_pin->pin * 2U));
+    p_pin->p_port->PUPDR |= ((uint32_t)p_pin->pupd << (p_pin->pin * 2U));
+}
+
+void port_system_gpio_write(GPIO_TypeDef *p_port, uint16_t set_mask, uint16_t reset_mask)
+{
+    // Same as the hardware: the set wins over the reset, and the ODR changes in a single write
+    p_port->BSRR = ((uint32_t)reset_mask << 16) | set_mask;
+    p_port->sim_bsrr_writes++;
+    p_port->ODR = (p_port->ODR & ~(uint32_t)reset_mask) | set_mask;
+}
+
+//------------------------------------------------------
+// ADC RELATED FUNCTIONS
+//------------------------------------------------------
+/**
+ * @brief End of the regular sequence of a simulated ADC. It samples the analog model once per conversion, moves the results to the DMA buffer if enabled, sets the EOC flag and calls the ISRs if enabled.
+ *
+ * @param p_arg Pointer to the ADC
+ */
+static void _adc_end_of_sequence(void *p_arg)
+{
+    ADC_TypeDef *p_adc = (ADC_TypeDef *)p_arg;
+    bool dma = (p_adc->CR2 & ADC_CR2_DMA) && (p_adc->p_dma_buffer != NULL);
+
+    // Drop the LSBs according to the resolution (12, 10, 8 or 6 bits)
+    uint32_t res = (p_adc->CR1 & ADC_CR1_RES_Msk) >> ADC_CR1_RES_Pos;
+    for (uint8_t i = 0; i < p_adc->n_conversions; i++)
+    {
+        uint64_t t_us = sim_time_us - (uint64_t)(p_adc->n_conversions - 1U - i) * PORT_SYSTEM_SIM_ADC_CONVERSION_US;
+        uint8_t channel = p_adc->sequence[i];
+        uint32_t counts = p_adc->source(channel, t_us);
+        if (counts > 0xFFFU)
+        {
+            counts = 0xFFFU;
+        }
+        p_adc->DR = counts >> (2U * res);
+
+        // Analog watchdog on a single channel
+        if ((p_adc->CR1 & ADC_CR1_AWDEN) && (((p_adc->CR1 & ADC_CR1_AWDCH) >> ADC_CR1_AWDCH_Pos) == channel) && ((p_adc->DR > p_adc->HTR) || (p_adc->DR < p_adc->LTR)))
+        {
+            p_adc->SR |= ADC_SR_AWD;
+        }
+
+        if (dma)
+        {
+            p_adc->p_dma_buffer[p_adc->dma_index++] = (uint16_t)p_adc->DR;
+            if (p_adc->dma_index == p_adc->dma_length / 2U)
+            {
+                p_adc->dma_flags |= ADC_DMA_HALF_TRANSFER;
+            }
+            else if (p_adc->dma_index == p_adc->dma_length)
+            {
+                p_adc->dma_flags |= ADC_DMA_TRANSFER_COMPLETE;
+                p_adc->dma_index = 0;
+            }
+        }
+    }
+    p_adc->SR |= ADC_SR_EOC;
+
+    if (adc_interrupt_enabled && (((p_adc->CR1 & ADC_CR1_EOCIE_Msk) && (p_adc->SR & ADC_SR_EOC)) || ((p_adc->CR1 & ADC_CR1_AWDIE) && (p_adc->SR & ADC_SR_AWD))))
+    {
+        ADC_IRQHandler();
+    }
+    if (dma && dma_interrupt_enabled && p_adc->dma_interrupts && (p_adc->dma_flags != 0))
+    {
+        DMA2_Stream0_IRQHandler();
+    }
+}
+
+void port_system_adc_single_ch_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode)
+{
+    p_adc->CR2 &= ~ADC_CR2_ADON;
+    p_adc->CR1 = cr_mode & (ADC_CR1_EOCIE_Msk | ADC_CR1_RES_Msk);
+    p_adc->CR2 &= ~(ADC_CR2_DMA | ADC_CR2_DDS | ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    p_adc->sequence[0] = channel & 0x1FU;
+    p_adc->n_conversions = 1;
+    p_adc->SR = 0;
+}
+
+void port_system_adc_dma_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode, volatile uint16_t *p_buffer, uint8_t n_conversions)
+{
+    uint8_t channels[ADC_DMA_MAX_CONVERSIONS];
+    for (uint8_t i = 0; (i < n_conversions) && (i < ADC_DMA_MAX_CONVERSIONS); i++)
+    {
+        channels[i] = channel;
+    }
+    port_system_adc_dma_scan_init(p_adc, channels, n_conversions, cr_mode, p_buffer);
+}
+
+void port_system_adc_dma_scan_init(ADC_TypeDef *p_adc, const uint8_t *p_channels, uint8_t n_conversions, uint32_t cr_mode, volatile uint16_t *p_buffer)
+{
+    if ((p_adc != ADC1) || (n_conversions == 0) || (n_conversions > ADC_DMA_MAX_CONVERSIONS))
+    {
+        return;
+    }
+
+    port_system_adc_single_ch_init(p_adc, p_channels[0], cr_mode & ADC_CR1_RES_Msk);
+    p_adc->CR1 |= ADC_CR1_SCAN;
+    p_adc->CR2 |= ADC_CR2_DMA | ADC_CR2_DDS;
+    p_adc->n_conversions = n_conversions;
+    for (uint8_t i = 0; i < n_conversions; i++)
+    {
+        p_adc->sequence[i] = p_channels[i] & 0x1FU;
+    }
+
+    p_adc->p_dma_buffer = p_buffer;
+    p_adc->dma_length = 2U * n_conversions;
+    p_adc->dma_index = 0;
+    p_adc->dma_flags = 0;
+    p_adc->dma_interrupts = true;
+}
+
+void port_system_adc_dma_interrupt_enable(ADC_TypeDef *p_adc, uint8_t priority, uint8_t subpriority)
+{
+    if (p_adc == ADC1)
+    {
+        dma_interrupt_enabled = true;
+    }
+}
+
+uint32_t port_system_adc_dma_get_and_clear_flags(ADC_TypeDef *p_adc)
+{
+    uint32_t flags = p_adc->dma_flags;
+    p_adc->dma_flags = 0;
+    return flags;
+}
+
+void port_system_adc_interrupt_enable(uint8_t priority, uint8_t subpriority)
+{
+    adc_interrupt_enabled = true;
+}
+
+void port_system_adc_enable(ADC_TypeDef *p_adc)
+{
+    port_system_adc_power_up_start(p_adc);
+    port_system_delay_us(ADC_STABILIZATION_US);
+}
+
+void port_system_adc_power_up_start(ADC_TypeDef *p_adc)
+{
+    p_adc->CR2 |= ADC_CR2_ADON;
+    p_adc->ready_us = sim_time_us + ADC_STABILIZATION_US;
+}
+
+bool port_system_adc_power_up_ready(ADC_TypeDef *p_adc)
+{
+    return (p_adc->CR2 & ADC_CR2_ADON) && (sim_time_us >= p_adc->ready_us);
+}
+
+void port_system_adc_disable(ADC_TypeDef *p_adc)
+{
+    p_adc->CR2 &= ~ADC_CR2_ADON;
+}
+
+void port_system_adc_start_conversion(ADC_TypeDef *p_adc, uint8_t channel)
+{
+    if (!(p_adc->CR2 & ADC_CR2_ADON))
+    {
+        return;
+    }
+    p_adc->sequence[0] = channel & 0x1FU;
+    port_system_adc_start_scan(p_adc);
+}
+
+void port_system_adc_dma_set_interrupts(ADC_TypeDef *p_adc, bool enable)
+{
+    if (enable)
+    {
+        p_adc->dma_flags = 0;
+    }
+    p_adc->dma_interrupts = enable;
+}
+
+void port_system_adc_watchdog_enable(ADC_TypeDef *p_adc, uint8_t channel, uint16_t low, uint16_t high)
+{
+    p_adc->LTR = low & 0xFFFU;
+    p_adc->HTR = high & 0xFFFU;
+    p_adc->SR &= ~ADC_SR_AWD;
+    p_adc->CR1 &= ~ADC_CR1_AWDCH;
+    p_adc->CR1 |= ((channel & 0x1FU) << ADC_CR1_AWDCH_Pos) | ADC_CR1_AWDSGL | ADC_CR1_AWDEN | ADC_CR1_AWDIE;
+}
+
+void port_system_adc_watchdog_disable(ADC_TypeDef *p_adc)
+{
+    p_adc->CR1 &= ~(ADC_CR1_AWDEN | ADC_CR1_AWDIE);
+    p_adc->SR &= ~ADC_SR_AWD;
+}
+
+void port_system_adc_set_external_trigger(ADC_TypeDef *p_adc, uint32_t trigger)
+{
+    p_adc->CR2 &= ~(ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    if (trigger != ADC_EXTERNAL_TRIGGER_SOFTWARE)
+    {
+        p_adc->CR2 |= (trigger & ADC_CR2_EXTSEL) | ADC_CR2_EXTEN_0;
+    }
+}
+
+void port_system_adc_start_scan(ADC_TypeDef *p_adc)
+{
+    if (!port_system_adc_power_up_ready(p_adc))
+    {
+        return;
+    }
+    p_adc->SR = 0;
+    port_system_sim_schedule((uint64_t)p_adc->n_conversions * PORT_SYSTEM_SIM_ADC_CONVERSION_US, 0, _adc_end_of_sequence, p_adc);
+}
+
+void port_system_sim_adc_set_source(ADC_TypeDef *p_adc, port_system_sim_adc_source_t source)
+{
+    p_adc->source = (source != NULL) ? source : _adc_default_source;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file port_thermostat.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Source file for the thermostat system port layer of the native platform.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+/* Project includes */
+#include "port_thermostat.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define THERMOSTAT_DEFAULT_TICKS TIMER_TICKS_MS(THERMOSTAT_DEFAULT_PERIOD_MS)                                      /*!< Default period of the measurement timer in ticks of its clock */
+#define THERMOSTAT_DEFAULT_PSC TIMER_PSC(THERMOSTAT_DEFAULT_TICKS, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX) /*!< Prescaler of the default period. It is computed at compile time */
+#define THERMOSTAT_DEFAULT_ARR TIMER_ARR(THERMOSTAT_DEFAULT_TICKS, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX) /*!< Auto-reload value of the default period. It is computed at compile time */
+
+_Static_assert(THERMOSTAT_DEFAULT_ARR <= THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX, "The default period does not fit in the measurement timer");
+_Static_assert(TIMER_PERIOD_TICKS(THERMOSTAT_DEFAULT_PSC, THERMOSTAT_DEFAULT_ARR) == THERMOSTAT_DEFAULT_TICKS, "The default period is not exact with the measurement timer");
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief Loads the prescaler and the auto-reload value of the measurement timer and (re)starts its update event with the resulting period.
+ *
+ * @param psc Prescaler
+ * @param arr Auto-reload value
+ */
+static void _timer_load(uint32_t psc, uint32_t arr)
+{
+    THERMOSTAT_MEASUREMENT_TIMER->ARR = arr;
+    THERMOSTAT_MEASUREMENT_TIMER->PSC = psc;
+    port_system_sim_timer_start(THERMOSTAT_MEASUREMENT_TIMER, (TIMER_PERIOD_TICKS(psc, arr) * 1000000U) / PORT_SYSTEM_TIMER_CLOCK_HZ, NULL);
+}
+
+/* Public functions ----------------------------------------------------------*/
+void port_thermostat_timer_setup(fsm_thermostat_t *p_thermostat, uint32_t period_ms)
+{
+    // The update event is the trigger output (TRGO), which starts the conversions of the ADC. There is no timer ISR
+    THERMOSTAT_MEASUREMENT_TIMER->CR2 = TIM_CR2_MMS_1;
+
+    // The values of the default period are constants, so there is no arithmetic at startup
+    if (period_ms == THERMOSTAT_DEFAULT_PERIOD_MS)
+    {
+        _timer_load(THERMOSTAT_DEFAULT_PSC, THERMOSTAT_DEFAULT_ARR);
+    }
+    else
+    {
+        port_thermostat_timer_set_period(p_thermostat, period_ms, false);
+    }
+}
+
+void port_thermostat_timer_set_period(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool low_power)
+{
+    if (low_power)
+    {
+        port_system_rtc_wakeup_start(period_ms);
+        return;
+    }
+
+    uint64_t ticks = TIMER_TICKS_MS(period_ms);
+    _timer_load(TIMER_PSC(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX), TIMER_ARR(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX));
+}
+
+void port_thermostat_set_low_power(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool enable)
+{
+    if (enable)
+    {
+        // The timers are stopped in STOP mode: the RTC wakes up the core and its ISR starts the measurement
+        port_system_sim_timer_stop(THERMOSTAT_MEASUREMENT_TIMER);
+        port_temp_sensor_set_external_trigger(p_thermostat->p_temp_sensor, false);
+        port_system_rtc_wakeup_start(period_ms);
+    }
+    else
+    {
+        port_system_rtc_wakeup_stop();
+        port_temp_sensor_set_external_trigger(p_thermostat->p_temp_sensor, true);
+        port_thermostat_timer_setup(p_thermostat, period_ms);
+    }
+    port_system_set_stop_mode(enable);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file port_uart.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Port layer for the UART in the native platform: USART2 and its DMA streams are simulated on the virtual clock.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+/* Standard C includes */
+#include <string.h>
+
+/* HW dependent includes */
+#include "port_uart.h"
+#include "port_system.h"
+
+_Static_assert((PORT_UART_RX_SIZE & (PORT_UART_RX_SIZE - 1)) == 0, "The size of the circular buffer must be a power of 2");
+
+/* Global variables -----------------------------------------------------------*/
+uint8_t port_uart_sim_tx[PORT_UART_SIM_TX_SIZE];
+uint32_t port_uart_sim_tx_length = 0;
+uint32_t port_uart_sim_tx_transfers = 0;
+uint32_t port_uart_sim_rx_irqs = 0;
+
+static volatile uint8_t rx_buffer[PORT_UART_RX_SIZE];      /*!< Circular buffer written by the simulated DMA */
+static uint32_t rx_head = 0;                               /*!< Position of the next byte written by the simulated DMA */
+static bool rx_idle = false;                               /*!< Idle line flag of the simulated USART */
+static int8_t rx_idle_event_id = PORT_SYSTEM_SIM_NO_EVENT; /*!< Identifier of the idle line event in the virtual clock */
+static const uint8_t *p_tx_data = NULL;                    /*!< Buffer of the transfer in progress, or NULL if there is none */
+static uint32_t tx_length = 0;                             /*!< Number of bytes of the transfer in progress */
+static bool tx_complete = false;                           /*!< Transfer complete flag of the simulated DMA stream */
+
+/* Default handlers -----------------------------------------------------------*/
+/**
+ * @brief Default handler of the interrupt of USART2. As in the startup file of the STM32F4, it is a weak symbol that `interr.c` may override.
+ */
+__attribute__((weak)) void USART2_IRQHandler(void)
+{
+    port_uart_get_and_clear_rx_idle();
+}
+
+/**
+ * @brief Default handler of the interrupt of DMA1 stream 6 (USART2_TX). As in the startup file of the STM32F4, it is a weak symbol that `interr.c` may override.
+ */
+__attribute__((weak)) void DMA1_Stream6_IRQHandler(void)
+{
+    port_uart_get_and_clear_tx_complete();
+}
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief The RX line has been idle for one frame after the last received byte.
+ *
+ * @param p_arg Not used.
+ */
+static void _rx_idle_event(void *p_arg)
+{
+    rx_idle_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+    rx_idle = true;
+    port_uart_sim_rx_irqs++;
+    USART2_IRQHandler();
+}
+
+/**
+ * @brief The DMA has sent the last byte of the transfer: the host has received all of them.
+ *
+ * @param p_arg Not used.
+ */
+static void _tx_complete_event(void *p_arg)
+{
+    for (uint32_t i = 0; i < tx_length; i++)
+    {
+        if (port_uart_sim_tx_length < PORT_UART_SIM_TX_SIZE)
+        {
+            port_uart_sim_tx[port_uart_sim_tx_length] = p_tx_data[i];
+        }
+        port_uart_sim_tx_length++;
+    }
+    p_tx_data = NULL;
+    tx_complete = true;
+    DMA1_Stream6_IRQHandler();
+}
+
+/* Function definitions ------------------------------------------------------*/
+void port_uart_init(void)
+{
+    memset((void *)rx_buffer, 0, sizeof(rx_buffer));
+    rx_head = 0;
+    rx_idle = false;
+    rx_idle_event_id = PORT_SYSTEM_SIM_NO_EVENT;
+    p_tx_data = NULL;
+    tx_length = 0;
+    tx_complete = false;
+
+    memset(port_uart_sim_tx, 0, sizeof(port_uart_sim_tx));
+    port_uart_sim_tx_length = 0;
+    port_uart_sim_tx_transfers = 0;
+    port_uart_sim_rx_irqs = 0;
+}
+
+const volatile uint8_t *port_uart_get_rx_buffer(void)
+{
+    return rx_buffer;
+}
+
+uint32_t port_uart_get_rx_head(void)
+{
+    return rx_head;
+}
+
+bool port_uart_send(const uint8_t *p_data, uint32_t length)
+{
+    if (port_uart_tx_busy() || (length == 0) || (length > 0xFFFFU))
+    {
+        return false;
+    }
+    p_tx_data = p_data;
+    tx_length = length;
+    port_uart_sim_tx_transfers++;
+    port_system_sim_schedule((uint64_t)length * PORT_UART_SIM_FRAME_US, 0, _tx_complete_event, NULL);
+    return true;
+}
+
+bool port_uart_tx_busy(void)
+{
+    return p_tx_data != NULL;
+}
+
+bool port_uart_get_and_clear_rx_idle(void)
+{
+    bool idle = rx_idle;
+    rx_idle = false;
+    return idle;
+}
+
+bool port_uart_get_and_clear_tx_complete(void)
+{
+    bool complete = tx_complete;
+    tx_complete = false;
+    return complete;
+}
+
+void port_uart_sim_receive(const char *p_data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+    {
+        rx_buffer[rx_head] = (uint8_t)p_data[i];
+        rx_head = (rx_head + 1U) & (PORT_UART_RX_SIZE - 1U);
+    }
+
+    // A new burst restarts the idle line detection
+    port_system_sim_cancel(rx_idle_event_id);
+    rx_idle_event_id = port_system_sim_schedule((uint64_t)(length + 1U) * PORT_UART_SIM_FRAME_US, 0, _rx_idle_event, NULL);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file port_flash.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the flash port layer.
+ *
+ * The configuration is kept in the last sector of the internal flash, which the code must not use (it is 384 KB below it). The sector is programmed word by word (32 bits, with the supply voltage from 2.7 to 3.6 V) and erased as a whole. The CPU stalls while the flash is busy if it fetches code from it, so an erase (up to 2 s for a sector of 128 KB) also delays the interrupts: it only happens once every `PORT_FLASH_SECTOR_SIZE` / record bytes updates of the configuration.
+ *
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_FLASH_H
+#define PORT_FLASH_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and macros --------------------------------------------------------*/
+// HW Nucleo-STM32F446RE:
+#define PORT_FLASH_SECTOR 7U               /*!< Sector of the configuration: the last one of the 512 KB of flash */
+#define PORT_FLASH_SECTOR_BASE 0x08060000U /*!< Address of the sector of the configuration */
+#define PORT_FLASH_SECTOR_SIZE 0x20000U    /*!< Size in bytes of the sector of the configuration (128 KB) */
+#define PORT_FLASH_ERASED_WORD 0xFFFFFFFFU /*!< Value of a word of an erased sector */
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Erases the sector of the configuration: all its words become `PORT_FLASH_ERASED_WORD`.
+ *
+ * @return true if the sector has been erased, false otherwise (e.g., it is write-protected).
+ */
+bool port_flash_erase(void);
+
+/**
+ * @brief Programs words of the sector of the configuration, in order.
+ *
+ * @param offset Offset in bytes of the first word from the start of the sector. It must be a multiple of 4.
+ * @param p_words Words to program.
+ * @param n_words Number of words to program.
+ * @return true if all the words have been programmed, false if a word is out of the sector or the flash reports an error.
+ */
+bool port_flash_program(uint32_t offset, const uint32_t *p_words, uint32_t n_words);
+
+/**
+ * @brief Reads words of the sector of the configuration. The flash is memory-mapped, so it is a copy.
+ *
+ * @param offset Offset in bytes of the first word from the start of the sector. It must be a multiple of 4.
+ * @param p_words Array to store the words.
+ * @param n_words Number of words to read.
+ */
+void port_flash_read(uint32_t offset, uint32_t *p_words, uint32_t n_words);
+
+#endif /* PORT_FLASH_H */
@@ -32,8 +32,30 @@
 #define NVIC_PRIORITY_GROUP_4 ((uint32_t)0x00000003) /*!< 4 bits for pre-emption priority, \
                                                          0 bit  for subpriority */
 
+/* Time base */
+#ifndef PORT_SYSTEM_TICKLESS
+#define PORT_SYSTEM_TICKLESS 1 /*!< 1: the time base is a free-running 32-bit timer extended to 64 bits, with no periodic interrupt. 0: SysTick interrupts every 1 ms */
+#endif
+#define PORT_SYSTEM_TIMEBASE_TIMER TIM5                  /*!< Free-running timer of the time base in tickless mode. TIM5 has a 32-bit counter */
+#define PORT_SYSTEM_TIMEBASE_IRQN TIM5_IRQn              /*!< Interrupt of the timer of the time base */
+#define PORT_SYSTEM_TIMEBASE_FREQ_HZ 1000000U            /*!< Frequency of the counter of the time base: 1 count per microsecond. It overflows every 71.6 minutes */
+#define PORT_SYSTEM_NO_WAKEUP UINT64_MAX                 /*!< No wake-up time is set */
+
 /* Power */
 #define POWER_REGULATOR_VOLTAGE_SCALE3 0x01 /*!< Scale 3 mode: the maximum value of fHCLK is 120 MHz. */
+#define RTC_WAKEUP_TICKS_PER_MS 2U          /*!< Ticks of the wake-up timer of the RTC per millisecond: LSI (32 kHz) / 16 */
+#define RTC_WAKEUP_MAX_MS (0x10000U / RTC_WAKEUP_TICKS_PER_MS) /*!< Maximum period of the wake-up timer of the RTC in milliseconds (16-bit WUTR) */
+#define RTC_WPR_KEY1 0xCAU                  /*!< First key to unlock the write protection of the RTC registers */
+#define RTC_WPR_KEY2 0x53U                  /*!< Second key to unlock the write protection of the RTC registers */
+#define RTC_WAKEUP_EXTI_LINE 22U            /*!< EXTI line of the wake-up timer of the RTC */
+
+/* Trace */
+#define PORT_SYSTEM_TRACE_TEXT_PORT 1U /*!< Stimulus port of the ITM of the text, apart from the binary trace output of the port 0 */
+
+/* Events posted by the ISRs to the main loop */
+#define PORT_SYSTEM_EVENT_SAMPLE BIT_POS_TO_MASK(0)  /*!< A new temperature sample has been saved */
+#define PORT_SYSTEM_EVENT_TIMEOUT BIT_POS_TO_MASK(1) /*!< The wake-up time set with `port_system_set_wakeup_us()` has been reached */
+#define PORT_SYSTEM_EVENT_UART BIT_POS_TO_MASK(2)    /*!< The UART has received a burst of bytes (idle line) or finished a transmission */
 
 /* GPIOs */
 #define HIGH true /*!< Logic 1 */
@@ -48,6 +70,13 @@
 #define GPIO_PUPDR_PUP 0x01    /*!< GPIO pull up */
 #define GPIO_PUPDR_PDOWN 0x02  /*!< GPIO pull down */
 
+/* GPIO pin descriptors */
+#define PORT_SYSTEM_GPIO(letter) PORT_SYSTEM_GPIO_(letter)         /*!< GPIO port of a letter, e.g., `PORT_SYSTEM_GPIO(B)` is `GPIOB`. The letter can be a macro */
+#define PORT_SYSTEM_GPIO_(letter) GPIO##letter                     /*!< Helper of `PORT_SYSTEM_GPIO()` */
+#define PORT_SYSTEM_GPIO_CLOCK(letter) PORT_SYSTEM_GPIO_CLOCK_(letter) /*!< Clock enable bit of the GPIO port of a letter in `RCC->AHB1ENR` */
+#define PORT_SYSTEM_GPIO_CLOCK_(letter) RCC_AHB1ENR_GPIO##letter##EN /*!< Helper of `PORT_SYSTEM_GPIO_CLOCK()` */
+#define PORT_SYSTEM_GPIO_PIN(letter, pin_number, pin_mode, pin_pupd) {.p_port = PORT_SYSTEM_GPIO(letter), .clock_mask = PORT_SYSTEM_GPIO_CLOCK(letter), .mask = (uint16_t)BIT_POS_TO_MASK(pin_number), .pin = (pin_number), .mode = (pin_mode), .pupd = (pin_pupd)} /*!< Initializer of a `port_system_gpio_pin_t`: everything is resolved at compile time */
+
 /* Interruption */
 #define TRIGGER_RISING_EDGE 0x01U                                      /*!< Interrupt mask for detecting rising edge */
 #define TRIGGER_FALLING_EDGE 0x02U                                     /*!< Interrupt mask for detecting falling edge */
@@ -55,8 +84,17 @@
 #define TRIGGER_ENABLE_EVENT_REQ 0x04U                                 /*!< Interrupt mask to enable event requests */
 #define TRIGGER_ENABLE_INTERR_REQ 0x08U                                /*!< Interrupt mask to enable interrupt request */
 
+/* Timers */
+#define PORT_SYSTEM_TIMER_CLOCK_HZ 16000000U /*!< Clock of the timers in Hz: `system_clock_config()` runs from the HSI (16 MHz) with the AHB and APB1 prescalers set to 1 */
+#define TIMER_TICKS_MS(ms) ((uint64_t)(ms) * (PORT_SYSTEM_TIMER_CLOCK_HZ / 1000U))                                    /*!< Ticks of the timer clock in a period given in milliseconds */
+#define TIMER_TICKS_US(us) ((uint64_t)(us) * (PORT_SYSTEM_TIMER_CLOCK_HZ / 1000000U))                                 /*!< Ticks of the timer clock in a period given in microseconds */
+#define TIMER_PSC(ticks, arr_max) ((uint32_t)(((uint64_t)(ticks) - 1U) / ((uint64_t)(arr_max) + 1U)))                  /*!< Smallest prescaler (PSC) that fits a period of `ticks` in a counter of `arr_max`: it gives the finest resolution of ARR */
+#define TIMER_ARR(ticks, arr_max) ((uint32_t)(((uint64_t)(ticks) + (TIMER_PSC(ticks, arr_max) + 1U) / 2U) / (TIMER_PSC(ticks, arr_max) + 1U) - 1U)) /*!< Auto-reload value (ARR) of a period of `ticks` with the prescaler `TIMER_PSC()`, rounded to the nearest count */
+#define TIMER_PERIOD_TICKS(psc, arr) (((uint64_t)(psc) + 1U) * ((uint64_t)(arr) + 1U))                               /*!< Actual period in ticks of the timer clock of a pair of PSC and ARR */
+
 /* ADC */
 #define ADC_VREF_MV 3300U /*!< ADC reference voltage in mV */
+#define ADC_STABILIZATION_US 3U /*!< Power-up time of the ADC (tSTAB) in microseconds, from the datasheet of the STM32F446 */
 
 #define ADC_RESOLUTION_12B (0x00U << ADC_CR1_RES_Pos) /*!< 12-bit resolution */
 #define ADC_RESOLUTION_10B (0x01U << ADC_CR1_RES_Pos) /*!< 10-bit resolution */
@@ -65,6 +103,39 @@
 
 #define ADC_EOC_INTERRUPT_ENABLE (0x01U << ADC_CR1_EOCIE_Pos) /*!< End of conversion interrupt enable */
 
+#define ADC_EXTERNAL_TRIGGER_TIM2_TRGO (0x06U << ADC_CR2_EXTSEL_Pos) /*!< Regular conversions triggered by TIM2 TRGO (EXTSEL = 0110) */
+#define ADC_EXTERNAL_TRIGGER_SOFTWARE UINT32_MAX                     /*!< No external trigger: the regular conversions are started by software (`port_system_adc_start_scan()`) */
+
+#define ADC_DMA_MAX_CONVERSIONS 16U    /*!< Maximum number of conversions of a regular sequence (slots of SQR1 to SQR3) */
+#define ADC_DMA_SAMPLING_TIME 0x03U    /*!< Sampling time of the channel in DMA mode. 011: 56 cycles, to let the sampling capacitor settle and reduce the noise */
+#define ADC_DMA_HALF_TRANSFER 0x01U     /*!< The DMA has filled the first half of the circular buffer */
+#define ADC_DMA_TRANSFER_COMPLETE 0x02U /*!< The DMA has filled the second half of the circular buffer */
+
+/* Typedefs --------------------------------------------------------------------*/
+/**
+ * @brief Time spent by the core asleep (waiting for events) and awake since the system started.
+ */
+typedef struct
+{
+    uint64_t asleep_us; /*!< Time asleep in microseconds (SLEEP or STOP mode) */
+    uint64_t awake_us;  /*!< Time awake in microseconds */
+    uint32_t sleeps;    /*!< Number of times the core has gone to sleep */
+    uint32_t stops;     /*!< Number of times the core has entered STOP mode */
+} port_system_power_stats_t;
+
+/**
+ * @brief Descriptor of a GPIO pin: port, clock enable bit, mask and configuration, resolved at compile time with `PORT_SYSTEM_GPIO_PIN()`. Descriptors are `const`, so tables of pins live in flash and need no initialization code.
+ */
+typedef struct
+{
+    GPIO_TypeDef *p_port; /*!< GPIO port of the pin */
+    uint32_t clock_mask;  /*!< Clock enable bit of the port in `RCC->AHB1ENR` */
+    uint16_t mask;        /*!< Mask of the pin in the registers of the port */
+    uint8_t pin;          /*!< Pin/line of the GPIO (index from 0 to 15) */
+    uint8_t mode;         /*!< Input, output, alternate, or analog */
+    uint8_t pupd;         /*!< Pull-up, pull-down, or no-pull */
+} port_system_gpio_pin_t;
+
 /* Function prototypes and explanation -------------------------------------------------*/
 
 /**
@@ -72,7 +143,8 @@
  *         thing to be executed in the main program (before to call any other
  *          functions), it performs the following:
  *           - Configure the Flash prefetch, instruction and Data caches.
- *           - Configures the SysTick to generate an interrupt each 1 millisecond, which is clocked by the HSI (at this stage, the clock is not yet configured and thus the system is running from the internal HSI at 16 MHz).
+ *           - Configures the time base: in tickless mode (`PORT_SYSTEM_TICKLESS`), a free-running timer at 1 MHz; otherwise, the SysTick to generate an interrupt each 1 millisecond, which is clocked by the HSI (at this stage, the clock is not yet configured and thus the system is running from the internal HSI at 16 MHz).
+ *           - Enable the cycle counter of the DWT for `port_system_delay_us()`.
  *           - Set NVIC Group Priority to 4.
  *             NVIC_PRIORITYGROUP_4: 4 bits for preemption priority
  *                                    0 bits for subpriority
@@ -90,12 +162,13 @@ size_t port_system_init(void);
 /**
  * @brief Get the count of the System tick in milliseconds
  *
+ * @note It wraps around after 49.7 days. Use `port_system_get_time_us()` for timestamps that must be monotonic.
  */
 uint32_t port_system_get_millis(void);
 
 /**
  * @brief Sets the number of milliseconds since the system started.
- * @warning This function must be used only by the SysTick_Handler() ISR in file `interr.c`.
+ * @warning This function must be used only by the SysTick_Handler() ISR in file `interr.c`. In tickless mode, it moves the time base so that the current time is `ms`.
  *
  * @param ms New number of milliseconds since the system started.
  */
@@ -110,6 +183,38 @@ void port_system_set_millis(uint32_t ms);
  */
 void port_system_delay_ms(uint32_t ms);
 
+/**
+ * @brief Wait for some microseconds.
+ *
+ * It counts the cycles of the core with the cycle counter of the DWT (`CYCCNT`), so the time does not depend on the optimization level, and it is exact to a few cycles. It is meant for short waits, e.g., the stabilization times of the peripherals.
+ *
+ * @param us Number of microseconds to wait
+ */
+void port_system_delay_us(uint32_t us);
+
+/**
+ * @brief Get the number of cycles of the core since the system started, from the cycle counter of the DWT (`CYCCNT`). It wraps around every 2^32 cycles.
+ *
+ * @return uint32_t Cycles of the core
+ */
+uint32_t port_system_get_cycles(void);
+
+/**
+ * @brief Write to the trace output: the stimulus port 0 of the ITM, read by the debugger through SWO. It does not need a UART. It carries the binary frames of the telemetry.
+ *
+ * @param p_data Pointer to the text
+ * @param length Number of characters
+ */
+void port_system_trace_write(const char *p_data, uint32_t length);
+
+/**
+ * @brief Write text for the developer (e.g., the dump of the profiler) to the stimulus port `PORT_SYSTEM_TRACE_TEXT_PORT` of the ITM, so that it does not corrupt the binary frames of the trace output.
+ *
+ * @param p_data Pointer to the text
+ * @param length Number of characters
+ */
+void port_system_trace_write_text(const char *p_data, uint32_t length);
+
 /**
  * @brief Wait for some milliseconds from a time reference.
  *
@@ -122,6 +227,34 @@ void port_system_delay_ms(uint32_t ms);
  */
 void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms);
 
+/**
+ * @brief Get the time since the system started in microseconds.
+ *
+ * In tickless mode, the time base is the 32-bit counter of `PORT_SYSTEM_TIMEBASE_TIMER` extended with the count of its overflows: the time is monotonic and it does not wrap around. With SysTick, it has a resolution of 1 ms.
+ *
+ * @return uint64_t Microseconds since the system started.
+ */
+uint64_t port_system_get_time_us(void);
+
+/**
+ * @brief Sets the time to wake up the main loop. `PORT_SYSTEM_EVENT_TIMEOUT` is posted at that time. Only one wake-up time is kept: it replaces the previous one.
+ *
+ * In tickless mode, the wake-up is a compare match of the time base: there are no interrupts until then (besides an overflow of the counter every 71.6 minutes).
+ *
+ * @param t_us Time in microseconds (see `port_system_get_time_us()`). If it has already passed, the event is posted immediately.
+ */
+void port_system_set_wakeup_us(uint64_t t_us);
+
+/**
+ * @brief Cancels the wake-up time set with `port_system_set_wakeup_us()`.
+ */
+void port_system_cancel_wakeup(void);
+
+/**
+ * @brief Handles the interrupt of the time base: overflow of the counter and compare match of the wake-up time. To be called from the ISR of `PORT_SYSTEM_TIMEBASE_TIMER`.
+ */
+void port_system_timebase_irq(void);
+
 /** @verbatim
       ==============================================================================
                               ##### How to use GPIOs #####
@@ -169,6 +302,24 @@ void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms);
  */
 void port_system_gpio_config(GPIO_TypeDef *p_port, uint8_t pin, uint8_t mode, uint8_t pupd);
 
+/**
+ * @brief Configures a GPIO pin from its descriptor. The clock of the port is enabled with the bit of the descriptor: no look-up of the port.
+ *
+ * @param p_pin Descriptor of the pin.
+ */
+void port_system_gpio_config_pin(const port_system_gpio_pin_t *p_pin);
+
+/**
+ * @brief Sets and clears several output pins of a port at once: an output group.
+ *
+ * It is a single write to the bit set/reset register (BSRR), so it is atomic (no read-modify-write of ODR that an ISR could interrupt), all the pins change in the same bus transaction (no glitch between them), and the other pins of the port are not touched. If a pin is in both masks, it is set.
+ *
+ * @param p_port Port of the GPIOs.
+ * @param set_mask Pins to set (bit i is pin i).
+ * @param reset_mask Pins to clear (bit i is pin i).
+ */
+void port_system_gpio_write(GPIO_TypeDef *p_port, uint16_t set_mask, uint16_t reset_mask);
+
 /**
  * @brief Configure the alternate function of a GPIO
  *
@@ -263,7 +414,7 @@ void port_system_gpio_exti_disable(uint8_t pin);
  *
  * It configures the given ADC peripheral and the common configuration for all the channels.
  *
- * The current implementation only supports setting the resolution and interrupt of EOC. Most of the configurations are set to default values. DMA is not supported in current implementation. As in example: \n
+ * The current implementation only supports setting the resolution and interrupt of EOC. Most of the configurations are set to default values. DMA is configured by `port_system_adc_dma_init()`. As in example: \n
  * \n
  * Reset Configuration Register 1 (CR1) of the ADC. Current configuration sets the default values for: \n
  * - Analog watchdog enable on regular channels \n
@@ -295,12 +446,27 @@ void port_system_adc_interrupt_enable(uint8_t priority, uint8_t subpriority);
 /**
  * @brief Enable the ADC peripheral to work
  *
- * It enables the given ADC peripheral in CR2 register. It waits until the ADC stabilizes (10 us aprox).
- * 
+ * It enables the given ADC peripheral in CR2 register. It waits until the ADC stabilizes (`ADC_STABILIZATION_US`). To do other work during the stabilization, use `port_system_adc_power_up_start()` and `port_system_adc_power_up_ready()` instead.
+ *
  * @param p_adc ADC peripheral (CMSIS struct like)
  */
 void port_system_adc_enable(ADC_TypeDef *p_adc);
 
+/**
+ * @brief Starts the power-up of the ADC peripheral and returns without waiting for it to stabilize.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ */
+void port_system_adc_power_up_start(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Checks if the ADC peripheral has stabilized since `port_system_adc_power_up_start()`, i.e., if `ADC_STABILIZATION_US` have elapsed.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @return true if the ADC is ready to convert, false otherwise.
+ */
+bool port_system_adc_power_up_ready(ADC_TypeDef *p_adc);
+
 /**
  * @brief Disable the ADC peripheral
  *
@@ -317,11 +483,182 @@ void port_system_adc_disable(ADC_TypeDef *p_adc);
  * 
  * First it sets the channel sequence in the SQR register. Then, it clears the status register and starts the conversion by setting the SWSTART bit.
  * 
- * Since current implementation does not support DMA, we will only use 1 sequence and put 1 channel in the sequence register at a time.
+ * It only uses 1 sequence and puts 1 channel in the sequence register at a time. To convert the sequence configured by `port_system_adc_dma_init()`, use `port_system_adc_start_scan()`.
  * 
  * @param p_adc ADC peripheral (CMSIS struct like)
  * @param channel Channel number (from 0 to 15)
  */
 void port_system_adc_start_conversion(ADC_TypeDef *p_adc, uint8_t channel);
 
+/**
+ * @brief Configure the ADC peripheral to convert a channel several times per trigger and move the results to memory with the DMA
+ *
+ * It configures the ADC as `port_system_adc_single_ch_init()` does, and then: \n
+ * - The sampling time of the channel is set to `ADC_DMA_SAMPLING_TIME`. \n
+ * - Scan mode is enabled, and the regular sequence (SQR1 to SQR3) holds the channel `n_conversions` times. One trigger converts the whole sequence. \n
+ * - The ADC issues a DMA request after each conversion (`ADC_CR2_DMA`), and keeps issuing them after the last transfer of the DMA (`ADC_CR2_DDS`). \n
+ * - The DMA stream of the ADC (DMA2 stream 0, 2 or 1 for ADC1, ADC2 or ADC3) moves half-words from `DR` to `p_buffer` in circular mode, with interrupts at half and full transfer. \n
+ *
+ * The buffer holds 2 sequences (`2 * n_conversions` samples): while the CPU processes one half, the DMA fills the other one. This way there is only one interrupt per sequence, instead of one per conversion.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param channel Channel number (from 0 to 15)
+ * @param cr_mode Control register mode. Currently, it only supports the resolution.
+ * @param p_buffer Circular buffer of `2 * n_conversions` samples
+ * @param n_conversions Number of conversions of each sequence (from 1 to `ADC_DMA_MAX_CONVERSIONS`)
+ */
+void port_system_adc_dma_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode, volatile uint16_t *p_buffer, uint8_t n_conversions);
+
+/**
+ * @brief Configure the ADC peripheral to convert a sequence of channels per trigger and move the results to memory with the DMA.
+ *
+ * It is the same as `port_system_adc_dma_init()`, but each slot of the regular sequence holds its own channel, e.g., the channels of several sensors, so that one trigger converts all of them with one interrupt of the DMA per sequence. A channel can be repeated to oversample it.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param p_channels Channel of each slot of the sequence (from 0 to 15)
+ * @param n_conversions Number of conversions of each sequence (from 1 to `ADC_DMA_MAX_CONVERSIONS`)
+ * @param cr_mode Control register mode. Currently, it only supports the resolution.
+ * @param p_buffer Circular buffer of `2 * n_conversions` samples
+ */
+void port_system_adc_dma_scan_init(ADC_TypeDef *p_adc, const uint8_t *p_channels, uint8_t n_conversions, uint32_t cr_mode, volatile uint16_t *p_buffer);
+
+/**
+ * @brief Enable the interrupt of the DMA stream of an ADC in NVIC.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param priority Priority of the interrupt
+ * @param subpriority Subpriority of the interrupt
+ */
+void port_system_adc_dma_interrupt_enable(ADC_TypeDef *p_adc, uint8_t priority, uint8_t subpriority);
+
+/**
+ * @brief Get and clear the half and full transfer flags of the DMA stream of an ADC. To be called from the ISR of the DMA stream.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @return uint32_t Mask of `ADC_DMA_HALF_TRANSFER` and `ADC_DMA_TRANSFER_COMPLETE`
+ */
+uint32_t port_system_adc_dma_get_and_clear_flags(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Enable or disable the half and full transfer interrupts of the DMA stream of an ADC, while the stream keeps running.
+ *
+ * The flags of the transfers that ended while the interrupts were disabled are cleared before enabling them, so that the ISR only sees fresh data.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param enable true to enable the interrupts (HTIE and TCIE), false to disable them
+ */
+void port_system_adc_dma_set_interrupts(ADC_TypeDef *p_adc, bool enable);
+
+/**
+ * @brief Enable the analog watchdog of the ADC peripheral on a single regular channel
+ *
+ * The analog watchdog flag (`ADC_SR_AWD`) is set, and the ADC global interrupt is raised, when a conversion of the channel is out of the window: above `high` (HTR) or below `low` (LTR). The comparison is done in hardware, so the CPU is not involved while the conversions stay inside the window.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param channel Channel number (from 0 to 15)
+ * @param low Low threshold in counts of 12 bits (LTR)
+ * @param high High threshold in counts of 12 bits (HTR)
+ */
+void port_system_adc_watchdog_enable(ADC_TypeDef *p_adc, uint8_t channel, uint16_t low, uint16_t high);
+
+/**
+ * @brief Disable the analog watchdog of the ADC peripheral and its interrupt, and clear its flag.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ */
+void port_system_adc_watchdog_disable(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Select the external trigger that starts the regular sequence of the ADC peripheral, on its rising edge.
+ *
+ * It sets the EXTSEL and EXTEN fields of CR2. The sequence starts in hardware at the exact instant of the trigger, without any ISR or `SWSTART`.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @param trigger External trigger (`ADC_EXTERNAL_TRIGGER_*`), or `ADC_EXTERNAL_TRIGGER_SOFTWARE` to disable it
+ */
+void port_system_adc_set_external_trigger(ADC_TypeDef *p_adc, uint32_t trigger);
+
+/**
+ * @brief Start the conversion of the regular sequence of the ADC peripheral, as configured by `port_system_adc_dma_init()`.
+ *
+ * Unlike `port_system_adc_start_conversion()`, it does not modify the sequence registers.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ */
+void port_system_adc_start_scan(ADC_TypeDef *p_adc);
+
+/**
+ * @brief Enters a critical section: masks the interrupts (PRIMASK). Critical sections can be nested.
+ *
+ * @return uint32_t Previous state of the mask, for `port_system_critical_exit()`.
+ */
+uint32_t port_system_critical_enter(void);
+
+/**
+ * @brief Leaves a critical section: restores the mask of the interrupts to its state before `port_system_critical_enter()`.
+ *
+ * @param state Value returned by `port_system_critical_enter()`.
+ */
+void port_system_critical_exit(uint32_t state);
+
+/**
+ * @brief Post events to the main loop. It is safe to call it from any ISR.
+ *
+ * @param events Mask of events (`PORT_SYSTEM_EVENT_*`) to post.
+ */
+void port_system_post_event(uint32_t events);
+
+/**
+ * @brief Sleep until an ISR posts an event, and return all the pending events.
+ *
+ * The core sleeps with `__WFI()` while there are no pending events. Interrupts are masked (PRIMASK) between the check of the events and the `__WFI()`, so that an event posted in between is not missed: a pending interrupt wakes up the core even if it is masked, and the ISR runs as soon as the mask is cleared.
+ *
+ * If the STOP mode is enabled (`port_system_set_stop_mode()`) and no peripheral inhibits it, the core enters STOP mode instead: all the clocks of the core and the peripherals are stopped, and only the EXTI lines (e.g., the wake-up timer of the RTC) can wake it up. On wake-up, the clocks are restored with `system_clock_config()` before any ISR runs.
+ *
+ * @return uint32_t Mask of the pending events. They are cleared.
+ */
+uint32_t port_system_wait_for_events(void);
+
+/**
+ * @brief Enables or disables the STOP mode while waiting for events.
+ *
+ * @warning The timers (TIM2, TIM5), the ADC and the DMA are stopped in STOP mode: the samples must be triggered by the wake-up timer of the RTC (`port_system_rtc_wakeup_start()`).
+ *
+ * @param enable true to enter STOP mode while waiting for events, false to enter SLEEP mode.
+ */
+void port_system_set_stop_mode(bool enable);
+
+/**
+ * @brief Prevents or allows the STOP mode, e.g., while the ADC is converting a sequence that has been started by software.
+ *
+ * @param inhibit true while a peripheral needs its clock, false when it has finished.
+ */
+void port_system_inhibit_stop(bool inhibit);
+
+/**
+ * @brief Starts the periodic wake-up timer of the RTC, clocked by the LSI. Its interrupt (`RTC_WKUP_IRQHandler()`) wakes up the core from STOP mode.
+ *
+ * @param period_ms Period in milliseconds, from 1 to `RTC_WAKEUP_MAX_MS`. The LSI is not trimmed, so the period is only accurate to a few percent.
+ */
+void port_system_rtc_wakeup_start(uint32_t period_ms);
+
+/**
+ * @brief Stops the wake-up timer of the RTC.
+ */
+void port_system_rtc_wakeup_stop(void);
+
+/**
+ * @brief Handles the interrupt of the wake-up timer of the RTC. To be called from `RTC_WKUP_IRQHandler()`.
+ *
+ * It clears the flags of the RTC and of its EXTI line. The time base is stopped in STOP mode, so the time asleep since the previous wake-up (one period of the RTC minus the time awake) is added to it.
+ */
+void port_system_rtc_wakeup_handle(void);
+
+/**
+ * @brief Gets the time spent by the core asleep and awake since the system started.
+ *
+ * @param p_stats Pointer to the structure to store the statistics.
+ */
+void port_system_get_power_stats(port_system_power_stats_t *p_stats);
+
 #endif /* PORT_SYSTEM_H_ */
\ No newline at end of file
@@ -0,0 +1,88 @@
+/**
+ * @file port_uart.h
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Header file for the UART port layer: command channel with the host.
+ *
+ * The USART2 of the Nucleo board is wired to the virtual COM port of the ST-LINK. Both directions use the DMA, so the CPU never moves individual bytes:
+ * - Reception: the DMA writes the received bytes into a circular buffer (`PORT_UART_RX_SIZE` bytes) that never stops. The USART interrupts once per burst, when the line becomes idle for one frame, and the consumer reads the bytes between its own index and `port_uart_get_rx_head()` directly from the buffer.
+ * - Transmission: `port_uart_send()` hands a buffer to the DMA, which interrupts once at the end of the transfer. The buffer must not be modified until then.
+ *
+ * @note The USART is stopped in STOP mode: in low-power mode, the bytes received while the core sleeps in STOP mode are lost.
+ *
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+#ifndef PORT_UART_H
+#define PORT_UART_H
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines and macros --------------------------------------------------------*/
+// HW Nucleo-STM32F446RE:
+#define PORT_UART_GPIO A           /*!< Letter of the GPIO port of the pins of the UART */
+#define PORT_UART_TX_PIN 2U        /*!< Pin of the TX line (PA2): virtual COM port of the ST-LINK */
+#define PORT_UART_RX_PIN 3U        /*!< Pin of the RX line (PA3): virtual COM port of the ST-LINK */
+#define PORT_UART_ALTERNATE 7U     /*!< Alternate function of the pins: AF7 (USART1 to USART3) */
+#define PORT_UART_BAUDRATE 115200U /*!< Baud rate of the UART: 8 data bits, no parity, 1 stop bit */
+#define PORT_UART_IRQ_PRIORITY 2U  /*!< Priority of the interrupts of the UART: below the DMA of the ADC */
+#ifndef PORT_UART_RX_SIZE
+#define PORT_UART_RX_SIZE 256U /*!< Size in bytes of the circular buffer of reception. It must be a power of 2 */
+#endif
+
+/* Function prototypes and explanations ---------------------------------------*/
+/**
+ * @brief Configures the UART, its pins and its DMA streams, and starts the reception.
+ *
+ */
+void port_uart_init(void);
+
+/**
+ * @brief Gets the circular buffer in which the DMA writes the received bytes.
+ *
+ * @return const volatile uint8_t* Buffer of `PORT_UART_RX_SIZE` bytes.
+ */
+const volatile uint8_t *port_uart_get_rx_buffer(void);
+
+/**
+ * @brief Gets the position of the circular buffer in which the DMA will write the next received byte.
+ *
+ * @return uint32_t Index from 0 to `PORT_UART_RX_SIZE` - 1.
+ */
+uint32_t port_uart_get_rx_head(void);
+
+/**
+ * @brief Starts the transmission of a buffer by the DMA. It does not wait: `PORT_SYSTEM_EVENT_UART` is posted when the transfer ends.
+ *
+ * @param p_data Bytes to send. They must stay valid and unchanged until the end of the transfer.
+ * @param length Number of bytes to send (up to 65535).
+ * @return true if the transfer has started, false if the previous one has not ended yet.
+ */
+bool port_uart_send(const uint8_t *p_data, uint32_t length);
+
+/**
+ * @brief Checks if a transmission is in progress.
+ *
+ * @return true if the DMA has not finished the last transfer, false otherwise.
+ */
+bool port_uart_tx_busy(void);
+
+/**
+ * @brief Gets and clears the idle line flag of the UART. To be called from `USART2_IRQHandler()`.
+ *
+ * @return true if the line has become idle after a burst of received bytes.
+ */
+bool port_uart_get_and_clear_rx_idle(void);
+
+/**
+ * @brief Gets and clears the transfer complete flag of the DMA stream of transmission. To be called from `DMA1_Stream6_IRQHandler()`.
+ *
+ * @return true if the DMA has finished a transfer.
+ */
+bool port_uart_get_and_clear_tx_complete(void);
+
+#endif /* PORT_UART_H */
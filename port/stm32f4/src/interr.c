@@ -9,10 +9,28 @@
 #include "port_system.h"
 #include "port_led.h"
 #include "port_temp_sensor.h"
+#include "port_uart.h"
+#include "thermostat_profile.h"
 
 //------------------------------------------------------
 // INTERRUPT SERVICE ROUTINES
 //------------------------------------------------------
+#if PORT_SYSTEM_TICKLESS
+/**
+ * @brief Interrupt service routine for the timer of the tickless time base (TIM5).
+ *
+ * @note This ISR is only called when the 32-bit counter overflows (every 71.6 minutes) and at the compare match of the wake-up time, if any. There is no periodic tick.
+ *
+ */
+void TIM5_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_TIMEBASE_ISR);
+
+  port_system_timebase_irq();
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_TIMEBASE_ISR);
+}
+#else
 /**
  * @brief Interrupt service routine for the System tick timer (SysTick).
  *
@@ -25,38 +43,118 @@
  */
 void SysTick_Handler(void)
 {
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_TIMEBASE_ISR);
+
   port_system_set_millis(port_system_get_millis() + 1);
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_TIMEBASE_ISR);
 }
+#endif
 
 /**
- * @brief Interrupt service routine for the TIM2 timer.
+ * @brief Interrupt service routine for the DMA2 stream 0 (ADC1).
  *
- * @note This ISR is called when the TIM2 timer generates an interrupt.
+ * @note This ISR is called when the DMA has filled one half of the circular buffer of the scan of the temperature sensors.
  *
  */
-void TIM2_IRQHandler(void)
+void DMA2_Stream0_IRQHandler(void)
 {
-  // Start the ADC conversion
-  port_system_adc_start_conversion(temp_sensor_thermostat.p_adc, temp_sensor_thermostat.pin);
-  
-  TIM2->SR &= ~TIM_SR_UIF; // Clear the update interrupt flag
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_DMA_ISR);
+
+  uint32_t flags = port_system_adc_dma_get_and_clear_flags(temp_sensor_scan.p_adc);
+
+  // The DMA keeps filling the other half of the buffer while this one is processed. Each half holds the whole sequence of the scan, which is routed to every sensor
+  if (flags & ADC_DMA_HALF_TRANSFER)
+  {
+    port_temp_sensor_scan_save_samples(&temp_sensor_scan, &temp_sensor_scan.adc_buffer[0]);
+  }
+  if (flags & ADC_DMA_TRANSFER_COMPLETE)
+  {
+    port_temp_sensor_scan_save_samples(&temp_sensor_scan, &temp_sensor_scan.adc_buffer[temp_sensor_scan.n_conversions]);
+  }
+
+  // Wake up the main loop
+  if (flags != 0)
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_SAMPLE);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_DMA_ISR);
 }
 
 /**
  * @brief Interrupt service routine for all the ADCs.
  *
- * @note This ISR is called when any ADC generates an interrupt.
+ * @note This ISR is called when any ADC generates an interrupt. Only the analog watchdog is used.
  *
  */
 void ADC_IRQHandler(void)
 {
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_ADC_ISR);
+
   // Identify if the ADC that generated the interrupt is the same as the temperature sensor
-  if (temp_sensor_thermostat.p_adc->SR & ADC_SR_EOC)
+  if ((temp_sensor_thermostat.p_adc->CR1 & ADC_CR1_AWDIE) && (temp_sensor_thermostat.p_adc->SR & ADC_SR_AWD))
   {
-    // Read the temperature sensor value
-    port_temp_sensor_save_adc_value(&temp_sensor_thermostat, temp_sensor_thermostat.p_adc->DR);
-    
-    // Clear the ADC interrupt flag
-    temp_sensor_thermostat.p_adc->SR &= ~ADC_SR_EOC;
+    // The temperature has left the window of the watchdog: measure it again
+    port_temp_sensor_watchdog_triggered(&temp_sensor_thermostat);
   }
-}
\ No newline at end of file
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_ADC_ISR);
+}
+
+/**
+ * @brief Interrupt service routine for the wake-up timer of the RTC.
+ *
+ * @note This ISR is called every period of the wake-up timer of the RTC (EXTI line 22), which also wakes up the core from STOP mode. In low-power mode, it starts the measurement of the temperature instead of the measurement timer.
+ *
+ */
+void RTC_WKUP_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_RTC_ISR);
+
+  port_system_rtc_wakeup_handle();
+
+  // The ADC is triggered by software: the timers are stopped in STOP mode
+  if (!(temp_sensor_thermostat.p_adc->CR2 & ADC_CR2_EXTEN))
+  {
+    port_temp_sensor_start_measurement(&temp_sensor_thermostat);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_RTC_ISR);
+}
+
+/**
+ * @brief Interrupt service routine for USART2.
+ *
+ * @note This ISR is called when the RX line of USART2 becomes idle for one frame after a burst of received bytes, which the DMA has already moved to the circular buffer. The bytes are parsed by the main loop.
+ *
+ */
+void USART2_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_UART_ISR);
+
+  if (port_uart_get_and_clear_rx_idle())
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_UART);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_UART_ISR);
+}
+
+/**
+ * @brief Interrupt service routine for the DMA1 stream 6 (USART2_TX).
+ *
+ * @note This ISR is called when the DMA has moved the last byte of a transmission to USART2. The main loop may then send the next reply.
+ *
+ */
+void DMA1_Stream6_IRQHandler(void)
+{
+  THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_UART_ISR);
+
+  if (port_uart_get_and_clear_tx_complete())
+  {
+    port_system_post_event(PORT_SYSTEM_EVENT_UART);
+  }
+
+  THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_UART_ISR);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file port_flash.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Port layer for the flash: erase and programming of the sector of the configuration.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+/* HW dependent includes */
+#include "port_flash.h"
+#include "stm32f4xx.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define PORT_FLASH_KEY1 0x45670123U                                                                /*!< First key to unlock FLASH_CR */
+#define PORT_FLASH_KEY2 0xCDEF89ABU                                                                /*!< Second key to unlock FLASH_CR */
+#define PORT_FLASH_SR_ERRORS (FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR) /*!< Error flags of the programming and erase operations */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Unlocks the control register of the flash and selects a parallelism of 32 bits.
+ */
+static void _unlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = PORT_FLASH_KEY1;
+        FLASH->KEYR = PORT_FLASH_KEY2;
+    }
+    FLASH->CR &= ~FLASH_CR_PSIZE;
+    FLASH->CR |= FLASH_CR_PSIZE_1;
+}
+
+/**
+ * @brief Waits for the end of the current operation of the flash and clears its error flags.
+ *
+ * @return true if the operation has finished without errors, false otherwise.
+ */
+static bool _wait(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY)
+    {
+    }
+    uint32_t errors = FLASH->SR & PORT_FLASH_SR_ERRORS;
+    FLASH->SR = errors; // The flags are cleared by writing 1
+    return errors == 0;
+}
+
+/* Function definitions ------------------------------------------------------*/
+bool port_flash_erase(void)
+{
+    _unlock();
+    _wait();
+
+    // Sector erase
+    FLASH->CR &= ~FLASH_CR_SNB;
+    FLASH->CR |= FLASH_CR_SER | (PORT_FLASH_SECTOR << FLASH_CR_SNB_Pos);
+    FLASH->CR |= FLASH_CR_STRT;
+    bool ok = _wait();
+    FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    // The data cache may still hold the old contents of the sector
+    FLASH->ACR &= ~FLASH_ACR_DCEN;
+    FLASH->ACR |= FLASH_ACR_DCRST;
+    FLASH->ACR &= ~FLASH_ACR_DCRST;
+    FLASH->ACR |= FLASH_ACR_DCEN;
+    return ok;
+}
+
+bool port_flash_program(uint32_t offset, const uint32_t *p_words, uint32_t n_words)
+{
+    if (((offset % sizeof(uint32_t)) != 0) || (offset + n_words * sizeof(uint32_t) > PORT_FLASH_SECTOR_SIZE))
+    {
+        return false;
+    }
+
+    _unlock();
+    _wait();
+    FLASH->CR |= FLASH_CR_PG;
+    bool ok = true;
+    volatile uint32_t *p_flash = (volatile uint32_t *)(PORT_FLASH_SECTOR_BASE + offset);
+    for (uint32_t i = 0; (i < n_words) && ok; i++)
+    {
+        // In order: the first word of a record is programmed first
+        p_flash[i] = p_words[i];
+        ok = _wait();
+    }
+    FLASH->CR &= ~FLASH_CR_PG;
+    FLASH->CR |= FLASH_CR_LOCK;
+    return ok;
+}
+
+void port_flash_read(uint32_t offset, uint32_t *p_words, uint32_t n_words)
+{
+    const volatile uint32_t *p_flash = (const volatile uint32_t *)(PORT_FLASH_SECTOR_BASE + offset);
+    for (uint32_t i = 0; i < n_words; i++)
+    {
+        p_words[i] = p_flash[i];
+    }
+}
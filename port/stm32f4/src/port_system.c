@@ -11,14 +11,146 @@
 /* Defines -------------------------------------------------------------------*/
 #define HSI_VALUE ((uint32_t)16000000) /*!< Value of the Internal oscillator in Hz */
 
+#define DMA_STREAM_ALL_FLAGS (DMA_LISR_FEIF0 | DMA_LISR_DMEIF0 | DMA_LISR_TEIF0 | DMA_LISR_HTIF0 | DMA_LISR_TCIF0) /*!< All the flags of a DMA stream, shifted to the position of stream 0 */
+
+/* Typedefs ------------------------------------------------------------------*/
+/**
+ * @brief DMA stream that serves the requests of an ADC. Only DMA2 has access to the ADCs (RM0390, DMA2 request mapping).
+ */
+typedef struct
+{
+  ADC_TypeDef *p_adc;           /*!< ADC peripheral */
+  DMA_Stream_TypeDef *p_stream; /*!< DMA2 stream */
+  uint32_t channel;             /*!< Channel of the stream (CHSEL) mapped to the ADC */
+  uint8_t flags_pos;            /*!< Position of the flags of the stream in LISR and LIFCR */
+  IRQn_Type irqn;               /*!< Interrupt of the stream */
+} adc_dma_stream_t;
+
 /* GLOBAL VARIABLES */
+static volatile uint32_t pending_events = 0; /*!< Events posted by the ISRs and not yet consumed by the main loop */
+
+#if PORT_SYSTEM_TICKLESS
+static volatile uint32_t timebase_overflows = 0;                /*!< Upper 32 bits of the time base: overflows of the counter of the timer */
+static volatile uint64_t timebase_wakeup_us = PORT_SYSTEM_NO_WAKEUP; /*!< Wake-up time in counts of the time base */
+static int64_t timebase_offset_us = 0;                          /*!< Offset between the system time and the counts of the time base (see `port_system_set_millis()`) */
+#else
 static volatile uint32_t msTicks = 0; /*!< Variable to store millisecond ticks. @warning **It must be declared volatile!** Just because it is modified in an ISR. **Add it to the definition** after *static*. */
+static volatile uint64_t wakeup_ms = PORT_SYSTEM_NO_WAKEUP; /*!< Wake-up time in milliseconds, checked by the SysTick */
+#endif
+
+static volatile bool stop_mode = false;          /*!< The core enters STOP mode while waiting for events */
+static volatile bool stop_inhibited = false;     /*!< A peripheral needs its clock: the core enters SLEEP mode instead of STOP */
+static uint64_t rtc_period_us = 0;               /*!< Period of the wake-up timer of the RTC in microseconds */
+static uint64_t rtc_last_wakeup_us = 0;          /*!< System time of the last wake-up of the RTC */
+static port_system_power_stats_t power_stats;    /*!< Time asleep and number of sleeps (the time awake is computed when it is read) */
+
+static uint32_t adc_power_up_cycles[3] = {0};   /*!< Cycle of the core when the power-up of each ADC started */
+
+static const adc_dma_stream_t adc_dma_streams[] = {
+    {ADC1, DMA2_Stream0, 0U, 0U, DMA2_Stream0_IRQn},
+    {ADC2, DMA2_Stream2, 1U, 16U, DMA2_Stream2_IRQn},
+    {ADC3, DMA2_Stream1, 2U, 6U, DMA2_Stream1_IRQn},
+}; /*!< DMA streams of the ADCs */
 
 /* These variables are declared extern in CMSIS (system_stm32f4xx.h) */
 uint32_t SystemCoreClock = HSI_VALUE;                                               /*!< Frequency of the System clock */
 const uint8_t AHBPrescTable[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9}; /*!< Prescaler values for AHB bus */
 const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};                          /*!< Prescaler values for APB bus */
 
+#if PORT_SYSTEM_TICKLESS
+//------------------------------------------------------
+// TICKLESS TIME BASE
+//------------------------------------------------------
+/**
+ * @brief Starts the free-running timer of the time base: 1 count per microsecond over the full 32 bits, and only the overflow interrupt.
+ */
+static void _timebase_init(void)
+{
+  RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+
+  PORT_SYSTEM_TIMEBASE_TIMER->CR1 = TIM_CR1_URS; // Only the overflows of the counter set UIF, not the update generation below
+  PORT_SYSTEM_TIMEBASE_TIMER->PSC = (PORT_SYSTEM_TIMER_CLOCK_HZ / PORT_SYSTEM_TIMEBASE_FREQ_HZ) - 1U;
+  PORT_SYSTEM_TIMEBASE_TIMER->ARR = 0xFFFFFFFFU;
+  PORT_SYSTEM_TIMEBASE_TIMER->CNT = 0;
+  PORT_SYSTEM_TIMEBASE_TIMER->EGR = TIM_EGR_UG; // Load the prescaler
+  PORT_SYSTEM_TIMEBASE_TIMER->SR = 0;
+  PORT_SYSTEM_TIMEBASE_TIMER->DIER = TIM_DIER_UIE;
+
+  NVIC_EnableIRQ(PORT_SYSTEM_TIMEBASE_IRQN);
+  PORT_SYSTEM_TIMEBASE_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+/**
+ * @brief Reads the 64-bit counts of the time base.
+ *
+ * The upper word is read before and after the counter, so a read is consistent even if the overflow ISR runs in between. If the overflow is pending but not served yet, a low counter means that it has already wrapped around: the correction is applied to the returned value only, not to the comparison of the loop.
+ *
+ * It is safe with the interrupts masked (`__disable_irq()`, or an ISR with a priority higher than or equal to the one of the timer): the overflow ISR cannot run, so `timebase_overflows` does not change and the loop runs once.
+ *
+ * @return uint64_t Counts of the time base
+ */
+static uint64_t _timebase_counts(void)
+{
+  uint32_t high;
+  uint32_t low;
+  uint32_t pending;
+  do
+  {
+    high = timebase_overflows;
+    low = PORT_SYSTEM_TIMEBASE_TIMER->CNT;
+    pending = PORT_SYSTEM_TIMEBASE_TIMER->SR & TIM_SR_UIF;
+  } while (high != timebase_overflows);
+  if (pending && (low < 0x80000000U))
+  {
+    high++;
+  }
+  return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Programs the compare match of the wake-up time if it falls in the current period of the counter. Otherwise, it is programmed again at the overflow.
+ */
+static void _timebase_arm_wakeup(void)
+{
+  uint64_t wakeup = timebase_wakeup_us;
+  PORT_SYSTEM_TIMEBASE_TIMER->DIER &= ~TIM_DIER_CC1IE;
+  if ((wakeup == PORT_SYSTEM_NO_WAKEUP) || ((uint32_t)(wakeup >> 32) != timebase_overflows))
+  {
+    return;
+  }
+
+  PORT_SYSTEM_TIMEBASE_TIMER->CCR1 = (uint32_t)wakeup;
+  PORT_SYSTEM_TIMEBASE_TIMER->SR = ~TIM_SR_CC1IF;
+  PORT_SYSTEM_TIMEBASE_TIMER->DIER |= TIM_DIER_CC1IE;
+
+  // The compare match is missed if the counter has already passed it
+  if (_timebase_counts() >= wakeup)
+  {
+    PORT_SYSTEM_TIMEBASE_TIMER->DIER &= ~TIM_DIER_CC1IE;
+    timebase_wakeup_us = PORT_SYSTEM_NO_WAKEUP;
+    port_system_post_event(PORT_SYSTEM_EVENT_TIMEOUT);
+  }
+}
+
+void port_system_timebase_irq(void)
+{
+  uint32_t sr = PORT_SYSTEM_TIMEBASE_TIMER->SR;
+  if (sr & TIM_SR_UIF)
+  {
+    PORT_SYSTEM_TIMEBASE_TIMER->SR = ~TIM_SR_UIF;
+    timebase_overflows++;
+    _timebase_arm_wakeup();
+  }
+  if ((sr & TIM_SR_CC1IF) && (PORT_SYSTEM_TIMEBASE_TIMER->DIER & TIM_DIER_CC1IE))
+  {
+    PORT_SYSTEM_TIMEBASE_TIMER->SR = ~TIM_SR_CC1IF;
+    PORT_SYSTEM_TIMEBASE_TIMER->DIER &= ~TIM_DIER_CC1IE;
+    timebase_wakeup_us = PORT_SYSTEM_NO_WAKEUP;
+    port_system_post_event(PORT_SYSTEM_EVENT_TIMEOUT);
+  }
+}
+#endif
+
 //------------------------------------------------------
 // SYSTEM CONFIGURATION
 //------------------------------------------------------
@@ -83,7 +215,14 @@ void system_clock_config(void)
   SystemCoreClock = HSI_VALUE >> AHBPrescTable[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
 
   /* Configure the source of time base considering new system clocks settings */
+#if PORT_SYSTEM_TICKLESS
+  if (!(PORT_SYSTEM_TIMEBASE_TIMER->CR1 & TIM_CR1_CEN))
+  {
+    _timebase_init(); // Only once: it keeps counting when the clocks are restored after STOP mode
+  }
+#else
   SysTick_Config(SystemCoreClock / (1000U / TICK_FREQ_1KHZ)); /* Set Systick to 1 ms */
+#endif
 }
 
 size_t port_system_init()
@@ -99,12 +238,20 @@ size_t port_system_init()
   /* Prefetch cache enable */
   FLASH->ACR |= FLASH_ACR_PRFTEN;
 
+  /* Enable the cycle counter of the DWT (trace must be enabled first) */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
   /* Set Interrupt Group Priority */
   NVIC_SetPriorityGrouping(NVIC_PRIORITY_GROUP_4);
 
   /* Use systick as time base source and configure 1ms tick (default clock after Reset is HSI) */
   /* Configure the SysTick IRQ priority. It must be the highest (lower number: 0)*/
   NVIC_SetPriority(SysTick_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0U, 0U)); /* Tick interrupt priority */
+#if PORT_SYSTEM_TICKLESS
+  NVIC_SetPriority(PORT_SYSTEM_TIMEBASE_IRQN, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0U, 0U)); /* Same priority for the tickless time base */
+#endif
 
   /* Init the low level hardware */
   /* Reset and clock control (RCC) */
@@ -122,6 +269,43 @@ size_t port_system_init()
 //------------------------------------------------------
 // TIMER RELATED FUNCTIONS
 //------------------------------------------------------
+#if PORT_SYSTEM_TICKLESS
+uint64_t port_system_get_time_us()
+{
+  return _timebase_counts() + (uint64_t)timebase_offset_us;
+}
+
+uint32_t port_system_get_millis()
+{
+  return (uint32_t)(port_system_get_time_us() / 1000U);
+}
+
+void port_system_set_millis(uint32_t ms)
+{
+  timebase_offset_us = (int64_t)((uint64_t)ms * 1000U) - (int64_t)_timebase_counts();
+}
+
+void port_system_set_wakeup_us(uint64_t t_us)
+{
+  __disable_irq();
+  timebase_wakeup_us = t_us - (uint64_t)timebase_offset_us;
+  _timebase_arm_wakeup();
+  __enable_irq();
+}
+
+void port_system_cancel_wakeup()
+{
+  __disable_irq();
+  timebase_wakeup_us = PORT_SYSTEM_NO_WAKEUP;
+  PORT_SYSTEM_TIMEBASE_TIMER->DIER &= ~TIM_DIER_CC1IE;
+  __enable_irq();
+}
+#else
+uint64_t port_system_get_time_us()
+{
+  return (uint64_t)msTicks * 1000U;
+}
+
 uint32_t port_system_get_millis()
 {
   return msTicks;
@@ -130,24 +314,91 @@ uint32_t port_system_get_millis()
 void port_system_set_millis(uint32_t ms)
 {
   msTicks = ms;
+
+  // Wake-up time of the main loop
+  if ((wakeup_ms != PORT_SYSTEM_NO_WAKEUP) && ((int32_t)(ms - (uint32_t)wakeup_ms) >= 0))
+  {
+    wakeup_ms = PORT_SYSTEM_NO_WAKEUP;
+    port_system_post_event(PORT_SYSTEM_EVENT_TIMEOUT);
+  }
+}
+
+void port_system_set_wakeup_us(uint64_t t_us)
+{
+  // Rounded up to the next tick
+  wakeup_ms = (t_us + 999U) / 1000U;
 }
 
+void port_system_cancel_wakeup()
+{
+  wakeup_ms = PORT_SYSTEM_NO_WAKEUP;
+}
+#endif
+
 void port_system_delay_ms(uint32_t ms)
 {
-  uint32_t tickstart = port_system_get_millis();
+  uint64_t until = port_system_get_time_us() + (uint64_t)ms * 1000U;
+
+  while (port_system_get_time_us() < until)
+  {
+  }
+}
+
+void port_system_delay_us(uint32_t us)
+{
+  // Chunks of 1 ms at most, so that the cycles never overflow 32 bits
+  uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+  while (us > 0)
+  {
+    uint32_t chunk = (us > 1000U) ? 1000U : us;
+    uint32_t cycles = chunk * cycles_per_us;
+    uint32_t start = DWT->CYCCNT;
+    while ((DWT->CYCCNT - start) < cycles)
+    {
+    }
+    us -= chunk;
+  }
+}
+
+uint32_t port_system_get_cycles()
+{
+  return DWT->CYCCNT;
+}
 
-  while ((port_system_get_millis() - tickstart) < ms)
+void port_system_trace_write(const char *p_data, uint32_t length)
+{
+  // ITM_SendChar() discards the characters if the debugger has not enabled the ITM and its stimulus port 0
+  for (uint32_t i = 0; i < length; i++)
+  {
+    ITM_SendChar((uint32_t)(uint8_t)p_data[i]);
+  }
+}
+
+void port_system_trace_write_text(const char *p_data, uint32_t length)
+{
+  // As ITM_SendChar(), but on another stimulus port. The characters are discarded if the debugger has not enabled it
+  if (((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0U) || ((ITM->TER & (1UL << PORT_SYSTEM_TRACE_TEXT_PORT)) == 0U))
   {
+    return;
+  }
+  for (uint32_t i = 0; i < length; i++)
+  {
+    while (ITM->PORT[PORT_SYSTEM_TRACE_TEXT_PORT].u32 == 0UL)
+    {
+      __NOP();
+    }
+    ITM->PORT[PORT_SYSTEM_TRACE_TEXT_PORT].u8 = (uint8_t)p_data[i];
   }
 }
 
 void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms)
 {
+  // The difference is signed so that it is right when the milliseconds wrap around between the reference and now
   uint32_t until = *p_t + ms;
-  uint32_t now = port_system_get_millis();
-  if (until > now)
+  int32_t remaining = (int32_t)(until - port_system_get_millis());
+  if (remaining > 0)
   {
-    port_system_delay_ms(until - now);
+    port_system_delay_ms((uint32_t)remaining);
   }
   *p_t = port_system_get_millis();
 }
@@ -155,20 +406,21 @@ void port_system_delay_until_ms(uint32_t *p_t, uint32_t ms)
 //------------------------------------------------------
 // GPIO RELATED FUNCTIONS
 //------------------------------------------------------
+/**
+ * @brief Returns the index of a GPIO port: 0 for GPIOA, 1 for GPIOB, and so on. The ports are evenly spaced in the AHB1 bus, in the same order as their clock enable bits in `RCC->AHB1ENR` and their selectors in `SYSCFG->EXTICR`.
+ *
+ * @param p_port Port of the GPIO (CMSIS struct like)
+ * @return uint32_t Index of the port
+ */
+static inline uint32_t _gpio_port_index(GPIO_TypeDef *p_port)
+{
+  return ((uint32_t)p_port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+}
+
 void port_system_gpio_config(GPIO_TypeDef *p_port, uint8_t pin, uint8_t mode, uint8_t pupd)
 {
-  if (p_port == GPIOA)
-  {
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN; /* GPIOA_CLK_ENABLE */
-  }
-  else if (p_port == GPIOB)
-  {
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN; /* GPIOB_CLK_ENABLE */
-  }
-  else if (p_port == GPIOC)
-  {
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOCEN; /* GPIOC_CLK_ENABLE */
-  }
+  /* GPIOx_CLK_ENABLE: one bit per port, without comparing the port with each GPIO */
+  RCC->AHB1ENR |= BIT_POS_TO_MASK(_gpio_port_index(p_port));
 
   /* Clean ( &=~ ) by displacing the base register and set the configuration ( |= ) */
   p_port->MODER &= ~(GPIO_MODER_MODER0 << (pin * 2U));
@@ -178,26 +430,31 @@ void port_system_gpio_config(GPIO_TypeDef *p_port, uint8_t pin, uint8_t mode, ui
   p_port->PUPDR |= (pupd << (pin * 2U));
 }
 
+void port_system_gpio_config_pin(const port_system_gpio_pin_t *p_pin)
+{
+  /* The clock enable bit is in the descriptor */
+  RCC->AHB1ENR |= p_pin->clock_mask;
+
+  p_pin->p_port->MODER &= ~(GPIO_MODER_MODER0 << (p_pin->pin * 2U));
+  p_pin->p_port->MODER |= ((uint32_t)p_pin->mode << (p_pin->pin * 2U));
+
+  p_pin->p_port->PUPDR &= ~(GPIO_PUPDR_PUPD0 << (p_pin->pin * 2U));
+  p_pin->p_port->PUPDR |= ((uint32_t)p_pin->pupd << (p_pin->pin * 2U));
+}
+
+void port_system_gpio_write(GPIO_TypeDef *p_port, uint16_t set_mask, uint16_t reset_mask)
+{
+  /* Bit set/reset register: the lower half sets, the upper half resets, and the set wins. One atomic write: no read-modify-write of ODR, so an ISR cannot lose the change of another pin of the port */
+  p_port->BSRR = ((uint32_t)reset_mask << GPIO_BSRR_BR0_Pos) | set_mask;
+}
+
 void port_system_gpio_config_exti(GPIO_TypeDef *p_port, uint8_t pin, uint32_t mode)
 {
-  uint32_t port_selector = 0;
+  uint32_t port_selector = _gpio_port_index(p_port);
 
   RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
 
   /* SYSCFG external interrupt configuration register */
-  if (p_port == GPIOA)
-  {
-    port_selector = 0;
-  }
-  else if (p_port == GPIOB)
-  {
-    port_selector = 1;
-  }
-  else if (p_port == GPIOC)
-  {
-    port_selector = 2;
-  }
-
   uint32_t base_mask = 0x0FU;
   uint32_t displacement = (pin % 4) * 4;
 
@@ -354,15 +611,36 @@ void port_system_adc_interrupt_enable(uint8_t priority, uint8_t subpriority)
   NVIC_EnableIRQ(ADC_IRQn);
 }
 
+/**
+ * @brief Get the index of an ADC peripheral.
+ *
+ * @param p_adc ADC peripheral
+ * @return uint8_t 0 for ADC1, 1 for ADC2 and 2 for ADC3
+ */
+static uint8_t _adc_index(ADC_TypeDef *p_adc)
+{
+  return (p_adc == ADC1) ? 0U : ((p_adc == ADC2) ? 1U : 2U);
+}
+
 void port_system_adc_enable(ADC_TypeDef *p_adc)
 {
-  // Enable the ADC
+  // Enable the ADC and wait exactly its stabilization time
+  port_system_adc_power_up_start(p_adc);
+  while (!port_system_adc_power_up_ready(p_adc))
+  {
+  }
+}
+
+void port_system_adc_power_up_start(ADC_TypeDef *p_adc)
+{
+  adc_power_up_cycles[_adc_index(p_adc)] = DWT->CYCCNT;
   p_adc->CR2 |= ADC_CR2_ADON;
+}
 
-  // Wait for the ADC to be ready (approximately 10 us)
-  uint32_t delay = 10000;
-  while (delay--)
-    ;
+bool port_system_adc_power_up_ready(ADC_TypeDef *p_adc)
+{
+  uint32_t cycles = ADC_STABILIZATION_US * (SystemCoreClock / 1000000U);
+  return (p_adc->CR2 & ADC_CR2_ADON) && ((DWT->CYCCNT - adc_power_up_cycles[_adc_index(p_adc)]) >= cycles);
 }
 
 void port_system_adc_disable(ADC_TypeDef *p_adc)
@@ -386,6 +664,372 @@ void port_system_adc_start_conversion(ADC_TypeDef *p_adc, uint8_t channel)
   p_adc->CR2 |= ADC_CR2_SWSTART;
 }
 
+/**
+ * @brief Get the DMA stream that serves the requests of an ADC.
+ *
+ * @param p_adc ADC peripheral (CMSIS struct like)
+ * @return const adc_dma_stream_t* DMA stream of the ADC, or NULL if it is not an ADC.
+ */
+static const adc_dma_stream_t *_adc_dma_stream(ADC_TypeDef *p_adc)
+{
+  for (uint8_t i = 0; i < sizeof(adc_dma_streams) / sizeof(adc_dma_streams[0]); i++)
+  {
+    if (adc_dma_streams[i].p_adc == p_adc)
+    {
+      return &adc_dma_streams[i];
+    }
+  }
+  return NULL;
+}
+
+void port_system_adc_dma_init(ADC_TypeDef *p_adc, uint8_t channel, uint32_t cr_mode, volatile uint16_t *p_buffer, uint8_t n_conversions)
+{
+  // The same channel in all the slots of the sequence
+  uint8_t channels[ADC_DMA_MAX_CONVERSIONS];
+  for (uint8_t i = 0; (i < n_conversions) && (i < ADC_DMA_MAX_CONVERSIONS); i++)
+  {
+    channels[i] = channel;
+  }
+  port_system_adc_dma_scan_init(p_adc, channels, n_conversions, cr_mode, p_buffer);
+}
+
+void port_system_adc_dma_scan_init(ADC_TypeDef *p_adc, const uint8_t *p_channels, uint8_t n_conversions, uint32_t cr_mode, volatile uint16_t *p_buffer)
+{
+  const adc_dma_stream_t *p_dma = _adc_dma_stream(p_adc);
+  if ((p_dma == NULL) || (n_conversions == 0) || (n_conversions > ADC_DMA_MAX_CONVERSIONS))
+  {
+    return;
+  }
+
+  // Clock, reset and resolution are the same as in single channel mode. The interrupts of the ADC are not used.
+  port_system_adc_single_ch_init(p_adc, p_channels[0], cr_mode & ADC_CR1_RES_Msk);
+
+  //-------------------------------------------------------------------------------------------
+  // 	Regular sequence: one channel per slot (SQ1 to SQ6 in SQR3, SQ7 to SQ12 in SQR2, SQ13 to SQ16 in SQR1), with a longer sampling time
+  //-------------------------------------------------------------------------------------------
+  p_adc->CR1 |= ADC_CR1_SCAN;
+  p_adc->SQR1 = ((uint32_t)(n_conversions - 1U) << ADC_SQR1_L_Pos);
+  p_adc->SQR2 = 0;
+  p_adc->SQR3 = 0;
+  for (uint8_t i = 0; i < n_conversions; i++)
+  {
+    uint8_t channel = p_channels[i] & 0x1FU; // Only 16 channels are available
+    volatile uint32_t *p_sqr = (i < 6) ? &p_adc->SQR3 : ((i < 12) ? &p_adc->SQR2 : &p_adc->SQR1);
+    *p_sqr |= ((uint32_t)channel << ((i % 6) * 5));
+
+    // The ADC was reset by port_system_adc_single_ch_init(), so setting the bits is enough even if the channel is repeated
+    if (channel < 10)
+    {
+      p_adc->SMPR2 |= (ADC_DMA_SAMPLING_TIME << (channel * 3));
+    }
+    else
+    {
+      p_adc->SMPR1 |= (ADC_DMA_SAMPLING_TIME << ((channel - 10) * 3));
+    }
+  }
+
+  // DMA request after each conversion. DDS: keep issuing requests after the last transfer of the DMA, since the buffer is circular
+  p_adc->CR2 |= ADC_CR2_DMA | ADC_CR2_DDS;
+
+  // EOC flag at the end of the sequence, not at the end of each conversion
+  p_adc->CR2 &= ~ADC_CR2_EOCS;
+
+  //-------------------------------------------------------------------------------------------
+  // 	DMA stream configuration
+  //-------------------------------------------------------------------------------------------
+  RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN; /* DMA2_CLK_ENABLE */
+
+  // The stream can only be configured while it is disabled
+  DMA_Stream_TypeDef *p_stream = p_dma->p_stream;
+  p_stream->CR &= ~DMA_SxCR_EN;
+  while (p_stream->CR & DMA_SxCR_EN)
+    ;
+
+  // From the data register of the ADC to the circular buffer, which holds 2 sequences
+  p_stream->PAR = (uint32_t)(uintptr_t)&p_adc->DR;
+  p_stream->M0AR = (uint32_t)(uintptr_t)p_buffer;
+  p_stream->NDTR = 2U * n_conversions;
+
+  // Channel of the ADC, peripheral-to-memory (DIR = 00), high priority, 16-bit transfers, memory increment, circular mode, and interrupts at half and full transfer
+  p_stream->CR = (p_dma->channel << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_PL_1 | DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+  // Direct mode (no FIFO)
+  p_stream->FCR = 0;
+
+  // Clear the flags of previous transfers and enable the stream. It waits for the requests of the ADC
+  DMA2->LIFCR = (DMA_STREAM_ALL_FLAGS << p_dma->flags_pos);
+  p_stream->CR |= DMA_SxCR_EN;
+}
+
+void port_system_adc_dma_interrupt_enable(ADC_TypeDef *p_adc, uint8_t priority, uint8_t subpriority)
+{
+  const adc_dma_stream_t *p_dma = _adc_dma_stream(p_adc);
+  if (p_dma != NULL)
+  {
+    NVIC_SetPriority(p_dma->irqn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), priority, subpriority));
+    NVIC_EnableIRQ(p_dma->irqn);
+  }
+}
+
+uint32_t port_system_adc_dma_get_and_clear_flags(ADC_TypeDef *p_adc)
+{
+  const adc_dma_stream_t *p_dma = _adc_dma_stream(p_adc);
+  if (p_dma == NULL)
+  {
+    return 0;
+  }
+
+  // Clear only the flags that have been read, so that a transfer that ends in between is not missed
+  uint32_t lisr = (DMA2->LISR >> p_dma->flags_pos) & (DMA_LISR_HTIF0 | DMA_LISR_TCIF0);
+  DMA2->LIFCR = (lisr << p_dma->flags_pos);
+
+  uint32_t flags = 0;
+  if (lisr & DMA_LISR_HTIF0)
+  {
+    flags |= ADC_DMA_HALF_TRANSFER;
+  }
+  if (lisr & DMA_LISR_TCIF0)
+  {
+    flags |= ADC_DMA_TRANSFER_COMPLETE;
+  }
+  return flags;
+}
+
+void port_system_adc_dma_set_interrupts(ADC_TypeDef *p_adc, bool enable)
+{
+  const adc_dma_stream_t *p_dma = _adc_dma_stream(p_adc);
+  if (p_dma == NULL)
+  {
+    return;
+  }
+
+  if (enable)
+  {
+    // Discard the transfers that ended while the interrupts were disabled
+    DMA2->LIFCR = ((DMA_LISR_HTIF0 | DMA_LISR_TCIF0) << p_dma->flags_pos);
+    p_dma->p_stream->CR |= DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+  }
+  else
+  {
+    // The interrupt enable bits can be modified while the stream is enabled
+    p_dma->p_stream->CR &= ~(DMA_SxCR_HTIE | DMA_SxCR_TCIE);
+  }
+}
+
+void port_system_adc_watchdog_enable(ADC_TypeDef *p_adc, uint8_t channel, uint16_t low, uint16_t high)
+{
+  // Window of the watchdog (12 bits)
+  p_adc->LTR = low & ADC_LTR_LT;
+  p_adc->HTR = high & ADC_HTR_HT;
+
+  // Clear the flag of previous comparisons
+  p_adc->SR &= ~ADC_SR_AWD;
+
+  // Watchdog on a single regular channel, and its interrupt
+  p_adc->CR1 &= ~ADC_CR1_AWDCH;
+  p_adc->CR1 |= ((channel & 0x1FU) << ADC_CR1_AWDCH_Pos) | ADC_CR1_AWDSGL | ADC_CR1_AWDEN | ADC_CR1_AWDIE;
+}
+
+void port_system_adc_watchdog_disable(ADC_TypeDef *p_adc)
+{
+  p_adc->CR1 &= ~(ADC_CR1_AWDEN | ADC_CR1_AWDIE);
+  p_adc->SR &= ~ADC_SR_AWD;
+}
+
+void port_system_adc_set_external_trigger(ADC_TypeDef *p_adc, uint32_t trigger)
+{
+  // Trigger source of the regular channels
+  p_adc->CR2 &= ~(ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+  if (trigger == ADC_EXTERNAL_TRIGGER_SOFTWARE)
+  {
+    return;
+  }
+  p_adc->CR2 |= (trigger & ADC_CR2_EXTSEL);
+
+  // 01: Trigger detection on the rising edge
+  p_adc->CR2 |= ADC_CR2_EXTEN_0;
+}
+
+void port_system_adc_start_scan(ADC_TypeDef *p_adc)
+{
+  // Clear the status register
+  p_adc->SR = 0;
+
+  // Start the conversion of the whole regular sequence
+  p_adc->CR2 |= ADC_CR2_SWSTART;
+}
+
 // ------------------------------------------------------
 // POWER RELATED FUNCTIONS
-// ------------------------------------------------------
\ No newline at end of file
+// ------------------------------------------------------
+uint32_t port_system_critical_enter(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  return primask;
+}
+
+void port_system_critical_exit(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
+
+void port_system_post_event(uint32_t events)
+{
+  // ISRs of different priorities may post at the same time: make the read-modify-write atomic
+  uint32_t state = port_system_critical_enter();
+  pending_events |= events;
+  port_system_critical_exit(state);
+}
+
+/**
+ * @brief Adds time to the time base, e.g., the time spent in STOP mode, while its timer was stopped.
+ *
+ * @param us Microseconds to add
+ */
+static void _timebase_add_us(uint64_t us)
+{
+#if PORT_SYSTEM_TICKLESS
+  timebase_offset_us += (int64_t)us;
+#else
+  msTicks += (uint32_t)(us / 1000U);
+#endif
+}
+
+/**
+ * @brief Enters STOP mode until an EXTI line wakes up the core, and restores the clocks.
+ */
+static void _enter_stop(void)
+{
+  // STOP mode with the low-power regulator: the SRAM and the registers are kept
+  PWR->CR &= ~PWR_CR_PDDS;
+  PWR->CR |= PWR_CR_LPDS;
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  __WFI();
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+  // The core wakes up running from the HSI: restore the configuration of the clocks before any ISR runs
+  system_clock_config();
+}
+
+uint32_t port_system_wait_for_events(void)
+{
+  uint32_t events;
+
+  __disable_irq();
+  while ((events = pending_events) == 0)
+  {
+    uint64_t t_sleep = port_system_get_time_us();
+    if (stop_mode && !stop_inhibited)
+    {
+      _enter_stop();
+      power_stats.stops++;
+    }
+    else
+    {
+      __WFI(); // Sleep. A pending interrupt wakes up the core even if PRIMASK is set
+    }
+    __enable_irq(); // Let the ISR run
+    __disable_irq();
+
+    // The ISR of the RTC adds the time in STOP mode to the time base, so the difference is the time asleep in both modes
+    power_stats.asleep_us += port_system_get_time_us() - t_sleep;
+    power_stats.sleeps++;
+  }
+  pending_events = 0;
+  __enable_irq();
+
+  return events;
+}
+
+void port_system_set_stop_mode(bool enable)
+{
+  stop_mode = enable;
+}
+
+void port_system_inhibit_stop(bool inhibit)
+{
+  stop_inhibited = inhibit;
+}
+
+void port_system_rtc_wakeup_start(uint32_t period_ms)
+{
+  if (period_ms > RTC_WAKEUP_MAX_MS)
+  {
+    period_ms = RTC_WAKEUP_MAX_MS;
+  }
+
+  // Access to the backup domain, and LSI as the clock of the RTC
+  PWR->CR |= PWR_CR_DBP;
+  RCC->CSR |= RCC_CSR_LSION;
+  while (!(RCC->CSR & RCC_CSR_LSIRDY))
+  {
+  }
+  if ((RCC->BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_1)
+  {
+    // The clock of the RTC can only be selected after a reset of the backup domain
+    RCC->BDCR |= RCC_BDCR_BDRST;
+    RCC->BDCR &= ~RCC_BDCR_BDRST;
+    RCC->BDCR |= RCC_BDCR_RTCSEL_1;
+  }
+  RCC->BDCR |= RCC_BDCR_RTCEN;
+
+  // Unlock the write protection and stop the wake-up timer to change its period
+  RTC->WPR = RTC_WPR_KEY1;
+  RTC->WPR = RTC_WPR_KEY2;
+  RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+  while (!(RTC->ISR & RTC_ISR_WUTWF))
+  {
+  }
+
+  // 000: RTC clock / 16
+  RTC->CR &= ~RTC_CR_WUCKSEL;
+  RTC->WUTR = period_ms * RTC_WAKEUP_TICKS_PER_MS - 1U;
+  RTC->ISR &= ~RTC_ISR_WUTF;
+  RTC->CR |= RTC_CR_WUTIE | RTC_CR_WUTE;
+  RTC->WPR = 0xFFU; // Lock the write protection again
+
+  // The wake-up event reaches the core through its EXTI line, on the rising edge
+  EXTI->PR = BIT_POS_TO_MASK(RTC_WAKEUP_EXTI_LINE);
+  EXTI->RTSR |= BIT_POS_TO_MASK(RTC_WAKEUP_EXTI_LINE);
+  EXTI->IMR |= BIT_POS_TO_MASK(RTC_WAKEUP_EXTI_LINE);
+  NVIC_SetPriority(RTC_WKUP_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 1, 0));
+  NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+  rtc_period_us = (uint64_t)period_ms * 1000U;
+  rtc_last_wakeup_us = port_system_get_time_us();
+}
+
+void port_system_rtc_wakeup_stop(void)
+{
+  NVIC_DisableIRQ(RTC_WKUP_IRQn);
+  EXTI->IMR &= ~BIT_POS_TO_MASK(RTC_WAKEUP_EXTI_LINE);
+
+  RTC->WPR = RTC_WPR_KEY1;
+  RTC->WPR = RTC_WPR_KEY2;
+  RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+  RTC->WPR = 0xFFU;
+  rtc_period_us = 0;
+}
+
+void port_system_rtc_wakeup_handle(void)
+{
+  RTC->ISR &= ~RTC_ISR_WUTF;
+  EXTI->PR = BIT_POS_TO_MASK(RTC_WAKEUP_EXTI_LINE);
+
+  // One period of the RTC has passed since the previous wake-up, but the time base has only counted the time awake
+  uint64_t awake_us = port_system_get_time_us() - rtc_last_wakeup_us;
+  if (stop_mode && (awake_us < rtc_period_us))
+  {
+    _timebase_add_us(rtc_period_us - awake_us);
+  }
+  rtc_last_wakeup_us = port_system_get_time_us();
+}
+
+void port_system_get_power_stats(port_system_power_stats_t *p_stats)
+{
+  __disable_irq();
+  *p_stats = power_stats;
+  __enable_irq();
+  p_stats->awake_us = port_system_get_time_us() - p_stats->asleep_us;
+}
@@ -9,57 +9,267 @@
 
 /* Standard C includes */
 #include <stdint.h>
-#include <stdio.h>
 
 /* HW dependent includes */
 #include "port_temp_sensor.h"
 #include "stm32f4xx.h"
 #include "port_system.h"
+#include "thermostat_log.h"
+#include "thermostat_trace.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define TEMP_SENSOR_FULL_SCALE ((1U << TEMP_SENSOR_ADC_BITS) - 1U)                      /*!< Counts of a measurement at `ADC_VREF_MV` */
+#define TEMP_SENSOR_MCELSIUS_PER_MV 100U                                                  /*!< LM35: 10 mV/ºC, i.e., 100 milli-degrees Celsius per millivolt */
+#define TEMP_SENSOR_MCELSIUS_FULL_SCALE (ADC_VREF_MV * TEMP_SENSOR_MCELSIUS_PER_MV)       /*!< Temperature at the full scale of the ADC in milli-degrees Celsius */
+#define TEMP_SENSOR_MCELSIUS_PER_COUNT_Q16 ((((uint64_t)TEMP_SENSOR_MCELSIUS_FULL_SCALE << 16) + TEMP_SENSOR_FULL_SCALE / 2U) / TEMP_SENSOR_FULL_SCALE) /*!< Milli-degrees Celsius per count in Q16.16. It is computed at compile time */
+
+_Static_assert(TEMP_SENSOR_OVERSAMPLING <= ADC_DMA_MAX_CONVERSIONS, "The conversions of a measurement must fit in one regular sequence of the ADC");
+_Static_assert(TEMP_SENSOR_SCAN_MAX_SENSORS <= 64U, "The slot of a sensor is recorded in 6 bits of the trace");
 
 /* Global variables -----------------------------------------------------------*/
-port_temp_hw_t temp_sensor_thermostat = {.p_port = TEMP_SENSOR_THERMOSTAT_GPIO, .pin = TEMP_SENSOR_THERMOSTAT_PIN, .p_adc = TEMP_SENSOR_THERMOSTAT_ADC, .adc_channel = TEMP_SENSOR_THERMOSTAT_ADC_CHANNEL, .temperature_celsius = 0};
+port_temp_hw_t temp_sensor_thermostat = {.p_port = TEMP_SENSOR_THERMOSTAT_GPIO, .pin = TEMP_SENSOR_THERMOSTAT_PIN, .p_adc = TEMP_SENSOR_THERMOSTAT_ADC, .adc_channel = TEMP_SENSOR_THERMOSTAT_ADC_CHANNEL, .adc_counts = 0, .sample_seq = 0};
+port_temp_scan_t temp_sensor_scan = {.p_adc = TEMP_SENSOR_THERMOSTAT_ADC, .n_sensors = 0};
 
 /* Private functions */
 
 /**
- * @brief Converts an ADC value to millivolts. 
- * 
- * @param adcValue Counts of the ADC  
- * @param adc_res_bits Resolution of the ADC in bits 
- * @return uint32_t Millivolts 
+ * @brief Converts a measurement into milli-degrees Celsius. Only an integer multiplication and a shift: no division, no floating point.
+ *
+ * @param counts Counts of `TEMP_SENSOR_ADC_BITS` bits
+ * @return int32_t Milli-degrees Celsius
  */
-uint32_t _adc_to_mvolts(uint32_t adcValue, uint8_t adc_res_bits)
+static int32_t _adc_to_mcelsius(uint32_t counts)
 {
-    uint32_t mvolts = (ADC_VREF_MV * adcValue) / ((1 << adc_res_bits) - 1);
-    return mvolts;
+    return (int32_t)(((uint64_t)counts * TEMP_SENSOR_MCELSIUS_PER_COUNT_Q16 + 0x8000U) >> 16);
 }
+
 /* Function definitions ------------------------------------------------------*/
-double port_temp_sensor_get_temperature(port_temp_hw_t *p_temp)
+int32_t port_temp_sensor_get_temperature_mcelsius(port_temp_hw_t *p_temp)
+{
+    return _adc_to_mcelsius(p_temp->adc_counts);
+}
+
+uint32_t port_temp_sensor_get_adc_counts(port_temp_hw_t *p_temp)
+{
+    return p_temp->adc_counts;
+}
+
+uint32_t port_temp_sensor_mcelsius_to_adc_counts(port_temp_hw_t *p_temp, int32_t mcelsius)
+{
+    if (mcelsius <= 0)
+    {
+        return 0;
+    }
+    if (mcelsius > (int32_t)TEMP_SENSOR_MCELSIUS_FULL_SCALE)
+    {
+        return TEMP_SENSOR_FULL_SCALE + 1U;
+    }
+
+    // Round up: smallest measurement whose temperature is not below the given one. It is only computed when a threshold is set, not for each sample
+    return (uint32_t)(((uint64_t)mcelsius * TEMP_SENSOR_FULL_SCALE + TEMP_SENSOR_MCELSIUS_FULL_SCALE - 1U) / TEMP_SENSOR_MCELSIUS_FULL_SCALE);
+}
+
+uint32_t port_temp_sensor_get_sample_seq(port_temp_hw_t *p_temp)
+{
+    return p_temp->sample_seq;
+}
+
+void port_temp_sensor_save_adc_value(port_temp_hw_t *p_temp, uint32_t adc_value)
+{
+    // Record the raw counts for a later replay
+    thermostat_trace_sample(p_temp->scan_slot, adc_value);
+
+    // Filter the measurement before the consumers see it
+    if (p_temp->p_filter != NULL)
+    {
+        adc_value = thermostat_filter_update(p_temp->p_filter, adc_value);
+    }
+
+    // Keep the counts. They are converted to temperature only when it is needed
+    p_temp->adc_counts = adc_value;
+
+    // Notify the consumers that there is a new sample
+    p_temp->sample_seq++;
+
+    // Log the sample. It is sent to the telemetry by the main loop, not in the ISR
+    thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, p_temp->scan_slot, _adc_to_mcelsius(adc_value));
+}
+
+void port_temp_sensor_scan_save_samples(port_temp_scan_t *p_scan, const volatile uint16_t *p_samples)
+{
+    uint8_t n = p_scan->n_sensors;
+    uint8_t bits = p_scan->oversampling_bits;
+    uint8_t rounds = (uint8_t)(1U << (2U * bits));
+    for (uint8_t i = 0; i < n; i++)
+    {
+        // Oversampling and decimation: the sum of 4^bits samples has 2 * bits more bits, and the bits LSBs are mostly noise. The rest of the resolution is only a scale, so that all the measurements have TEMP_SENSOR_ADC_BITS bits
+        uint32_t sum = 0;
+        for (uint8_t r = 0; r < rounds; r++)
+        {
+            sum += p_samples[r * n + i];
+        }
+        port_temp_sensor_save_adc_value(p_scan->p_sensors[i], (sum >> bits) << (TEMP_SENSOR_OVERSAMPLING_BITS - bits));
+    }
+
+    // The conversions have finished: the ADC does not need its clock anymore
+    port_system_inhibit_stop(false);
+}
+
+void port_temp_sensor_set_filter(port_temp_hw_t *p_temp, thermostat_filter_t *p_filter)
+{
+    // The ISR of the DMA must not see a half-reset filter
+    uint32_t state = port_system_critical_enter();
+    if (p_filter != NULL)
+    {
+        thermostat_filter_reset(p_filter);
+    }
+    p_temp->p_filter = p_filter;
+    port_system_critical_exit(state);
+}
+
+void port_temp_sensor_set_external_trigger(port_temp_hw_t *p_temp, bool enable)
 {
-    return p_temp->temperature_celsius;
+    port_system_adc_set_external_trigger(p_temp->p_adc, enable ? TEMP_SENSOR_THERMOSTAT_ADC_TRIGGER : ADC_EXTERNAL_TRIGGER_SOFTWARE);
 }
 
-void port_temp_sensor_save_adc_value(port_temp_hw_t *p_temp, double adc_value)
+void port_temp_sensor_start_measurement(port_temp_hw_t *p_temp)
 {
-    // Convert the ADC value to temperature in Celsius.
-    // LM35 sensor has a linear response of 10mV/°C
-    p_temp->temperature_celsius = _adc_to_mvolts(adc_value, 12) / 10.0;
+    // Only the ISR of the DMA allows the STOP mode again, and it does not run while the watchdog is armed
+    if (!temp_sensor_scan.watched)
+    {
+        port_system_inhibit_stop(true);
+    }
+    port_system_adc_start_scan(p_temp->p_adc);
+}
+
+void port_temp_sensor_watch(port_temp_hw_t *p_temp, uint32_t low_counts, uint32_t high_counts)
+{
+    // The DMA interrupts are shared by all the sensors of the scan
+    if ((temp_sensor_scan.n_sensors != 1) || (temp_sensor_scan.p_sensors[0] != p_temp))
+    {
+        return;
+    }
+
+    // The watchdog compares single conversions of 12 bits: a conversion c is below the low limit if c << n < low, and above the high limit if c << n > high
+    uint32_t low = (low_counts + (1U << TEMP_SENSOR_OVERSAMPLING_BITS) - 1U) >> TEMP_SENSOR_OVERSAMPLING_BITS;
+    uint32_t high = high_counts >> TEMP_SENSOR_OVERSAMPLING_BITS;
+
+    port_system_adc_dma_set_interrupts(p_temp->p_adc, false);
+    port_system_adc_watchdog_enable(p_temp->p_adc, p_temp->adc_channel, low, high);
+
+    // The end of a measurement in progress is not notified anymore
+    temp_sensor_scan.watched = true;
+    port_system_inhibit_stop(false);
+}
+
+void port_temp_sensor_unwatch(port_temp_hw_t *p_temp)
+{
+    temp_sensor_scan.watched = false;
+    port_system_adc_watchdog_disable(p_temp->p_adc);
+    port_system_adc_dma_set_interrupts(p_temp->p_adc, true);
+}
 
-    // There are few problems to print double values using printf with SWO. The value is multiplied by 10 and printed as an integer the decimal point is added manually.
-    printf("Temperature: %ld.%d oC\n", (uint32_t)(p_temp->temperature_celsius), (uint8_t)((10*p_temp->temperature_celsius))%10);
+void port_temp_sensor_watchdog_triggered(port_temp_hw_t *p_temp)
+{
+    // Only one interrupt: the next measurement is taken by the DMA, and the thermostat arms the watchdog again after evaluating it
+    port_temp_sensor_unwatch(p_temp);
+}
+
+/**
+ * @brief Configures the ADC of a scan with the sequence of all its sensors: the channels are interleaved, and each one is converted as many times as the `ADC_DMA_MAX_CONVERSIONS` slots of the sequence allow, up to `TEMP_SENSOR_OVERSAMPLING`.
+ *
+ * @param p_scan Pointer to the scan.
+ */
+static void _scan_config(port_temp_scan_t *p_scan)
+{
+    uint8_t n = p_scan->n_sensors;
+    if (n == 0)
+    {
+        port_system_adc_disable(p_scan->p_adc);
+        return;
+    }
+
+    // The largest oversampling that fits
+    uint8_t bits = TEMP_SENSOR_OVERSAMPLING_BITS;
+    while ((bits > 0) && (((uint32_t)n << (2U * bits)) > ADC_DMA_MAX_CONVERSIONS))
+    {
+        bits--;
+    }
+    p_scan->oversampling_bits = bits;
+    p_scan->n_conversions = (uint8_t)(n << (2U * bits));
+
+    uint8_t channels[ADC_DMA_MAX_CONVERSIONS];
+    for (uint8_t k = 0; k < p_scan->n_conversions; k++)
+    {
+        channels[k] = (uint8_t)p_scan->p_sensors[k % n]->adc_channel;
+    }
+
+    // Initialize the ADC with 12-bit resolution. Each trigger converts the whole sequence, which the DMA moves to the circular buffer
+    port_system_adc_dma_scan_init(p_scan->p_adc, channels, p_scan->n_conversions, ADC_RESOLUTION_12B, p_scan->adc_buffer);
+
+    // The sequence is started by the trigger output of the measurement timer
+    port_temp_sensor_set_external_trigger(p_scan->p_sensors[0], true);
+
+    // Enable the interrupt of the DMA: only one interrupt per sequence, whatever the number of sensors
+    port_system_adc_dma_interrupt_enable(p_scan->p_adc, 1, 0);
+    p_scan->watched = false;
+
+    // Enable the ADC global interrupt, which is only used by the analog watchdog
+    port_system_adc_interrupt_enable(1, 0);
+
+    // Power up the ADC without waiting: the first trigger comes one period of the measurement timer later, long after the ADC has stabilized
+    port_system_adc_power_up_start(p_scan->p_adc);
 }
 
 void port_temp_sensor_init(port_temp_hw_t *p_temp)
 {
+    port_temp_scan_t *p_scan = &temp_sensor_scan;
+    if (p_temp->p_adc != p_scan->p_adc)
+    {
+        return;
+    }
+
     // Initialize the GPIO
     port_system_gpio_config(p_temp->p_port, p_temp->pin, GPIO_MODE_ANALOG, GPIO_PUPDR_NOPULL);
 
-    // Initialize the ADC with 12-bit resolution and EOC interrupt enable
-    port_system_adc_single_ch_init(p_temp->p_adc, p_temp->adc_channel, ADC_RESOLUTION_12B | ADC_EOC_INTERRUPT_ENABLE);
+    // Add the sensor to the scan, once
+    uint8_t slot = 0;
+    while ((slot < p_scan->n_sensors) && (p_scan->p_sensors[slot] != p_temp))
+    {
+        slot++;
+    }
+    if (slot == p_scan->n_sensors)
+    {
+        if (p_scan->n_sensors == TEMP_SENSOR_SCAN_MAX_SENSORS)
+        {
+            return;
+        }
+        p_scan->p_sensors[p_scan->n_sensors++] = p_temp;
+    }
+    p_temp->scan_slot = slot;
 
-    // Enable the ADC global interrupt
-    port_system_adc_interrupt_enable(1, 0);
+    _scan_config(p_scan);
+}
 
-    // Enable the ADC
-    port_system_adc_enable(p_temp->p_adc);
-}
\ No newline at end of file
+void port_temp_sensor_deinit(port_temp_hw_t *p_temp)
+{
+    port_temp_scan_t *p_scan = &temp_sensor_scan;
+    uint8_t slot = 0;
+    while ((slot < p_scan->n_sensors) && (p_scan->p_sensors[slot] != p_temp))
+    {
+        slot++;
+    }
+    if (slot == p_scan->n_sensors)
+    {
+        return;
+    }
+
+    // Keep the order of the remaining sensors
+    p_scan->n_sensors--;
+    for (uint8_t i = slot; i < p_scan->n_sensors; i++)
+    {
+        p_scan->p_sensors[i] = p_scan->p_sensors[i + 1U];
+        p_scan->p_sensors[i]->scan_slot = i;
+    }
+    _scan_config(p_scan);
+}
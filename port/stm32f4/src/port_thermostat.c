@@ -10,13 +10,33 @@
 
 /* Standard C includes */
 #include <stdlib.h>
-#include <math.h>
 
 /* Project includes */
 #include "port_thermostat.h"
 
+/* Defines -------------------------------------------------------------------*/
+#define THERMOSTAT_DEFAULT_TICKS TIMER_TICKS_MS(THERMOSTAT_DEFAULT_PERIOD_MS)                                      /*!< Default period of the measurement timer in ticks of its clock */
+#define THERMOSTAT_DEFAULT_PSC TIMER_PSC(THERMOSTAT_DEFAULT_TICKS, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX) /*!< Prescaler of the default period. It is computed at compile time */
+#define THERMOSTAT_DEFAULT_ARR TIMER_ARR(THERMOSTAT_DEFAULT_TICKS, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX) /*!< Auto-reload value of the default period. It is computed at compile time */
+
+_Static_assert(THERMOSTAT_DEFAULT_ARR <= THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX, "The default period does not fit in the measurement timer");
+_Static_assert(TIMER_PERIOD_TICKS(THERMOSTAT_DEFAULT_PSC, THERMOSTAT_DEFAULT_ARR) == THERMOSTAT_DEFAULT_TICKS, "The default period is not exact with the measurement timer");
+
 /* Private functions ---------------------------------------------------------*/
-void port_thermostat_timer_setup(fsm_thermostat_t *p_thermostat)
+/**
+ * @brief Loads the prescaler and the auto-reload value of the measurement timer.
+ *
+ * @param psc Prescaler
+ * @param arr Auto-reload value
+ */
+static void _timer_load(uint32_t psc, uint32_t arr)
+{
+    THERMOSTAT_MEASUREMENT_TIMER->ARR = arr;
+    THERMOSTAT_MEASUREMENT_TIMER->PSC = psc;
+}
+
+/* Public functions ----------------------------------------------------------*/
+void port_thermostat_timer_setup(fsm_thermostat_t *p_thermostat, uint32_t period_ms)
 {
 
     if (THERMOSTAT_MEASUREMENT_TIMER == TIM2)
@@ -34,40 +54,58 @@ void port_thermostat_timer_setup(fsm_thermostat_t *p_thermostat)
     // Reset the values of the timer
     THERMOSTAT_MEASUREMENT_TIMER->CNT = 0;
 
-    // Set the timeout value
-    // Compute ARR and PSC to match the duration. Check if the duration is too long and adapt prescaler and ARR
-    double sec = (double)p_thermostat->timer_period_sec;
-    double scc = (double)SystemCoreClock;
-    double psc = round(((scc * sec) / (65535.0 + 1.0)) - 1.0);
-    double arr = round(((scc * sec) / (psc + 1.0)) - 1.0);
-
-    // Adjust psc and arr if necessary
-    if (arr > 0xFFFF)
+    // Set the timeout value. The values of the default period are constants, so there is no arithmetic at startup
+    if (period_ms == THERMOSTAT_DEFAULT_PERIOD_MS)
+    {
+        _timer_load(THERMOSTAT_DEFAULT_PSC, THERMOSTAT_DEFAULT_ARR);
+    }
+    else
     {
-        psc += 1.0;
-        arr = round((scc * sec) / (psc + 1.0) - 1.0);
+        port_thermostat_timer_set_period(p_thermostat, period_ms, false);
     }
 
-    // Load the values
-    THERMOSTAT_MEASUREMENT_TIMER->ARR = (uint32_t)(round(arr));
-    THERMOSTAT_MEASUREMENT_TIMER->PSC = (uint32_t)(round(psc));
+    // Master mode "update": the update event is the trigger output (TRGO), which starts the conversions of the ADC in hardware
+    THERMOSTAT_MEASUREMENT_TIMER->CR2 &= ~TIM_CR2_MMS;
+    THERMOSTAT_MEASUREMENT_TIMER->CR2 |= TIM_CR2_MMS_1;
 
-    // Clean interrupt flags
+    // Clean interrupt flags. The update interrupt is not used: there is no ISR in the path of the samples
     THERMOSTAT_MEASUREMENT_TIMER->SR &= ~TIM_SR_UIF;
-
-    // Enable the update interrupt
-    THERMOSTAT_MEASUREMENT_TIMER->DIER |= TIM_DIER_UIE;
-
-    if (THERMOSTAT_MEASUREMENT_TIMER == TIM2)
-    {
-        // Enable the interrupt in the NVIC
-        NVIC_SetPriority(TIM2_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 2, 0));
-        NVIC_EnableIRQ(TIM2_IRQn);
-    }
+    THERMOSTAT_MEASUREMENT_TIMER->DIER &= ~TIM_DIER_UIE;
 
     THERMOSTAT_MEASUREMENT_TIMER->EGR |= TIM_EGR_UG; // 6) Update generation: Re-inicializa el contador y actualiza los registros. IMPORTANTE que esté lo último
 
 
     // Enable the timer
     THERMOSTAT_MEASUREMENT_TIMER->CR1 |= TIM_CR1_CEN;
-}
\ No newline at end of file
+}
+
+void port_thermostat_timer_set_period(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool low_power)
+{
+    if (low_power)
+    {
+        port_system_rtc_wakeup_start(period_ms);
+        return;
+    }
+
+    // Integer arithmetic only. ARR and PSC are preloaded: the new period starts at the next update event, and the current one is not cut
+    uint64_t ticks = TIMER_TICKS_MS(period_ms);
+    _timer_load(TIMER_PSC(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX), TIMER_ARR(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX));
+}
+
+void port_thermostat_set_low_power(fsm_thermostat_t *p_thermostat, uint32_t period_ms, bool enable)
+{
+    if (enable)
+    {
+        // The timers are stopped in STOP mode: the RTC wakes up the core and its ISR starts the measurement
+        THERMOSTAT_MEASUREMENT_TIMER->CR1 &= ~TIM_CR1_CEN;
+        port_temp_sensor_set_external_trigger(p_thermostat->p_temp_sensor, false);
+        port_system_rtc_wakeup_start(period_ms);
+    }
+    else
+    {
+        port_system_rtc_wakeup_stop();
+        port_temp_sensor_set_external_trigger(p_thermostat->p_temp_sensor, true);
+        port_thermostat_timer_setup(p_thermostat, period_ms);
+    }
+    port_system_set_stop_mode(enable);
+}
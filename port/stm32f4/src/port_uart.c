@@ -0,0 +1,157 @@
+/**
+ * @file port_uart.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Port layer for the UART: USART2 with DMA reception into a circular buffer and DMA transmission.
+ * @version 0.1
+ * @date 2024-05-01
+ *
+ */
+
+/* HW dependent includes */
+#include "port_uart.h"
+#include "port_system.h"
+#include "stm32f4xx.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define PORT_UART USART2                    /*!< USART of the virtual COM port of the ST-LINK */
+#define PORT_UART_IRQN USART2_IRQn          /*!< Interrupt of the USART */
+#define PORT_UART_PCLK_HZ 16000000U         /*!< Clock of the USART (APB1): `system_clock_config()` runs from the HSI (16 MHz) with the APB1 prescaler set to 1 */
+#define PORT_UART_DMA_CHANNEL 4U            /*!< Channel of DMA1 of the requests of USART2 */
+#define PORT_UART_RX_STREAM DMA1_Stream5    /*!< Stream of DMA1 of the reception (USART2_RX) */
+#define PORT_UART_TX_STREAM DMA1_Stream6    /*!< Stream of DMA1 of the transmission (USART2_TX) */
+#define PORT_UART_TX_IRQN DMA1_Stream6_IRQn /*!< Interrupt of the stream of the transmission */
+#define PORT_UART_RX_FLAGS (DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5 | DMA_HIFCR_CFEIF5) /*!< Flags of stream 5 in HIFCR */
+#define PORT_UART_TX_FLAGS (DMA_HIFCR_CTCIF6 | DMA_HIFCR_CHTIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6) /*!< Flags of stream 6 in HIFCR */
+
+_Static_assert((PORT_UART_RX_SIZE & (PORT_UART_RX_SIZE - 1)) == 0, "The size of the circular buffer must be a power of 2");
+_Static_assert(PORT_UART_RX_SIZE <= 0xFFFFU, "The circular buffer must fit in NDTR");
+
+/* Global variables -----------------------------------------------------------*/
+static volatile uint8_t rx_buffer[PORT_UART_RX_SIZE]; /*!< Circular buffer written by the DMA */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Disables a DMA stream and waits until it can be configured.
+ *
+ * @param p_stream DMA stream.
+ */
+static void _stream_disable(DMA_Stream_TypeDef *p_stream)
+{
+    p_stream->CR &= ~DMA_SxCR_EN;
+    while (p_stream->CR & DMA_SxCR_EN)
+        ;
+}
+
+/* Function definitions ------------------------------------------------------*/
+void port_uart_init(void)
+{
+    // The RX line idles high: pull-up while the ST-LINK is not connected
+    static const port_system_gpio_pin_t pins[] = {
+        PORT_SYSTEM_GPIO_PIN(PORT_UART_GPIO, PORT_UART_TX_PIN, GPIO_MODE_ALTERNATE, GPIO_PUPDR_NOPULL),
+        PORT_SYSTEM_GPIO_PIN(PORT_UART_GPIO, PORT_UART_RX_PIN, GPIO_MODE_ALTERNATE, GPIO_PUPDR_PUP),
+    };
+
+    for (uint8_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+    {
+        port_system_gpio_config_pin(&pins[i]);
+        port_system_gpio_config_alternate(pins[i].p_port, pins[i].pin, PORT_UART_ALTERNATE);
+    }
+
+    //-------------------------------------------------------------------------------------------
+    // 	USART: 8N1, oversampling by 16, DMA requests for both directions
+    //-------------------------------------------------------------------------------------------
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN; /* USART2_CLK_ENABLE */
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;   /* DMA1_CLK_ENABLE */
+
+    PORT_UART->CR1 = 0;
+    PORT_UART->CR2 = 0;
+    PORT_UART->CR3 = USART_CR3_DMAR | USART_CR3_DMAT;
+    PORT_UART->BRR = (PORT_UART_PCLK_HZ + PORT_UART_BAUDRATE / 2U) / PORT_UART_BAUDRATE; // USARTDIV in 12.4 fixed point, rounded
+
+    //-------------------------------------------------------------------------------------------
+    // 	Reception: circular buffer that the DMA never stops filling
+    //-------------------------------------------------------------------------------------------
+    _stream_disable(PORT_UART_RX_STREAM);
+    DMA1->HIFCR = PORT_UART_RX_FLAGS;
+    PORT_UART_RX_STREAM->PAR = (uint32_t)(uintptr_t)&PORT_UART->DR;
+    PORT_UART_RX_STREAM->M0AR = (uint32_t)(uintptr_t)rx_buffer;
+    PORT_UART_RX_STREAM->NDTR = PORT_UART_RX_SIZE;
+
+    // Peripheral-to-memory (DIR = 00), 8-bit transfers, memory increment and circular mode. No interrupts: the USART signals the end of each burst
+    PORT_UART_RX_STREAM->CR = (PORT_UART_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_MINC | DMA_SxCR_CIRC;
+    PORT_UART_RX_STREAM->FCR = 0; // Direct mode (no FIFO)
+    PORT_UART_RX_STREAM->CR |= DMA_SxCR_EN;
+
+    //-------------------------------------------------------------------------------------------
+    // 	Transmission: one transfer per buffer, with an interrupt at the end
+    //-------------------------------------------------------------------------------------------
+    _stream_disable(PORT_UART_TX_STREAM);
+    DMA1->HIFCR = PORT_UART_TX_FLAGS;
+    PORT_UART_TX_STREAM->PAR = (uint32_t)(uintptr_t)&PORT_UART->DR;
+
+    // Memory-to-peripheral (DIR = 01), 8-bit transfers, memory increment and transfer complete interrupt
+    PORT_UART_TX_STREAM->CR = (PORT_UART_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE;
+    PORT_UART_TX_STREAM->FCR = 0; // Direct mode (no FIFO)
+
+    // Enable the USART with the idle line interrupt: one interrupt per burst of received bytes
+    PORT_UART->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE | USART_CR1_IDLEIE;
+
+    NVIC_SetPriority(PORT_UART_IRQN, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PORT_UART_IRQ_PRIORITY, 0));
+    NVIC_EnableIRQ(PORT_UART_IRQN);
+    NVIC_SetPriority(PORT_UART_TX_IRQN, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PORT_UART_IRQ_PRIORITY, 0));
+    NVIC_EnableIRQ(PORT_UART_TX_IRQN);
+}
+
+const volatile uint8_t *port_uart_get_rx_buffer(void)
+{
+    return rx_buffer;
+}
+
+uint32_t port_uart_get_rx_head(void)
+{
+    // NDTR counts down from the size of the buffer and reloads at 0
+    return (PORT_UART_RX_SIZE - PORT_UART_RX_STREAM->NDTR) & (PORT_UART_RX_SIZE - 1U);
+}
+
+bool port_uart_send(const uint8_t *p_data, uint32_t length)
+{
+    if (port_uart_tx_busy() || (length == 0) || (length > 0xFFFFU))
+    {
+        return false;
+    }
+
+    // The stream is disabled by the hardware at the end of the previous transfer
+    DMA1->HIFCR = PORT_UART_TX_FLAGS;
+    PORT_UART_TX_STREAM->M0AR = (uint32_t)(uintptr_t)p_data;
+    PORT_UART_TX_STREAM->NDTR = length;
+    PORT_UART->SR &= ~USART_SR_TC;
+    PORT_UART_TX_STREAM->CR |= DMA_SxCR_EN;
+    return true;
+}
+
+bool port_uart_tx_busy(void)
+{
+    return (PORT_UART_TX_STREAM->CR & DMA_SxCR_EN) != 0;
+}
+
+bool port_uart_get_and_clear_rx_idle(void)
+{
+    if (!(PORT_UART->SR & USART_SR_IDLE))
+    {
+        return false;
+    }
+
+    // IDLE is cleared by a read of SR followed by a read of DR. The received bytes are already in the buffer: the DMA has read DR
+    (void)PORT_UART->DR;
+    return true;
+}
+
+bool port_uart_get_and_clear_tx_complete(void)
+{
+    if (!(DMA1->HISR & DMA_HISR_TCIF6))
+    {
+        return false;
+    }
+    DMA1->HIFCR = DMA_HIFCR_CTCIF6;
+    return true;
+}
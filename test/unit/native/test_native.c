@@ -0,0 +1,814 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "port_system.h"
+#include "port_led.h"
+#include "port_temp_sensor.h"
+#include "port_thermostat.h"
+#include "fsm_thermostat.h"
+#include "thermostat_trace.h"
+
+#define SIM_DAY_US (24ULL * 3600ULL * 1000000ULL) /*!< One day of virtual time */
+#define SIM_CYCLE_US (2ULL * 3600ULL * 1000000ULL) /*!< Period of the simulated room temperature */
+#define HISTORY_TEST_MAX_BYTES_PER_EVENT 2 /*!< Events 5 s apart take 2 bytes of history */
+
+static uint32_t event_log[4];
+static uint8_t event_count;
+
+/**
+ * @brief Room temperature that sweeps linearly between 20 and 30 ºC and back every 2 hours. LM35: 10 mV/ºC.
+ */
+static uint32_t _triangle_source(uint8_t channel, uint64_t now_us)
+{
+    uint64_t phase = now_us % SIM_CYCLE_US;
+    uint64_t half = SIM_CYCLE_US / 2;
+    uint64_t tenths = (phase < half) ? (phase * 100U) / half : ((SIM_CYCLE_US - phase) * 100U) / half; // 0..100 tenths of ºC above 20 ºC
+    uint32_t mvolts = 200U + (uint32_t)tenths;
+    return (mvolts * 4095U) / ADC_VREF_MV;
+}
+
+/**
+ * @brief Noisy analog input: consecutive conversions alternate between 1000 and 1001 counts, i.e., 1000.5 counts on average.
+ */
+static uint32_t _noisy_source(uint8_t channel, uint64_t now_us)
+{
+    return 1000U + (uint32_t)((now_us / PORT_SYSTEM_SIM_ADC_CONVERSION_US) % 2U);
+}
+
+/**
+ * @brief Room at 20 ºC with a spike of interference to 35 ºC every 7 seconds, e.g., a relay switching next to the sensor.
+ */
+static uint32_t _spiky_source(uint8_t channel, uint64_t now_us)
+{
+    uint32_t mvolts = (((now_us / 1000000U) % 7U) == 3U) ? 350U : 200U;
+    return (mvolts * 4095U) / ADC_VREF_MV;
+}
+
+/**
+ * @brief Two rooms: 20 ºC on channel 0 and 30 ºC on channel 1.
+ */
+static uint32_t _two_rooms_source(uint8_t channel, uint64_t now_us)
+{
+    uint32_t mvolts = (channel == 0) ? 200U : 300U;
+    return (mvolts * 4095U) / ADC_VREF_MV;
+}
+
+static uint32_t swing_mvolts; /*!< Amplitude of `_swinging_source()` in mV */
+
+/**
+ * @brief Temperature that swings around the default threshold (25 ºC) every second by `swing_mvolts` mV, e.g., the noise of the sensor.
+ */
+static uint32_t _swinging_source(uint8_t channel, uint64_t now_us)
+{
+    uint32_t mvolts = ((now_us / 1000000U) % 2U) ? 250U + swing_mvolts : 250U - swing_mvolts;
+    return (mvolts * 4095U) / ADC_VREF_MV;
+}
+
+/**
+ * @brief Starts TIM2 as the measurement timer does: the update event every second is the trigger output of the ADC.
+ */
+static void _start_measurement_timer(void)
+{
+    TIM2->CR2 = TIM_CR2_MMS_1;
+    port_system_sim_timer_start(TIM2, 1000000, NULL);
+}
+
+static void _log_event(void *p_arg)
+{
+    event_log[event_count++] = (uint32_t)(uintptr_t)p_arg;
+}
+
+void setUp(void)
+{
+    port_system_init();
+    event_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_virtual_clock_jumps_to_next_event(void)
+{
+    port_system_sim_schedule(5000, 0, _log_event, (void *)2);
+    port_system_sim_schedule(1000, 0, _log_event, (void *)1);
+    port_system_sim_schedule(5000, 0, _log_event, (void *)3);
+
+    TEST_ASSERT_TRUE(port_system_sim_step());
+    TEST_ASSERT_EQUAL_UINT64(1000, port_system_sim_get_time_us());
+    TEST_ASSERT_TRUE(port_system_sim_step());
+    TEST_ASSERT_TRUE(port_system_sim_step());
+    TEST_ASSERT_EQUAL_UINT64(5000, port_system_sim_get_time_us());
+    TEST_ASSERT_FALSE(port_system_sim_step());
+
+    // Simultaneous events run in the order they were scheduled
+    TEST_ASSERT_EQUAL(3, event_count);
+    TEST_ASSERT_EQUAL(1, event_log[0]);
+    TEST_ASSERT_EQUAL(2, event_log[1]);
+    TEST_ASSERT_EQUAL(3, event_log[2]);
+}
+
+void test_virtual_clock_periodic_and_delay(void)
+{
+    int8_t id = port_system_sim_schedule(1000000, 1000000, _log_event, (void *)7);
+    port_system_delay_ms(3500);
+    TEST_ASSERT_EQUAL(3, event_count);
+    TEST_ASSERT_EQUAL(3500, port_system_get_millis());
+
+    port_system_sim_cancel(id);
+    port_system_delay_ms(10000);
+    TEST_ASSERT_EQUAL(3, event_count);
+}
+
+void test_wait_for_events_sleeps_until_a_sample(void)
+{
+    port_temp_sensor_init(&temp_sensor_thermostat);
+    _start_measurement_timer();
+
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_SAMPLE, port_system_wait_for_events());
+    TEST_ASSERT_EQUAL(1000, port_system_get_millis());
+    TEST_ASSERT_EQUAL(seq + 1, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+}
+
+void test_wakeup_only_at_the_scheduled_time(void)
+{
+    // Nothing else is scheduled: the main loop wakes up once, at the compare match, and not every millisecond
+    port_system_set_wakeup_us(2500000);
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_TIMEOUT, port_system_wait_for_events());
+    TEST_ASSERT_EQUAL_UINT64(2500000, port_system_get_time_us());
+    TEST_ASSERT_FALSE(port_system_sim_step());
+
+    // A cancelled wake-up does not post the event
+    port_system_set_wakeup_us(3000000);
+    port_system_cancel_wakeup();
+    TEST_ASSERT_FALSE(port_system_sim_step());
+
+    // A time in the past posts it immediately
+    port_system_set_wakeup_us(1000000);
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_TIMEOUT, port_system_wait_for_events());
+
+    // Nothing can wake up the system: the simulation ends without ending the process, and without counting a sleep that never happened
+    port_system_power_stats_t before, after;
+    port_system_set_stop_mode(true);
+    port_system_get_power_stats(&before);
+    TEST_ASSERT_EQUAL(0, port_system_wait_for_events());
+    port_system_get_power_stats(&after);
+    port_system_set_stop_mode(false);
+    TEST_ASSERT_EQUAL_UINT64(2500000, port_system_get_time_us());
+    TEST_ASSERT_EQUAL(before.sleeps, after.sleeps);
+    TEST_ASSERT_EQUAL(before.stops, after.stops);
+}
+
+void test_time_is_monotonic_when_the_millis_wrap_around(void)
+{
+    port_system_set_millis(UINT32_MAX - 499U);
+    uint64_t start_us = port_system_get_time_us();
+
+    // The reference is before the wrap around of the milliseconds and the deadline after it
+    uint32_t t = port_system_get_millis();
+    port_system_delay_until_ms(&t, 1000);
+    TEST_ASSERT_EQUAL(500, port_system_get_millis());
+    TEST_ASSERT_EQUAL(500, t);
+    TEST_ASSERT_EQUAL_UINT64(start_us + 1000000U, port_system_get_time_us());
+
+    // A deadline that has already passed does not wait
+    t = UINT32_MAX - 100U;
+    port_system_delay_until_ms(&t, 10);
+    TEST_ASSERT_EQUAL_UINT64(start_us + 1000000U, port_system_get_time_us());
+}
+
+void test_adc_conversion_is_simulated(void)
+{
+    port_system_sim_adc_set_source(ADC1, _triangle_source);
+    port_temp_sensor_init(&temp_sensor_thermostat);
+
+    port_system_set_millis(30 * 60 * 1000); // 25 ºC in the triangle
+    port_system_adc_start_conversion(ADC1, 0);
+    TEST_ASSERT_TRUE(port_system_sim_step());
+    TEST_ASSERT_INT_WITHIN(100, 25000, port_temp_sensor_get_temperature_mcelsius(&temp_sensor_thermostat));
+}
+
+void test_adc_is_triggered_by_the_timer(void)
+{
+    port_temp_sensor_init(&temp_sensor_thermostat);
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+
+    // Without trigger output, the update event does not start any conversion
+    port_system_sim_timer_start(TIM2, 1000000, NULL);
+    port_system_delay_ms(3500);
+    TEST_ASSERT_EQUAL(seq, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+
+    // With trigger output, each update event starts a sequence of conversions at the exact instant of the update
+    _start_measurement_timer();
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_SAMPLE, port_system_wait_for_events());
+    TEST_ASSERT_EQUAL_UINT64(4500000 + TEMP_SENSOR_OVERSAMPLING * PORT_SYSTEM_SIM_ADC_CONVERSION_US, port_system_sim_get_time_us());
+    TEST_ASSERT_EQUAL(seq + 1, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    port_system_sim_timer_stop(TIM2);
+}
+
+void test_adc_dma_oversamples_each_period(void)
+{
+    port_system_sim_adc_set_source(ADC1, _noisy_source);
+    port_temp_sensor_init(&temp_sensor_thermostat);
+    _start_measurement_timer();
+
+    // One interrupt per period, alternating between the halves of the DMA buffer
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_delay_ms(2500);
+    TEST_ASSERT_EQUAL(seq + 2, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    TEST_ASSERT_NOT_EQUAL(0, temp_sensor_scan.adc_buffer[TEMP_SENSOR_OVERSAMPLING]);
+
+    // The decimated measurement keeps the half count that a single conversion loses: 16008 >> 2 = 4002 counts of 14 bits
+    TEST_ASSERT_EQUAL(16U, TEMP_SENSOR_OVERSAMPLING);
+    TEST_ASSERT_EQUAL(4002, port_temp_sensor_get_adc_counts(&temp_sensor_thermostat));
+    TEST_ASSERT_EQUAL((ADC_VREF_MV * 100 * 4002 + 16383 / 2) / 16383, port_temp_sensor_get_temperature_mcelsius(&temp_sensor_thermostat));
+    port_system_sim_timer_stop(TIM2);
+}
+
+void test_adc_power_up_does_not_block(void)
+{
+    // The cycle counter and the microsecond delay run the virtual clock exactly
+    uint32_t cycles = port_system_get_cycles();
+    port_system_delay_us(10);
+    TEST_ASSERT_EQUAL_UINT64(10, port_system_sim_get_time_us());
+    TEST_ASSERT_EQUAL(cycles + 10U * (PORT_SYSTEM_CORE_CLOCK_HZ / 1000000U), port_system_get_cycles());
+
+    // The ADC ignores the conversions until it has stabilized
+    port_system_adc_power_up_start(ADC1);
+    TEST_ASSERT_FALSE(port_system_adc_power_up_ready(ADC1));
+    port_system_adc_start_conversion(ADC1, 0);
+    TEST_ASSERT_FALSE(port_system_sim_step());
+
+    port_system_delay_us(ADC_STABILIZATION_US - 1U);
+    TEST_ASSERT_FALSE(port_system_adc_power_up_ready(ADC1));
+    port_system_delay_us(1);
+    TEST_ASSERT_TRUE(port_system_adc_power_up_ready(ADC1));
+    port_system_adc_start_conversion(ADC1, 0);
+    TEST_ASSERT_TRUE(port_system_sim_step());
+
+    // The blocking version waits exactly the stabilization time
+    port_system_adc_disable(ADC1);
+    uint64_t start_us = port_system_sim_get_time_us();
+    port_system_adc_enable(ADC1);
+    TEST_ASSERT_EQUAL_UINT64(start_us + ADC_STABILIZATION_US, port_system_sim_get_time_us());
+    TEST_ASSERT_TRUE(port_system_adc_power_up_ready(ADC1));
+}
+
+void test_timer_prescaler_and_reload(void)
+{
+    // 16-bit counter: the smallest prescaler that fits 1 s, and the nearest reload value (1.9 us of error)
+    TEST_ASSERT_EQUAL(244, TIMER_PSC(TIMER_TICKS_MS(1000), 0xFFFF));
+    TEST_ASSERT_EQUAL(65305, TIMER_ARR(TIMER_TICKS_MS(1000), 0xFFFF));
+
+    // 32-bit counter: every period in milliseconds or microseconds is exact
+    const uint32_t periods_us[] = {1, 250, 100000, 1000000, 60000000};
+    for (uint8_t i = 0; i < sizeof(periods_us) / sizeof(periods_us[0]); i++)
+    {
+        uint64_t ticks = TIMER_TICKS_US(periods_us[i]);
+        TEST_ASSERT_EQUAL(ticks, TIMER_PERIOD_TICKS(TIMER_PSC(ticks, 0xFFFFFFFFU), TIMER_ARR(ticks, 0xFFFFFFFFU)));
+    }
+}
+
+void test_thermostat_period_in_milliseconds(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    TEST_ASSERT_EQUAL(THERMOSTAT_DEFAULT_PERIOD_MS, fsm_thermostat_get_period(p_fsm));
+    TEST_ASSERT_EQUAL(0, TIM2->PSC);
+    TEST_ASSERT_EQUAL(TIMER_TICKS_MS(THERMOSTAT_DEFAULT_PERIOD_MS) - 1U, TIM2->ARR);
+
+    // Sub-second control loop: 4 samples per second. The last sample is saved once its conversions end
+    TEST_ASSERT_TRUE(fsm_thermostat_set_period(p_fsm, 250));
+    TEST_ASSERT_EQUAL(250, fsm_thermostat_get_period(p_fsm));
+
+    // Out of range: the prescaler and the auto-reload value would wrap around, so the period is kept
+    TEST_ASSERT_FALSE(fsm_thermostat_set_period(p_fsm, 0));
+    TEST_ASSERT_EQUAL(250, fsm_thermostat_get_period(p_fsm));
+    TEST_ASSERT_LESS_OR_EQUAL(THERMOSTAT_MEASUREMENT_TIMER_PSC_MAX, TIMER_PSC(TIMER_TICKS_MS(THERMOSTAT_PERIOD_MAX_MS), THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX));
+    if (THERMOSTAT_PERIOD_MAX_MS < UINT32_MAX)
+    {
+        TEST_ASSERT_FALSE(fsm_thermostat_set_period(p_fsm, THERMOSTAT_PERIOD_MAX_MS + 1U));
+    }
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_delay_ms(10000 + 1);
+    TEST_ASSERT_EQUAL(seq + 40, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_low_power_samples_with_the_rtc(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_set_low_power(p_fsm, true);
+    TEST_ASSERT_EQUAL(0, ADC1->CR2 & ADC_CR2_EXTEN);
+
+    // One measurement per period of the RTC, and STOP mode between them. Only the conversions keep the core out of STOP
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_power_stats_t before, after;
+    port_system_get_power_stats(&before);
+    for (uint8_t i = 0; i < 60; i++)
+    {
+        TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_SAMPLE, port_system_wait_for_events());
+        TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+        TEST_ASSERT_TRUE(port_system_sim_stop_allowed()); // The measurement has been saved: back to STOP
+    }
+    port_system_get_power_stats(&after);
+    TEST_ASSERT_EQUAL(seq + 60, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm));
+    TEST_ASSERT_EQUAL(60, after.stops - before.stops);
+    TEST_ASSERT_TRUE((after.asleep_us - before.asleep_us) >= 60ULL * 1000000ULL - 60ULL * TEMP_SENSOR_OVERSAMPLING * PORT_SYSTEM_SIM_ADC_CONVERSION_US);
+
+    // Back to the measurement timer
+    fsm_thermostat_set_low_power(p_fsm, false);
+    TEST_ASSERT_FALSE(port_system_sim_stop_allowed());
+    seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_delay_ms(10000 + 1);
+    TEST_ASSERT_EQUAL(seq + 10, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_low_power_with_adc_watchdog_enters_stop(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_set_low_power(p_fsm, true);
+    fsm_thermostat_set_adc_watchdog(p_fsm, true);
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_SAMPLE, port_system_wait_for_events());
+    TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+
+    // The temperature stays inside the window: the RTC keeps starting measurements that are never saved, and they must not keep the core out of STOP
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_power_stats_t before, after;
+    port_system_get_power_stats(&before);
+    port_system_set_wakeup_us(port_system_sim_get_time_us() + 60000000ULL + 500000ULL);
+    TEST_ASSERT_EQUAL(PORT_SYSTEM_EVENT_TIMEOUT, port_system_wait_for_events());
+    port_system_get_power_stats(&after);
+    TEST_ASSERT_EQUAL(seq, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    TEST_ASSERT_TRUE(port_system_sim_stop_allowed());
+    TEST_ASSERT_GREATER_OR_EQUAL(60, after.stops - before.stops);
+    TEST_ASSERT_EQUAL(after.sleeps - before.sleeps, after.stops - before.stops);
+
+    fsm_thermostat_set_adc_watchdog(p_fsm, false);
+    fsm_thermostat_set_low_power(p_fsm, false);
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_threshold_is_converted_to_adc_counts(void)
+{
+    // Comparing counts is the same as comparing temperatures
+    const int32_t thresholds[] = {1000, 20000, 25000, 25001, 33333, 100000};
+    for (uint8_t i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); i++)
+    {
+        uint32_t threshold_counts = port_temp_sensor_mcelsius_to_adc_counts(&temp_sensor_thermostat, thresholds[i]);
+        for (uint32_t counts = threshold_counts - 2; counts <= threshold_counts + 2; counts++)
+        {
+            port_temp_sensor_save_adc_value(&temp_sensor_thermostat, counts);
+            uint64_t mcelsius_x_full_scale = (uint64_t)counts * ADC_VREF_MV * 100U; // Exact temperature times the full scale
+            TEST_ASSERT_EQUAL(mcelsius_x_full_scale < (uint64_t)thresholds[i] * ((1U << TEMP_SENSOR_ADC_BITS) - 1U), counts < threshold_counts);
+        }
+    }
+
+    // Out of the range of the ADC
+    TEST_ASSERT_EQUAL(0, port_temp_sensor_mcelsius_to_adc_counts(&temp_sensor_thermostat, -5000));
+    TEST_ASSERT_EQUAL(1U << TEMP_SENSOR_ADC_BITS, port_temp_sensor_mcelsius_to_adc_counts(&temp_sensor_thermostat, 400000));
+}
+
+void test_thermostat_follows_temperature_for_days(void)
+{
+    port_system_sim_adc_set_source(ADC1, _triangle_source);
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+
+    uint32_t first_sample_seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    uint32_t transitions = 0;
+    uint32_t evaluations = 0;
+    uint8_t previous_heat = port_led_get_status(&led_heater_active);
+    while (port_system_sim_get_time_us() < 3 * SIM_DAY_US)
+    {
+        port_system_sim_step();
+        evaluations += fsm_thermostat_fire(p_fsm);
+
+        uint8_t heat = port_led_get_status(&led_heater_active);
+        TEST_ASSERT_TRUE((heat != port_led_get_status(&led_comfort_temperature)) || (evaluations == 0));
+        transitions += (heat != previous_heat);
+        previous_heat = heat;
+    }
+
+    // The temperature starts below the threshold, and then crosses it twice per cycle
+    TEST_ASSERT_EQUAL(1 + 2 * (3 * SIM_DAY_US / SIM_CYCLE_US), transitions);
+
+    // The guards are only evaluated once per sample
+    TEST_ASSERT_EQUAL(port_temp_sensor_get_sample_seq(&temp_sensor_thermostat) - first_sample_seq, evaluations);
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_adc_watchdog_wakes_up_only_on_crossings(void)
+{
+    port_system_sim_adc_set_source(ADC1, _triangle_source);
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_set_adc_watchdog(p_fsm, true);
+
+    uint32_t first_sample_seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    uint32_t transitions = 0;
+    uint32_t evaluations = 0;
+    uint8_t previous_heat = port_led_get_status(&led_heater_active);
+    // The main loop only wakes up at the crossings, so it stops at the first one after 23 h, i.e., the last one of the day
+    while (port_system_sim_get_time_us() < SIM_DAY_US - SIM_CYCLE_US / 2)
+    {
+        port_system_wait_for_events();
+        evaluations += fsm_thermostat_fire(p_fsm);
+
+        uint8_t heat = port_led_get_status(&led_heater_active);
+        transitions += (heat != previous_heat);
+        previous_heat = heat;
+    }
+
+    // Same transitions as measuring every second, but the CPU is only woken up around the crossings of the threshold
+    TEST_ASSERT_EQUAL(1 + 2 * (SIM_DAY_US / SIM_CYCLE_US), transitions);
+    TEST_ASSERT_EQUAL(port_temp_sensor_get_sample_seq(&temp_sensor_thermostat) - first_sample_seq, evaluations);
+    TEST_ASSERT_TRUE(evaluations <= 2 * transitions);
+
+    // Back to a measurement per period
+    fsm_thermostat_set_adc_watchdog(p_fsm, false);
+    uint32_t seq = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    port_system_delay_ms(10000);
+    TEST_ASSERT_EQUAL(seq + 10, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    fsm_thermostat_destroy(p_fsm);
+}
+
+/**
+ * @brief Runs the thermostat for some seconds of virtual time.
+ *
+ * @return uint32_t Number of evaluations of the guards.
+ */
+static uint32_t _run_thermostat(fsm_t *p_fsm, uint32_t seconds)
+{
+    uint64_t end_us = port_system_sim_get_time_us() + seconds * 1000000ULL;
+    uint32_t evaluations = 0;
+    while (port_system_sim_get_time_us() < end_us)
+    {
+        port_system_sim_step();
+        evaluations += fsm_thermostat_fire(p_fsm);
+    }
+    return evaluations;
+}
+
+void test_thermostat_hysteresis_and_dwell_bound_the_transitions(void)
+{
+    port_system_sim_adc_set_source(ADC1, _swinging_source);
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_stats_t before, after;
+
+    // Noise of +/-0.1 ºC around the threshold: without hysteresis, the thermostat flips at every sample
+    swing_mvolts = 1;
+    fsm_thermostat_set_hysteresis(p_fsm, 0);
+    uint32_t evaluations = _run_thermostat(p_fsm, 20);
+    fsm_thermostat_get_stats(p_fsm, &after);
+    TEST_ASSERT_INT_WITHIN(1, evaluations, after.transitions);
+    TEST_ASSERT_EQUAL(0, after.suppressed_by_hysteresis);
+
+    // With a band of 0.5 ºC the state is kept, and the crossings of the threshold are counted
+    before = after;
+    fsm_thermostat_set_hysteresis(p_fsm, 500);
+    evaluations = _run_thermostat(p_fsm, 20);
+    fsm_thermostat_get_stats(p_fsm, &after);
+    TEST_ASSERT_EQUAL(before.transitions, after.transitions);
+    TEST_ASSERT_INT_WITHIN(1, evaluations / 2, after.suppressed_by_hysteresis - before.suppressed_by_hysteresis);
+
+    // Swings of +/-5 ºC cross the band at every sample: the minimum dwell times bound the transitions to one every 10 s
+    before = after;
+    swing_mvolts = 50;
+    fsm_thermostat_set_min_dwell(p_fsm, 10000, 10000);
+    evaluations = _run_thermostat(p_fsm, 100);
+    fsm_thermostat_get_stats(p_fsm, &after);
+    TEST_ASSERT_INT_WITHIN(1, 100 / 10, after.transitions - before.transitions);
+    // Every other sample is on the other side of the band, and only those that did not make a transition are suppressed
+    TEST_ASSERT_GREATER_OR_EQUAL(evaluations / 2 - (after.transitions - before.transitions), after.suppressed_by_dwell - before.suppressed_by_dwell);
+    TEST_ASSERT_EQUAL(before.suppressed_by_hysteresis, after.suppressed_by_hysteresis);
+
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_trace_replays_the_recorded_transitions(void)
+{
+    // Record two hours of the triangle (two crossings of the threshold) with a sample per minute
+    port_system_sim_adc_set_source(ADC1, _triangle_source);
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_set_period(p_fsm, 60000);
+    thermostat_trace_clear();
+    _run_thermostat(p_fsm, SIM_CYCLE_US / 1000000U + 1U);
+    fsm_thermostat_stats_t stats;
+    fsm_thermostat_get_stats(p_fsm, &stats);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, stats.transitions);
+    TEST_ASSERT_EQUAL(0, thermostat_trace_get_dropped());
+
+    // Through a file, as the host tool reads it
+    static uint8_t image[THERMOSTAT_TRACE_HEADER_BYTES + THERMOSTAT_TRACE_SIZE];
+    uint32_t length = thermostat_trace_export(image, sizeof(image));
+    TEST_ASSERT_NOT_EQUAL(0, length);
+    FILE *p_file = fopen("test_native_trace.bin", "wb");
+    TEST_ASSERT_TRUE(p_file != NULL);
+    TEST_ASSERT_EQUAL(length, fwrite(image, 1, length, p_file));
+    fclose(p_file);
+    memset(image, 0, sizeof(image));
+    p_file = fopen("test_native_trace.bin", "rb");
+    TEST_ASSERT_TRUE(p_file != NULL);
+    TEST_ASSERT_EQUAL(length, fread(image, 1, sizeof(image), p_file));
+    fclose(p_file);
+    remove("test_native_trace.bin");
+
+    // A new thermostat fed with the trace makes the same transitions, without running the virtual clock
+    uint8_t zone = ((fsm_thermostat_t *)p_fsm)->zone;
+    fsm_thermostat_destroy(p_fsm);
+    p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    uint64_t now_us = port_system_sim_get_time_us();
+    thermostat_trace_replay_result_t result;
+    TEST_ASSERT_TRUE(thermostat_trace_replay(image, length, p_fsm, zone, temp_sensor_thermostat.scan_slot, &result));
+    TEST_ASSERT_EQUAL(SIM_CYCLE_US / 60000000U, result.samples);
+    TEST_ASSERT_EQUAL(stats.transitions, result.recorded_transitions);
+    TEST_ASSERT_EQUAL(stats.transitions, result.replayed_transitions);
+    TEST_ASSERT_EQUAL(0, result.mismatches);
+    TEST_ASSERT_EQUAL(0, thermostat_trace_get_dropped());
+
+    // A corrupted image is rejected
+    image[0] ^= 0xFFU;
+    TEST_ASSERT_FALSE(thermostat_trace_replay(image, length, p_fsm, zone, temp_sensor_thermostat.scan_slot, &result));
+    fsm_thermostat_destroy(p_fsm);
+    port_system_set_millis((uint32_t)(now_us / 1000U));
+}
+
+void test_thermostat_median_filter_suppresses_spurious_transitions(void)
+{
+    port_system_sim_adc_set_source(ADC1, _spiky_source);
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_thermostat_stats_t before, after;
+
+    // Without filter, every spike switches the heating off and on again
+    fsm_thermostat_get_stats(p_fsm, &before);
+    _run_thermostat(p_fsm, 70);
+    fsm_thermostat_get_stats(p_fsm, &after);
+    TEST_ASSERT_EQUAL(1 + 2 * 10, after.transitions - before.transitions);
+
+    // A running median of 3 samples never lets a single spike through
+    static thermostat_filter_t median;
+    thermostat_filter_init_median(&median, 3);
+    port_temp_sensor_set_filter(&temp_sensor_thermostat, &median);
+    fsm_thermostat_get_stats(p_fsm, &before);
+    uint32_t evaluations = _run_thermostat(p_fsm, 70);
+    fsm_thermostat_get_stats(p_fsm, &after);
+    TEST_ASSERT_EQUAL(0, after.transitions - before.transitions);
+    TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm));
+    TEST_ASSERT_INT_WITHIN(1, 70, evaluations);
+    TEST_ASSERT_EQUAL(_spiky_source(0, 0) << TEMP_SENSOR_OVERSAMPLING_BITS, port_temp_sensor_get_adc_counts(&temp_sensor_thermostat));
+
+    port_temp_sensor_set_filter(&temp_sensor_thermostat, NULL);
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_fires_only_on_new_inputs(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+
+    // No sample yet
+    TEST_ASSERT_FALSE(fsm_thermostat_fire(p_fsm));
+    TEST_ASSERT_EQUAL(THERMOSTAT_OFF, fsm_get_state(p_fsm));
+
+    // New sample (20 ºC): evaluated once
+    port_system_sim_step();
+    port_system_sim_step();
+    TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+    TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm));
+    TEST_ASSERT_FALSE(fsm_thermostat_fire(p_fsm));
+
+    // A new threshold is an input of the guards too
+    fsm_thermostat_set_threshold(p_fsm, 15000);
+    TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+    TEST_ASSERT_EQUAL(THERMOSTAT_OFF, fsm_get_state(p_fsm));
+    TEST_ASSERT_FALSE(fsm_thermostat_fire(p_fsm));
+
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_leds_switch_in_one_bsrr_write(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+
+    // The descriptors of the LEDs carry the clock of their port
+    TEST_ASSERT_EQUAL(RCC_AHB1ENR_GPIOBEN, RCC->AHB1ENR & RCC_AHB1ENR_GPIOBEN);
+    TEST_ASSERT_EQUAL(GPIO_MODE_OUT, (GPIOB->MODER >> (LED_HEAT_PIN * 2U)) & 0x03U);
+
+    // Another pin of the port must not be touched by the LEDs of the thermostat
+    port_led_init(&led_on);
+    port_led_on(&led_on);
+
+    // Activation: both LEDs of the port change in a single write
+    uint32_t writes = GPIOB->sim_bsrr_writes;
+    port_system_sim_step();
+    port_system_sim_step();
+    TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+    TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm));
+    TEST_ASSERT_EQUAL(writes + 1, GPIOB->sim_bsrr_writes);
+    TEST_ASSERT_EQUAL(((uint32_t)led_comfort_temperature.mask << 16) | led_heater_active.mask, GPIOB->BSRR);
+    TEST_ASSERT_TRUE(port_led_get_status(&led_heater_active));
+    TEST_ASSERT_FALSE(port_led_get_status(&led_comfort_temperature));
+    TEST_ASSERT_TRUE(port_led_get_status(&led_on));
+
+    // Deactivation: the other way round, in a single write too
+    fsm_thermostat_set_threshold(p_fsm, 15000);
+    TEST_ASSERT_TRUE(fsm_thermostat_fire(p_fsm));
+    TEST_ASSERT_EQUAL(writes + 2, GPIOB->sim_bsrr_writes);
+    TEST_ASSERT_FALSE(port_led_get_status(&led_heater_active));
+    TEST_ASSERT_TRUE(port_led_get_status(&led_comfort_temperature));
+    TEST_ASSERT_TRUE(port_led_get_status(&led_on));
+
+    port_led_off(&led_on);
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_thermostat_pool_is_static(void)
+{
+    fsm_t *p_fsm[THERMOSTAT_POOL_SIZE];
+    for (uint8_t i = 0; i < THERMOSTAT_POOL_SIZE; i++)
+    {
+        p_fsm[i] = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+        TEST_ASSERT_NOT_NULL(p_fsm[i]);
+    }
+    TEST_ASSERT_EQUAL(THERMOSTAT_POOL_SIZE, fsm_thermostat_get_count());
+    TEST_ASSERT_NULL(fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat));
+
+    // A released slot is reused
+    fsm_thermostat_destroy(p_fsm[1]);
+    TEST_ASSERT_EQUAL(THERMOSTAT_POOL_SIZE - 1, fsm_thermostat_get_count());
+    TEST_ASSERT_TRUE(p_fsm[1] == fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat));
+
+    // All the zones are fired in one pass: 20 ºC activates all of them
+    port_system_sim_step(); // TIM2 update: trigger output
+    port_system_sim_step(); // End of conversion
+    fsm_thermostat_fire_all();
+    for (uint8_t i = 0; i < THERMOSTAT_POOL_SIZE; i++)
+    {
+        TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm[i]));
+        fsm_thermostat_destroy(p_fsm[i]);
+    }
+    TEST_ASSERT_EQUAL(0, fsm_thermostat_get_count());
+}
+
+void test_thermostat_zones_share_one_adc_scan(void)
+{
+    port_temp_hw_t temp_sensor_room = {.p_port = GPIOA, .pin = 1, .p_adc = ADC1, .adc_channel = 1, .adc_counts = 0, .sample_seq = 0};
+    port_system_sim_adc_set_source(ADC1, _two_rooms_source);
+    fsm_t *p_fsm_0 = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    fsm_t *p_fsm_1 = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_room);
+
+    // One sequence of 8 conversions: 4 per sensor, interleaved
+    TEST_ASSERT_EQUAL(2, temp_sensor_scan.n_sensors);
+    TEST_ASSERT_EQUAL(1, temp_sensor_scan.oversampling_bits);
+    TEST_ASSERT_EQUAL(8, temp_sensor_scan.n_conversions);
+
+    // One trigger and one interrupt of the DMA give a new sample to both zones
+    uint32_t seq_0 = port_temp_sensor_get_sample_seq(&temp_sensor_thermostat);
+    uint32_t seq_1 = port_temp_sensor_get_sample_seq(&temp_sensor_room);
+    port_system_sim_step(); // TIM2 update: trigger output
+    port_system_sim_step(); // End of the sequence
+    TEST_ASSERT_EQUAL(seq_0 + 1, port_temp_sensor_get_sample_seq(&temp_sensor_thermostat));
+    TEST_ASSERT_EQUAL(seq_1 + 1, port_temp_sensor_get_sample_seq(&temp_sensor_room));
+    uint32_t counts_0 = _two_rooms_source(0, 0);
+    uint32_t counts_1 = _two_rooms_source(1, 0);
+    for (uint8_t i = 0; i < 8; i += 2)
+    {
+        TEST_ASSERT_EQUAL(counts_0, temp_sensor_scan.adc_buffer[i]);
+        TEST_ASSERT_EQUAL(counts_1, temp_sensor_scan.adc_buffer[i + 1]);
+    }
+
+    // Each zone sees its own room: heating below the default threshold (25 ºC) only
+    TEST_ASSERT_EQUAL(counts_0 << TEMP_SENSOR_OVERSAMPLING_BITS, port_temp_sensor_get_adc_counts(&temp_sensor_thermostat));
+    TEST_ASSERT_EQUAL(counts_1 << TEMP_SENSOR_OVERSAMPLING_BITS, port_temp_sensor_get_adc_counts(&temp_sensor_room));
+    fsm_thermostat_fire_all();
+    TEST_ASSERT_EQUAL(THERMOSTAT_ON, fsm_get_state(p_fsm_0));
+    TEST_ASSERT_EQUAL(THERMOSTAT_OFF, fsm_get_state(p_fsm_1));
+
+    // The sensor of a destroyed zone leaves the scan
+    fsm_thermostat_destroy(p_fsm_1);
+    TEST_ASSERT_EQUAL(1, temp_sensor_scan.n_sensors);
+    TEST_ASSERT_EQUAL(TEMP_SENSOR_OVERSAMPLING, temp_sensor_scan.n_conversions);
+    fsm_thermostat_destroy(p_fsm_0);
+    TEST_ASSERT_EQUAL(0, temp_sensor_scan.n_sensors);
+}
+
+void test_thermostat_zones_share_the_period_and_the_low_power_mode(void)
+{
+    port_temp_hw_t temp_sensor_room = {.p_port = GPIOA, .pin = 1, .p_adc = ADC1, .adc_channel = 1, .adc_counts = 0, .sample_seq = 0};
+    fsm_t *p_fsm_0 = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    TEST_ASSERT_TRUE(fsm_thermostat_set_period(p_fsm_0, 250));
+    uint64_t ticks = TIMER_TICKS_MS(250);
+
+    // Creating another zone does not set up the measurement timer again
+    fsm_t *p_fsm_1 = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_room);
+    TEST_ASSERT_EQUAL(250, fsm_thermostat_get_period(p_fsm_0));
+    TEST_ASSERT_EQUAL(250, fsm_thermostat_get_period(p_fsm_1));
+    TEST_ASSERT_EQUAL(TIMER_PSC(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX), TIM2->PSC);
+    TEST_ASSERT_EQUAL(TIMER_ARR(ticks, THERMOSTAT_MEASUREMENT_TIMER_ARR_MAX), TIM2->ARR);
+
+    // The period set on any zone is the one of all of them, also in the saved settings
+    TEST_ASSERT_TRUE(fsm_thermostat_set_period(p_fsm_1, 500));
+    thermostat_config_t config;
+    fsm_thermostat_get_config(p_fsm_0, &config);
+    TEST_ASSERT_EQUAL(500, config.period_ms);
+    fsm_thermostat_destroy(p_fsm_1);
+
+    // A zone created in low-power mode joins it: its conversions are not started by the timer
+    fsm_thermostat_set_low_power(p_fsm_0, true);
+    p_fsm_1 = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_room);
+    TEST_ASSERT_EQUAL(0, ADC1->CR2 & ADC_CR2_EXTEN);
+    TEST_ASSERT_EQUAL(500, fsm_thermostat_get_period(p_fsm_1));
+
+    fsm_thermostat_set_low_power(p_fsm_1, false);
+    TEST_ASSERT_NOT_EQUAL(0, ADC1->CR2 & ADC_CR2_EXTEN);
+    fsm_thermostat_destroy(p_fsm_1);
+    fsm_thermostat_destroy(p_fsm_0);
+}
+
+/**
+ * @brief Forces a transition of the thermostat at a given time by moving the threshold around the current temperature (20 ºC).
+ */
+static void _transition_at(fsm_t *p_fsm, uint32_t ms, uint8_t event)
+{
+    port_system_set_millis(ms);
+    fsm_thermostat_set_threshold(p_fsm, (event == ACTIVATION) ? 30000 : 10000);
+    fsm_thermostat_fire(p_fsm);
+}
+
+void test_thermostat_history_is_ordered_and_packed(void)
+{
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    TEST_ASSERT_EQUAL((uint8_t)UNKNOWN, fsm_thermostat_get_status(p_fsm));
+    TEST_ASSERT_EQUAL(0, fsm_thermostat_get_history(p_fsm, NULL, NULL, 255));
+
+    // The last time of each event is the most recent one
+    uint32_t t = 1000;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        _transition_at(p_fsm, t, ACTIVATION);
+        _transition_at(p_fsm, t + 60000, DEACTIVATION);
+        t += 3600000;
+    }
+    TEST_ASSERT_EQUAL(DEACTIVATION, fsm_thermostat_get_status(p_fsm));
+    TEST_ASSERT_EQUAL(t - 3600000, fsm_thermostat_get_last_time_event(p_fsm, ACTIVATION));
+    TEST_ASSERT_EQUAL(t - 3600000 + 60000, fsm_thermostat_get_last_time_event(p_fsm, DEACTIVATION));
+
+    // The history is read from the most recent event
+    uint8_t events[12];
+    uint32_t times[12];
+    TEST_ASSERT_EQUAL(12, fsm_thermostat_get_history(p_fsm, events, times, 12));
+    for (uint8_t i = 0; i < 12; i += 2)
+    {
+        TEST_ASSERT_EQUAL(DEACTIVATION, events[i]);
+        TEST_ASSERT_EQUAL(ACTIVATION, events[i + 1]);
+        TEST_ASSERT_EQUAL(times[i + 1] + 60000, times[i]);
+    }
+    TEST_ASSERT_EQUAL(1000, times[11]);
+
+    // The oldest events are overwritten when the history is full, and the newest ones survive
+    for (uint8_t i = 0; i < 100; i++)
+    {
+        _transition_at(p_fsm, t, ACTIVATION);
+        _transition_at(p_fsm, t + 5000, DEACTIVATION);
+        t += 10000;
+    }
+    uint8_t count = fsm_thermostat_get_history(p_fsm, events, times, 12);
+    TEST_ASSERT_EQUAL(12, count);
+    TEST_ASSERT_EQUAL(t - 10000 + 5000, times[0]);
+    TEST_ASSERT_EQUAL(t - 10000, times[1]);
+    TEST_ASSERT_GREATER_THAN(THERMOSTAT_HISTORY / HISTORY_TEST_MAX_BYTES_PER_EVENT - 1, fsm_thermostat_get_history(p_fsm, NULL, NULL, 255));
+
+    fsm_thermostat_destroy(p_fsm);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_virtual_clock_jumps_to_next_event);
+    RUN_TEST(test_virtual_clock_periodic_and_delay);
+    RUN_TEST(test_wait_for_events_sleeps_until_a_sample);
+    RUN_TEST(test_wakeup_only_at_the_scheduled_time);
+    RUN_TEST(test_time_is_monotonic_when_the_millis_wrap_around);
+    RUN_TEST(test_adc_conversion_is_simulated);
+    RUN_TEST(test_adc_is_triggered_by_the_timer);
+    RUN_TEST(test_adc_dma_oversamples_each_period);
+    RUN_TEST(test_adc_power_up_does_not_block);
+    RUN_TEST(test_timer_prescaler_and_reload);
+    RUN_TEST(test_thermostat_period_in_milliseconds);
+    RUN_TEST(test_thermostat_low_power_samples_with_the_rtc);
+    RUN_TEST(test_thermostat_low_power_with_adc_watchdog_enters_stop);
+    RUN_TEST(test_threshold_is_converted_to_adc_counts);
+    RUN_TEST(test_thermostat_follows_temperature_for_days);
+    RUN_TEST(test_thermostat_pool_is_static);
+    RUN_TEST(test_thermostat_zones_share_one_adc_scan);
+    RUN_TEST(test_thermostat_zones_share_the_period_and_the_low_power_mode);
+    RUN_TEST(test_thermostat_adc_watchdog_wakes_up_only_on_crossings);
+    RUN_TEST(test_thermostat_hysteresis_and_dwell_bound_the_transitions);
+    RUN_TEST(test_thermostat_trace_replays_the_recorded_transitions);
+    RUN_TEST(test_thermostat_median_filter_suppresses_spurious_transitions);
+    RUN_TEST(test_thermostat_fires_only_on_new_inputs);
+    RUN_TEST(test_thermostat_leds_switch_in_one_bsrr_write);
+    RUN_TEST(test_thermostat_history_is_ordered_and_packed);
+    return UNITY_END();
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "port_system.h"
+#include "port_flash.h"
+#include "port_uart.h"
+#include "port_led.h"
+#include "port_temp_sensor.h"
+#include "fsm_thermostat.h"
+#include "thermostat_config.h"
+#include "thermostat_cmd.h"
+
+#define CMD_TEST_WAIT_US 200000ULL /*!< Virtual time to receive a burst of commands or to send their replies: about 2 KB at 115200 bauds */
+
+static fsm_t *p_fsm;
+static uint32_t reply_start; /*!< Start of the replies of the last exchange in `port_uart_sim_tx` */
+
+/**
+ * @brief The host sends a burst of commands, and the main loop serves the UART.
+ *
+ * @return const char* Replies received by the host, as a string.
+ */
+static const char *_exchange(const char *p_commands)
+{
+    reply_start = port_uart_sim_tx_length;
+    port_uart_sim_receive(p_commands, strlen(p_commands));
+    port_system_sim_run_until_us(port_system_sim_get_time_us() + CMD_TEST_WAIT_US);
+    thermostat_cmd_process();
+    port_system_sim_run_until_us(port_system_sim_get_time_us() + CMD_TEST_WAIT_US);
+    port_uart_sim_tx[port_uart_sim_tx_length] = '\0';
+    return (const char *)&port_uart_sim_tx[reply_start];
+}
+
+void setUp(void)
+{
+    port_system_init();
+    port_flash_erase();
+    thermostat_config_init();
+    p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    thermostat_cmd_init(p_fsm);
+}
+
+void tearDown(void)
+{
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_cmd_burst_is_served_with_one_interrupt_and_one_transfer(void)
+{
+    const char *p_reply = _exchange("threshold 21500\nperiod 2000\nstatus\n");
+
+    TEST_ASSERT_EQUAL(21500, fsm_thermostat_get_threshold(p_fsm));
+    TEST_ASSERT_EQUAL(2000, fsm_thermostat_get_period(p_fsm));
+    char expected[160];
+    snprintf(expected, sizeof(expected), "ok\nok\nstate=off temperature=%d threshold=21500 period=2000 transitions=0\nok\n", (int)port_temp_sensor_get_temperature_mcelsius(&temp_sensor_thermostat));
+    TEST_ASSERT_EQUAL_STRING(expected, p_reply);
+
+    // The CPU does not move the bytes: one interrupt for the whole burst and one transfer for all the replies
+    TEST_ASSERT_EQUAL(1, port_uart_sim_rx_irqs);
+    TEST_ASSERT_EQUAL(1, port_uart_sim_tx_transfers);
+}
+
+void test_cmd_lines_are_parsed_in_place_across_bursts_and_the_end_of_the_buffer(void)
+{
+    // Empty lines move the position of the reception close to the end of the circular buffer
+    char padding[PORT_UART_RX_SIZE - 4U + 1U];
+    memset(padding, '\n', sizeof(padding) - 1U);
+    padding[sizeof(padding) - 1U] = '\0';
+    TEST_ASSERT_EQUAL_STRING("", _exchange(padding));
+    TEST_ASSERT_EQUAL(PORT_UART_RX_SIZE - 4U, port_uart_get_rx_head());
+
+    // A command typed in two bursts that wraps around the end of the buffer, ended by CR LF
+    TEST_ASSERT_EQUAL_STRING("", _exchange("  thres"));
+    TEST_ASSERT_EQUAL_STRING("ok\n", _exchange("hold -1500\r\n"));
+    TEST_ASSERT_EQUAL(-1500, fsm_thermostat_get_threshold(p_fsm));
+
+    // Wrong commands and arguments
+    TEST_ASSERT_EQUAL_STRING("error\nerror\nerror\nerror\nerror\n", _exchange("heat 1\nthreshold abc\nperiod 0\nthreshold 2147483648\nstatus now\n"));
+    TEST_ASSERT_EQUAL(-1500, fsm_thermostat_get_threshold(p_fsm));
+
+    // A line too long to be a command is discarded, and the next one is served
+    char long_line[THERMOSTAT_CMD_MAX_LINE + 2U];
+    memset(long_line, 'x', sizeof(long_line) - 1U);
+    long_line[sizeof(long_line) - 1U] = '\0';
+    TEST_ASSERT_EQUAL_STRING("error\n", _exchange(long_line));
+    _exchange("\n");
+    TEST_ASSERT_EQUAL_STRING("ok\n", _exchange("threshold 22000\n"));
+    TEST_ASSERT_EQUAL(22000, fsm_thermostat_get_threshold(p_fsm));
+}
+
+void test_cmd_history_is_dumped_in_bulk_and_config_is_saved(void)
+{
+    // The thermostat switches on and off with the threshold set by the host (the room is at 20 ºC)
+    _exchange("threshold 30000\n");
+    fsm_thermostat_fire(p_fsm);
+    _exchange("threshold 10000\n");
+    fsm_thermostat_fire(p_fsm);
+    _exchange("threshold 30000\n");
+    fsm_thermostat_fire(p_fsm);
+
+    uint8_t events[THERMOSTAT_HISTORY];
+    uint32_t times[THERMOSTAT_HISTORY];
+    uint8_t n_events = fsm_thermostat_get_history(p_fsm, events, times, THERMOSTAT_HISTORY);
+    TEST_ASSERT_EQUAL(3, n_events);
+    char expected[128];
+    snprintf(expected, sizeof(expected), "%u on\n%u off\n%u on\nok\n", (unsigned)times[0], (unsigned)times[1], (unsigned)times[2]);
+    uint32_t transfers = port_uart_sim_tx_transfers;
+    TEST_ASSERT_EQUAL_STRING(expected, _exchange("history\n"));
+    TEST_ASSERT_EQUAL(transfers + 1U, port_uart_sim_tx_transfers);
+
+    // The configuration set by the host survives a reset
+    TEST_ASSERT_EQUAL_STRING("ok\n", _exchange("save\n"));
+    thermostat_config_t config;
+    thermostat_config_init();
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL(30000, config.threshold_mcelsius);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cmd_burst_is_served_with_one_interrupt_and_one_transfer);
+    RUN_TEST(test_cmd_lines_are_parsed_in_place_across_bursts_and_the_end_of_the_buffer);
+    RUN_TEST(test_cmd_history_is_dumped_in_bulk_and_config_is_saved);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <string.h>
+#include <unity.h>
+#include "port_system.h"
+#include "port_flash.h"
+#include "port_led.h"
+#include "port_temp_sensor.h"
+#include "fsm_thermostat.h"
+#include "thermostat_config.h"
+
+#define CONFIG_SLOTS (PORT_FLASH_SECTOR_SIZE / THERMOSTAT_CONFIG_RECORD_BYTES) /*!< Records of the emulated sector */
+
+/**
+ * @brief Configuration of the tests: a different threshold for each index.
+ */
+static thermostat_config_t _config(uint32_t index)
+{
+    thermostat_config_t config = {.threshold_mcelsius = 20000 + (int32_t)index, .period_ms = 500, .hysteresis_mcelsius = 1000, .min_on_ms = 0, .min_off_ms = 0};
+    return config;
+}
+
+void setUp(void)
+{
+    // A new device: the sector of the configuration is erased
+    port_system_init();
+    port_flash_erase();
+    port_flash_sim_cut_power_after(UINT32_MAX);
+    thermostat_config_init();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_config_survives_a_reset(void)
+{
+    thermostat_config_t config;
+    TEST_ASSERT_FALSE(thermostat_config_load(&config));
+
+    // The newest record wins
+    thermostat_config_t first = _config(1);
+    thermostat_config_t second = _config(2);
+    TEST_ASSERT_TRUE(thermostat_config_save(&first));
+    TEST_ASSERT_TRUE(thermostat_config_save(&second));
+    thermostat_config_init();
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL_MEMORY(&second, &config, sizeof(config));
+
+    // Saving the same configuration again does not wear the flash
+    thermostat_config_stats_t stats;
+    thermostat_config_save(&second);
+    thermostat_config_get_stats(&stats);
+    TEST_ASSERT_EQUAL(2, stats.used_slots);
+    TEST_ASSERT_EQUAL(2, stats.seq);
+
+    // The restored configuration is applied to the thermostat
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    TEST_ASSERT_TRUE(fsm_thermostat_set_config(p_fsm, &config));
+    thermostat_config_t applied;
+    fsm_thermostat_get_config(p_fsm, &applied);
+    TEST_ASSERT_EQUAL_MEMORY(&config, &applied, sizeof(config));
+    TEST_ASSERT_EQUAL(500, fsm_thermostat_get_period(p_fsm));
+
+    // A configuration with a period out of range is not applied at all
+    thermostat_config_t invalid = config;
+    invalid.period_ms = 0;
+    invalid.threshold_mcelsius = 30000;
+    TEST_ASSERT_FALSE(fsm_thermostat_set_config(p_fsm, &invalid));
+    fsm_thermostat_get_config(p_fsm, &applied);
+    TEST_ASSERT_EQUAL_MEMORY(&config, &applied, sizeof(config));
+    fsm_thermostat_destroy(p_fsm);
+}
+
+void test_config_erases_only_when_full_and_boots_with_a_bounded_scan(void)
+{
+    // Fill the sector: no erase
+    uint32_t erases = port_flash_sim_erases;
+    for (uint32_t i = 0; i < CONFIG_SLOTS; i++)
+    {
+        thermostat_config_t config = _config(i);
+        TEST_ASSERT_TRUE(thermostat_config_save(&config));
+    }
+    TEST_ASSERT_EQUAL(erases, port_flash_sim_erases);
+
+    // The boot reads a binary search of headers and one record, not the whole sector
+    uint32_t words_read = port_flash_sim_words_read;
+    thermostat_config_init();
+    uint32_t boot_words = port_flash_sim_words_read - words_read;
+    TEST_ASSERT_LESS_OR_EQUAL(8U + THERMOSTAT_CONFIG_RECORD_WORDS, boot_words);
+    thermostat_config_t config;
+    thermostat_config_t expected = _config(CONFIG_SLOTS - 1U);
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &config, sizeof(config));
+
+    // The next update erases the sector once, and keeps the sequence going
+    expected = _config(CONFIG_SLOTS);
+    TEST_ASSERT_TRUE(thermostat_config_save(&expected));
+    TEST_ASSERT_EQUAL(erases + 1U, port_flash_sim_erases);
+    thermostat_config_init();
+    thermostat_config_stats_t stats;
+    thermostat_config_get_stats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.used_slots);
+    TEST_ASSERT_EQUAL(CONFIG_SLOTS + 1U, stats.seq);
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &config, sizeof(config));
+}
+
+void test_config_skips_a_record_cut_by_a_reset(void)
+{
+    thermostat_config_t good = _config(1);
+    thermostat_config_t torn = _config(2);
+    TEST_ASSERT_TRUE(thermostat_config_save(&good));
+
+    // Reset after 3 words of the next record: the header is written, but not the CRC
+    port_flash_sim_cut_power_after(3);
+    TEST_ASSERT_FALSE(thermostat_config_save(&torn));
+    port_flash_sim_cut_power_after(UINT32_MAX);
+
+    thermostat_config_t config;
+    thermostat_config_init();
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL_MEMORY(&good, &config, sizeof(config));
+
+    // The next record goes after the cut one
+    TEST_ASSERT_TRUE(thermostat_config_save(&torn));
+    thermostat_config_init();
+    thermostat_config_stats_t stats;
+    thermostat_config_get_stats(&stats);
+    TEST_ASSERT_EQUAL(3, stats.used_slots);
+    TEST_ASSERT_EQUAL(2, stats.seq);
+    TEST_ASSERT_TRUE(thermostat_config_load(&config));
+    TEST_ASSERT_EQUAL_MEMORY(&torn, &config, sizeof(config));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_config_survives_a_reset);
+    RUN_TEST(test_config_erases_only_when_full_and_boots_with_a_bounded_scan);
+    RUN_TEST(test_config_skips_a_record_cut_by_a_reset);
+    return UNITY_END();
+}
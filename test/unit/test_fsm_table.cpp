@@ -0,0 +1,103 @@
+#include <unity.h>
+#include "fsm_table.hpp"
+
+/**
+ * @brief Machine of the tests: its inputs and a record of its actions.
+ */
+struct machine_t
+{
+    int state;        /*!< Current state */
+    bool go;          /*!< Input of the guards */
+    bool back;        /*!< Input of the guards */
+    int actions;      /*!< Number of actions */
+    int action_state; /*!< State seen by the last action */
+};
+
+static machine_t machine;
+
+static bool _check_go(machine_t *p_this) { return p_this->go; }
+static bool _check_back(machine_t *p_this) { return p_this->back; }
+static void _do_record(machine_t *p_this)
+{
+    p_this->actions++;
+    p_this->action_state = p_this->state;
+}
+
+enum
+{
+    IDLE = 0,
+    RUNNING,
+    STOPPED,
+    NUM_STATES
+};
+
+// RUNNING has two transitions: the first one in the table has priority. STOPPED has none
+using engine_t = fsm_table::engine<machine_t, NUM_STATES,
+                                   fsm_table::transition<IDLE, _check_go, RUNNING, _do_record>,
+                                   fsm_table::transition<RUNNING, _check_back, IDLE>,
+                                   fsm_table::transition<RUNNING, _check_go, STOPPED, _do_record>>;
+
+void setUp(void)
+{
+    machine = machine_t{IDLE, false, false, 0, -1};
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_fsm_table_fires_the_first_true_guard_of_the_state(void)
+{
+    TEST_ASSERT_EQUAL(3, engine_t::num_transitions);
+
+    // No guard is true: no transition, no action
+    TEST_ASSERT_FALSE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(IDLE, machine.state);
+    TEST_ASSERT_EQUAL(0, machine.actions);
+
+    // The state is updated before the action runs, as with fsm_fire()
+    machine.go = true;
+    TEST_ASSERT_TRUE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(RUNNING, machine.state);
+    TEST_ASSERT_EQUAL(1, machine.actions);
+    TEST_ASSERT_EQUAL(RUNNING, machine.action_state);
+
+    // Both guards of RUNNING are true: the first transition of the table wins. It has no action
+    machine.back = true;
+    TEST_ASSERT_TRUE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(IDLE, machine.state);
+    TEST_ASSERT_EQUAL(1, machine.actions);
+
+    // The transitions of the other states are not evaluated
+    machine.back = false;
+    TEST_ASSERT_TRUE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_TRUE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(STOPPED, machine.state);
+    TEST_ASSERT_EQUAL(3, machine.actions);
+}
+
+void test_fsm_table_states_without_transitions(void)
+{
+    // A state without transitions keeps the FSM in it
+    machine.state = STOPPED;
+    machine.go = true;
+    machine.back = true;
+    TEST_ASSERT_FALSE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(STOPPED, machine.state);
+
+    // A state out of range is ignored
+    machine.state = NUM_STATES;
+    TEST_ASSERT_FALSE(engine_t::fire(&machine, machine.state));
+    machine.state = -1;
+    TEST_ASSERT_FALSE(engine_t::fire(&machine, machine.state));
+    TEST_ASSERT_EQUAL(0, machine.actions);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fsm_table_fires_the_first_true_guard_of_the_state);
+    RUN_TEST(test_fsm_table_states_without_transitions);
+    return UNITY_END();
+}
@@ -13,19 +13,19 @@ void tearDown(void)
 
 void test_led(void)
 {
-    port_led_gpio_setup();
-    TEST_ASSERT_FALSE(port_led_get_status());
+    port_led_init(&led_heater_active);
+    TEST_ASSERT_FALSE(port_led_get_status(&led_heater_active));
 
-    port_led_on();
-    TEST_ASSERT_TRUE(port_led_get_status());
+    port_led_on(&led_heater_active);
+    TEST_ASSERT_TRUE(port_led_get_status(&led_heater_active));
 
-    port_led_off();
-    TEST_ASSERT_FALSE(port_led_get_status());
+    port_led_off(&led_heater_active);
+    TEST_ASSERT_FALSE(port_led_get_status(&led_heater_active));
 
-    port_led_toggle();
-    TEST_ASSERT_TRUE(port_led_get_status());
-    port_led_toggle();
-    TEST_ASSERT_FALSE(port_led_get_status());
+    port_led_toggle(&led_heater_active);
+    TEST_ASSERT_TRUE(port_led_get_status(&led_heater_active));
+    port_led_toggle(&led_heater_active);
+    TEST_ASSERT_FALSE(port_led_get_status(&led_heater_active));
 }
 
 
@@ -0,0 +1,90 @@
+#include <unity.h>
+#include "thermostat_filter.h"
+
+static thermostat_filter_t filter;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_filter_ema_converges_to_a_step_from_both_sides(void)
+{
+    thermostat_filter_init_ema(&filter, 3);
+
+    // The first sample fills the accumulator: no transient
+    TEST_ASSERT_EQUAL(1000, thermostat_filter_update(&filter, 1000));
+
+    // 1/8 of the step per sample
+    TEST_ASSERT_EQUAL(1100, thermostat_filter_update(&filter, 1800));
+    uint32_t output = 0;
+    for (uint8_t i = 0; i < 100; i++)
+    {
+        output = thermostat_filter_update(&filter, 1800);
+    }
+    TEST_ASSERT_EQUAL(1800, output);
+    for (uint8_t i = 0; i < 100; i++)
+    {
+        output = thermostat_filter_update(&filter, 1000);
+    }
+    TEST_ASSERT_EQUAL(1000, output);
+
+    // A reset forgets the past samples
+    thermostat_filter_reset(&filter);
+    TEST_ASSERT_EQUAL(5000, thermostat_filter_update(&filter, 5000));
+}
+
+void test_filter_moving_average_of_a_power_of_2_window(void)
+{
+    thermostat_filter_init_moving_average(&filter, 2);
+    TEST_ASSERT_EQUAL(4, filter.window);
+    TEST_ASSERT_EQUAL(100, thermostat_filter_update(&filter, 100));
+
+    // The step enters the window one sample at a time, and leaves it after 4 samples
+    TEST_ASSERT_EQUAL(200, thermostat_filter_update(&filter, 500));
+    TEST_ASSERT_EQUAL(300, thermostat_filter_update(&filter, 500));
+    TEST_ASSERT_EQUAL(400, thermostat_filter_update(&filter, 500));
+    TEST_ASSERT_EQUAL(500, thermostat_filter_update(&filter, 500));
+    TEST_ASSERT_EQUAL(400, thermostat_filter_update(&filter, 100));
+
+    // The window is saturated
+    thermostat_filter_init_moving_average(&filter, 10);
+    TEST_ASSERT_EQUAL(THERMOSTAT_FILTER_MAX_WINDOW, filter.window);
+}
+
+void test_filter_median_removes_spikes_and_keeps_steps(void)
+{
+    thermostat_filter_init_median(&filter, 5);
+    TEST_ASSERT_EQUAL(1000, thermostat_filter_update(&filter, 1000));
+
+    // Isolated spikes, up and down, never reach the output
+    TEST_ASSERT_EQUAL(1000, thermostat_filter_update(&filter, 4000));
+    TEST_ASSERT_EQUAL(1000, thermostat_filter_update(&filter, 1001));
+    TEST_ASSERT_EQUAL(1000, thermostat_filter_update(&filter, 10));
+    TEST_ASSERT_EQUAL(1001, thermostat_filter_update(&filter, 1002));
+    TEST_ASSERT_EQUAL(1002, thermostat_filter_update(&filter, 1003));
+
+    // A step passes without blurring, delayed by half the window
+    TEST_ASSERT_EQUAL(1002, thermostat_filter_update(&filter, 2000));
+    TEST_ASSERT_EQUAL(1003, thermostat_filter_update(&filter, 2000));
+    TEST_ASSERT_EQUAL(2000, thermostat_filter_update(&filter, 2000));
+
+    // The window of the median is odd
+    thermostat_filter_init_median(&filter, 4);
+    TEST_ASSERT_EQUAL(3, filter.window);
+    thermostat_filter_init_median(&filter, 100);
+    TEST_ASSERT_EQUAL(THERMOSTAT_FILTER_MAX_WINDOW - 1, filter.window);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_filter_ema_converges_to_a_step_from_both_sides);
+    RUN_TEST(test_filter_moving_average_of_a_power_of_2_window);
+    RUN_TEST(test_filter_median_removes_spikes_and_keeps_steps);
+    return UNITY_END();
+}
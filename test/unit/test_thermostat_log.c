@@ -0,0 +1,96 @@
+#include <unity.h>
+#include "thermostat_log.h"
+#include "thermostat_telemetry.h"
+
+static thermostat_telemetry_decoder_t decoder; /*!< Decoder of the telemetry sent by the drain of the log */
+static uint32_t samples;                       /*!< Samples received by the decoder */
+static int32_t last_dropped;                   /*!< Last number of dropped records received by the decoder */
+
+/**
+ * @brief Output of the telemetry that decodes the frames at once.
+ */
+static void _decode(const uint8_t *p_data, uint32_t length)
+{
+    thermostat_telemetry_record_t record;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        if (thermostat_telemetry_decoder_push(&decoder, p_data[i]))
+        {
+            while (thermostat_telemetry_decoder_next(&decoder, &record))
+            {
+                samples += (record.type == THERMOSTAT_TELEMETRY_SAMPLE);
+                if ((record.type == THERMOSTAT_TELEMETRY_COUNTER) && (record.id == THERMOSTAT_TELEMETRY_LOG_DROPPED))
+                {
+                    last_dropped = record.value;
+                }
+            }
+        }
+    }
+}
+
+void setUp(void)
+{
+    thermostat_telemetry_decoder_init(&decoder);
+    thermostat_telemetry_init(_decode);
+    samples = 0;
+    last_dropped = -1;
+
+    // Empty the log
+    thermostat_log_record_t record;
+    while (thermostat_log_pop(&record))
+    {
+    }
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_log_is_fifo(void)
+{
+    thermostat_log_record_t record;
+    TEST_ASSERT_FALSE(thermostat_log_pop(&record));
+
+    TEST_ASSERT_TRUE(thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, 0, 21500));
+    TEST_ASSERT_TRUE(thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, 1, 21600));
+
+    TEST_ASSERT_TRUE(thermostat_log_pop(&record));
+    TEST_ASSERT_EQUAL(THERMOSTAT_LOG_TEMPERATURE, record.code);
+    TEST_ASSERT_EQUAL(21500, record.arg);
+    TEST_ASSERT_TRUE(thermostat_log_pop(&record));
+    TEST_ASSERT_EQUAL(1, record.source);
+    TEST_ASSERT_EQUAL(21600, record.arg);
+    TEST_ASSERT_FALSE(thermostat_log_pop(&record));
+}
+
+void test_log_drops_when_full(void)
+{
+    uint32_t dropped = thermostat_log_get_dropped();
+    for (int32_t i = 0; i < THERMOSTAT_LOG_SIZE; i++)
+    {
+        TEST_ASSERT_TRUE(thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, 0, i));
+    }
+    TEST_ASSERT_FALSE(thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, 0, -1));
+    TEST_ASSERT_EQUAL(dropped + 1, thermostat_log_get_dropped());
+
+    // The oldest records are kept, and there is room again after popping
+    thermostat_log_record_t record;
+    TEST_ASSERT_TRUE(thermostat_log_pop(&record));
+    TEST_ASSERT_EQUAL(0, record.arg);
+    TEST_ASSERT_TRUE(thermostat_log_push(THERMOSTAT_LOG_TEMPERATURE, 0, 100));
+    TEST_ASSERT_EQUAL(THERMOSTAT_LOG_SIZE, thermostat_log_drain());
+
+    // The records and the number of dropped ones are sent to the telemetry
+    thermostat_telemetry_flush();
+    TEST_ASSERT_EQUAL(THERMOSTAT_LOG_SIZE, samples);
+    TEST_ASSERT_EQUAL(dropped + 1, last_dropped);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_log_is_fifo);
+    RUN_TEST(test_log_drops_when_full);
+    return UNITY_END();
+}
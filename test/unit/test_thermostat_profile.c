@@ -0,0 +1,69 @@
+#include <unity.h>
+#define THERMOSTAT_PROFILE 1 // Instrument the regions of this test
+#include "thermostat_profile.h"
+
+void setUp(void)
+{
+    port_system_init();
+    thermostat_profile_reset();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_profile_buckets_are_log2(void)
+{
+    TEST_ASSERT_EQUAL(0, thermostat_profile_bucket(0));
+    TEST_ASSERT_EQUAL(0, thermostat_profile_bucket(1));
+    TEST_ASSERT_EQUAL(1, thermostat_profile_bucket(2));
+    TEST_ASSERT_EQUAL(1, thermostat_profile_bucket(3));
+    TEST_ASSERT_EQUAL(10, thermostat_profile_bucket(1024));
+    TEST_ASSERT_EQUAL(10, thermostat_profile_bucket(2047));
+    TEST_ASSERT_EQUAL(THERMOSTAT_PROFILE_BUCKETS - 1, thermostat_profile_bucket(UINT32_MAX));
+}
+
+void test_profile_keeps_min_max_mean_and_histogram(void)
+{
+    thermostat_profile_stats_t stats;
+    thermostat_profile_record(THERMOSTAT_PROFILE_DMA_ISR, 100);
+    thermostat_profile_record(THERMOSTAT_PROFILE_DMA_ISR, 300);
+    thermostat_profile_record(THERMOSTAT_PROFILE_DMA_ISR, 110);
+
+    TEST_ASSERT_TRUE(thermostat_profile_get_stats(THERMOSTAT_PROFILE_DMA_ISR, &stats));
+    TEST_ASSERT_EQUAL(3, stats.count);
+    TEST_ASSERT_EQUAL(100, stats.min_cycles);
+    TEST_ASSERT_EQUAL(300, stats.max_cycles);
+    TEST_ASSERT_EQUAL(170, stats.total_cycles / stats.count);
+    TEST_ASSERT_EQUAL(2, stats.histogram[6]); // [64, 128)
+    TEST_ASSERT_EQUAL(1, stats.histogram[8]); // [256, 512)
+
+    // The other regions are not affected, and unknown regions are ignored
+    TEST_ASSERT_TRUE(thermostat_profile_get_stats(THERMOSTAT_PROFILE_ADC_ISR, &stats));
+    TEST_ASSERT_EQUAL(0, stats.count);
+    thermostat_profile_record(THERMOSTAT_PROFILE_REGIONS_COUNT, 1);
+    TEST_ASSERT_FALSE(thermostat_profile_get_stats(THERMOSTAT_PROFILE_REGIONS_COUNT, &stats));
+    TEST_ASSERT_EQUAL(1, thermostat_profile_dump());
+}
+
+void test_profile_macros_count_the_cycles_of_a_region(void)
+{
+    THERMOSTAT_PROFILE_BEGIN(THERMOSTAT_PROFILE_FSM_FIRE);
+    port_system_delay_us(10);
+    THERMOSTAT_PROFILE_END(THERMOSTAT_PROFILE_FSM_FIRE);
+
+    thermostat_profile_stats_t stats;
+    thermostat_profile_get_stats(THERMOSTAT_PROFILE_FSM_FIRE, &stats);
+    TEST_ASSERT_EQUAL(1, stats.count);
+    TEST_ASSERT_EQUAL(10U * (PORT_SYSTEM_CORE_CLOCK_HZ / 1000000U), stats.max_cycles);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_profile_buckets_are_log2);
+    RUN_TEST(test_profile_keeps_min_max_mean_and_histogram);
+    RUN_TEST(test_profile_macros_count_the_cycles_of_a_region);
+    return UNITY_END();
+}
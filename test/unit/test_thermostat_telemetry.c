@@ -0,0 +1,202 @@
+#include <string.h>
+#include <unity.h>
+#include "fsm_thermostat.h"
+#include "thermostat_telemetry.h"
+
+#define TELEMETRY_TEST_STREAM_SIZE 4096U /*!< Bytes of the capture of the stream */
+
+static uint8_t stream[TELEMETRY_TEST_STREAM_SIZE]; /*!< Bytes sent by the encoder */
+static uint32_t stream_length;                      /*!< Bytes in `stream` */
+static uint32_t stream_frames;                      /*!< Frames sent by the encoder */
+
+/**
+ * @brief Output of the telemetry that plays the wire: it keeps the frames.
+ */
+static void _capture(const uint8_t *p_data, uint32_t length)
+{
+    TEST_ASSERT_LESS_OR_EQUAL(THERMOSTAT_TELEMETRY_MAX_ENCODED_BYTES, length);
+    TEST_ASSERT_LESS_OR_EQUAL(TELEMETRY_TEST_STREAM_SIZE, stream_length + length);
+    memcpy(&stream[stream_length], p_data, length);
+    stream_length += length;
+    stream_frames++;
+}
+
+/**
+ * @brief Decodes the captured stream.
+ *
+ * @return uint32_t Number of records decoded.
+ */
+static uint32_t _decode(thermostat_telemetry_decoder_t *p_decoder, thermostat_telemetry_record_t *p_records, uint32_t max_records)
+{
+    uint32_t n = 0;
+    thermostat_telemetry_decoder_init(p_decoder);
+    for (uint32_t i = 0; i < stream_length; i++)
+    {
+        if (thermostat_telemetry_decoder_push(p_decoder, stream[i]))
+        {
+            while ((n < max_records) && thermostat_telemetry_decoder_next(p_decoder, &p_records[n]))
+            {
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+void setUp(void)
+{
+    stream_length = 0;
+    stream_frames = 0;
+    thermostat_telemetry_init(_capture);
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_telemetry_records_are_decoded_as_sent(void)
+{
+    // Two sensors scanned every second, with temperatures around 0 ºC, a transition and a counter
+    for (uint32_t i = 0; i < 6U; i++)
+    {
+        thermostat_telemetry_sample(0, 5000U + 1000U * i, 20000 + 20 * (int32_t)i);
+        thermostat_telemetry_sample(3, 5000U + 1000U * i, 100 - 40 * (int32_t)i);
+    }
+    thermostat_telemetry_transition(2, DEACTIVATION, 10001);
+    thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_SLEEPS, 10002, 123456);
+    thermostat_telemetry_sample(0, 10003, 0); // Out of period, and a value of 0
+    TEST_ASSERT_EQUAL(0, stream_frames);
+    thermostat_telemetry_flush();
+    TEST_ASSERT_EQUAL(1, stream_frames);
+
+    // COBS: the only byte 0 is the delimiter of the frame
+    TEST_ASSERT_NULL(memchr(stream, 0, stream_length - 1U));
+    TEST_ASSERT_EQUAL(0, stream[stream_length - 1U]);
+
+    thermostat_telemetry_decoder_t decoder;
+    thermostat_telemetry_record_t records[16];
+    TEST_ASSERT_EQUAL(15, _decode(&decoder, records, 16));
+    TEST_ASSERT_EQUAL(1, decoder.frames);
+    TEST_ASSERT_EQUAL(0, decoder.bad_frames);
+    for (uint32_t i = 0; i < 6U; i++)
+    {
+        TEST_ASSERT_EQUAL(THERMOSTAT_TELEMETRY_SAMPLE, records[2 * i].type);
+        TEST_ASSERT_EQUAL(0, records[2 * i].id);
+        TEST_ASSERT_EQUAL(5000U + 1000U * i, records[2 * i].time_ms);
+        TEST_ASSERT_EQUAL(20000 + 20 * (int32_t)i, records[2 * i].value);
+        TEST_ASSERT_EQUAL(3, records[2 * i + 1].id);
+        TEST_ASSERT_EQUAL(5000U + 1000U * i, records[2 * i + 1].time_ms);
+        TEST_ASSERT_EQUAL(100 - 40 * (int32_t)i, records[2 * i + 1].value);
+    }
+    TEST_ASSERT_EQUAL(THERMOSTAT_TELEMETRY_TRANSITION, records[12].type);
+    TEST_ASSERT_EQUAL(2, records[12].id);
+    TEST_ASSERT_EQUAL(DEACTIVATION, records[12].value);
+    TEST_ASSERT_EQUAL(10001, records[12].time_ms);
+    TEST_ASSERT_EQUAL(THERMOSTAT_TELEMETRY_COUNTER, records[13].type);
+    TEST_ASSERT_EQUAL(THERMOSTAT_TELEMETRY_SLEEPS, records[13].id);
+    TEST_ASSERT_EQUAL(123456, records[13].value);
+    TEST_ASSERT_EQUAL(10003, records[14].time_ms);
+    TEST_ASSERT_EQUAL(0, records[14].value);
+}
+
+void test_telemetry_periodic_samples_take_less_than_3_bytes(void)
+{
+    // A sensor sampled every second that drifts slowly, as the thermostat sends it
+    uint32_t n_samples = 1000;
+    for (uint32_t i = 0; i < n_samples; i++)
+    {
+        thermostat_telemetry_sample(0, 1000U * i, 21000 + (int32_t)((i * 7U) % 100U) - 50);
+    }
+    thermostat_telemetry_flush();
+
+    // Less than a tenth of the 34 bytes of a line "[999000 ms] Temperature: 21.0 oC", frames included
+    TEST_ASSERT_LESS_OR_EQUAL(3U * n_samples, stream_length);
+
+    thermostat_telemetry_decoder_t decoder;
+    static thermostat_telemetry_record_t records[1000];
+    TEST_ASSERT_EQUAL(n_samples, _decode(&decoder, records, n_samples));
+    TEST_ASSERT_EQUAL(stream_frames, decoder.frames);
+    TEST_ASSERT_EQUAL(1000U * (n_samples - 1U), records[n_samples - 1U].time_ms);
+}
+
+void test_telemetry_frames_are_sent_when_full_late_or_back_in_time(void)
+{
+    // Full: the records of a frame never exceed its size
+    uint32_t time_ms = 0;
+    while (stream_frames == 0)
+    {
+        thermostat_telemetry_counter(THERMOSTAT_TELEMETRY_TRANSITIONS, time_ms, 0x7FFFFFFFU);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(THERMOSTAT_TELEMETRY_MAX_ENCODED_BYTES, stream_length);
+
+    // Late: the frame is sent when its first record is too old, even if it is not full
+    thermostat_telemetry_init(_capture);
+    stream_frames = 0;
+    thermostat_telemetry_sample(1, 1000, 20000);
+    thermostat_telemetry_sample(1, 1000 + THERMOSTAT_TELEMETRY_MAX_LATENCY_MS - 1U, 20000);
+    TEST_ASSERT_EQUAL(0, stream_frames);
+    thermostat_telemetry_sample(1, 1000 + THERMOSTAT_TELEMETRY_MAX_LATENCY_MS, 20000);
+    TEST_ASSERT_EQUAL(1, stream_frames);
+
+    // Back in time (e.g., the milliseconds wrap around): a new frame with its own base time
+    thermostat_telemetry_sample(1, 0xFFFFFF00U, 20000);
+    thermostat_telemetry_sample(1, 0x00000100U, 20000);
+    TEST_ASSERT_EQUAL(1, stream_frames);
+    thermostat_telemetry_sample(1, 0x00000080U, 20000);
+    TEST_ASSERT_EQUAL(2, stream_frames);
+    thermostat_telemetry_flush();
+    thermostat_telemetry_flush(); // Nothing to send
+    TEST_ASSERT_EQUAL(3, stream_frames);
+
+    thermostat_telemetry_decoder_t decoder;
+    thermostat_telemetry_record_t records[64];
+    uint32_t n = _decode(&decoder, records, 64);
+    TEST_ASSERT_EQUAL(0, decoder.bad_frames);
+    TEST_ASSERT_EQUAL(0x00000080U, records[n - 1U].time_ms);
+    TEST_ASSERT_EQUAL(0x00000100U, records[n - 2U].time_ms);
+    TEST_ASSERT_EQUAL(0xFFFFFF00U, records[n - 3U].time_ms);
+}
+
+void test_telemetry_decoder_resyncs_after_errors(void)
+{
+    // Text written to the same output before the frames (e.g., a banner) and three frames
+    const char *p_text = "Thermostat ON at 1000\n";
+    memcpy(stream, p_text, strlen(p_text));
+    stream_length = (uint32_t)strlen(p_text);
+    for (uint32_t frame = 0; frame < 3U; frame++)
+    {
+        thermostat_telemetry_sample(0, 1000U * frame, 20000 + (int32_t)frame);
+        thermostat_telemetry_flush();
+    }
+
+    // The second frame is corrupted on the wire. The text has no delimiter, so it is lost with the first frame
+    uint32_t second = (uint32_t)((uint8_t *)memchr(&stream[strlen(p_text)], 0, stream_length) - stream) + 2U;
+    stream[second] ^= 0x10U;
+
+    thermostat_telemetry_decoder_t decoder;
+    thermostat_telemetry_record_t records[4];
+    TEST_ASSERT_EQUAL(1, _decode(&decoder, records, 4));
+    TEST_ASSERT_EQUAL(2000, records[0].time_ms);
+    TEST_ASSERT_EQUAL(20002, records[0].value);
+    TEST_ASSERT_EQUAL(1, decoder.frames);
+    TEST_ASSERT_EQUAL(2, decoder.bad_frames);
+    TEST_ASSERT_EQUAL(stream_length, decoder.bytes);
+
+    // A frame too long for the decoder, and empty frames
+    memset(stream, 0x55, THERMOSTAT_TELEMETRY_FRAME_SIZE + 8U);
+    memset(&stream[THERMOSTAT_TELEMETRY_FRAME_SIZE + 8U], 0, 3);
+    stream_length = THERMOSTAT_TELEMETRY_FRAME_SIZE + 11U;
+    TEST_ASSERT_EQUAL(0, _decode(&decoder, records, 4));
+    TEST_ASSERT_EQUAL(1, decoder.bad_frames);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_telemetry_records_are_decoded_as_sent);
+    RUN_TEST(test_telemetry_periodic_samples_take_less_than_3_bytes);
+    RUN_TEST(test_telemetry_frames_are_sent_when_full_late_or_back_in_time);
+    RUN_TEST(test_telemetry_decoder_resyncs_after_errors);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#include <unity.h>
+#include "port_system.h"
+#include "fsm_thermostat.h"
+#include "thermostat_trace.h"
+
+static uint8_t image[THERMOSTAT_TRACE_HEADER_BYTES + THERMOSTAT_TRACE_SIZE];
+
+void setUp(void)
+{
+    port_system_init();
+    thermostat_trace_clear();
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_trace_records_are_compact(void)
+{
+    port_system_set_millis(1000);
+    thermostat_trace_sample(0, 100);
+    port_system_set_millis(2000);
+    thermostat_trace_sample(0, 16383);
+    thermostat_trace_transition(2, DEACTIVATION);
+
+    // Tag, delta and counts: 3 bytes for the first sample, 5 for a sample 1 s later, and 2 for a transition
+    TEST_ASSERT_EQUAL(THERMOSTAT_TRACE_HEADER_BYTES + 3 + 5 + 2, thermostat_trace_export(image, sizeof(image)));
+
+    thermostat_trace_reader_t reader;
+    thermostat_trace_record_t record;
+    TEST_ASSERT_TRUE(thermostat_trace_reader_init(&reader, image, sizeof(image)));
+    TEST_ASSERT_TRUE(thermostat_trace_reader_next(&reader, &record));
+    TEST_ASSERT_EQUAL(THERMOSTAT_TRACE_SAMPLE, record.type);
+    TEST_ASSERT_EQUAL(1000, record.time_ms);
+    TEST_ASSERT_EQUAL(100, record.value);
+    TEST_ASSERT_TRUE(thermostat_trace_reader_next(&reader, &record));
+    TEST_ASSERT_EQUAL(2000, record.time_ms);
+    TEST_ASSERT_EQUAL(16383, record.value);
+    TEST_ASSERT_TRUE(thermostat_trace_reader_next(&reader, &record));
+    TEST_ASSERT_EQUAL(THERMOSTAT_TRACE_TRANSITION, record.type);
+    TEST_ASSERT_EQUAL(2000, record.time_ms);
+    TEST_ASSERT_EQUAL(2, record.zone);
+    TEST_ASSERT_EQUAL(DEACTIVATION, record.value);
+    TEST_ASSERT_FALSE(thermostat_trace_reader_next(&reader, &record));
+
+    // A buffer without room for the whole trace gets nothing
+    TEST_ASSERT_EQUAL(0, thermostat_trace_export(image, THERMOSTAT_TRACE_HEADER_BYTES + 9));
+}
+
+void test_trace_drops_the_oldest_records_when_full(void)
+{
+    // Samples every second take 5 bytes: the ring keeps the most recent ones
+    uint32_t n_samples = THERMOSTAT_TRACE_SIZE;
+    for (uint32_t i = 1; i <= n_samples; i++)
+    {
+        port_system_set_millis(i * 1000U);
+        thermostat_trace_sample(0, i);
+    }
+    uint32_t dropped = thermostat_trace_get_dropped();
+    TEST_ASSERT_GREATER_OR_EQUAL(n_samples - THERMOSTAT_TRACE_SIZE / 5U, dropped);
+
+    // The oldest record left keeps its absolute time
+    thermostat_trace_reader_t reader;
+    thermostat_trace_record_t record;
+    TEST_ASSERT_TRUE(thermostat_trace_reader_init(&reader, image, thermostat_trace_export(image, sizeof(image))));
+    TEST_ASSERT_EQUAL(dropped, reader.dropped);
+    uint32_t expected = dropped + 1U;
+    while (thermostat_trace_reader_next(&reader, &record))
+    {
+        TEST_ASSERT_EQUAL(expected * 1000U, record.time_ms);
+        TEST_ASSERT_EQUAL(expected, record.value);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL(n_samples + 1U, expected);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_trace_records_are_compact);
+    RUN_TEST(test_trace_drops_the_oldest_records_when_full);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file telemetry_decode.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Host tool to decode a capture of the telemetry stream of the thermostat (see `thermostat_telemetry.h`).
+ *
+ * Usage: `telemetry_decode [-q] <capture.bin | ->`. The capture is the raw output of the ITM (stimulus port 0) or of the native platform, read from a file or from the standard input (`-`). Each record is printed as a line of text, and a summary of the frames and of the bytes per record is printed at the end. With `-q`, only the summary is printed. It returns 0 if all the frames are valid.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* Project includes */
+#include "fsm_thermostat.h"
+#include "thermostat_telemetry.h"
+
+/* Global variables -----------------------------------------------------------*/
+/**
+ * @brief Names of the counters of the telemetry.
+ */
+static const char *const counter_names[] = {
+    [THERMOSTAT_TELEMETRY_AWAKE_PERMILLE] = "awake_permille",
+    [THERMOSTAT_TELEMETRY_SLEEPS] = "sleeps",
+    [THERMOSTAT_TELEMETRY_STOPS] = "stops",
+    [THERMOSTAT_TELEMETRY_TRANSITIONS] = "transitions",
+    [THERMOSTAT_TELEMETRY_LOG_DROPPED] = "log_dropped",
+};
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Prints a record as a line of text.
+ */
+static void _print(const thermostat_telemetry_record_t *p_record)
+{
+    switch (p_record->type)
+    {
+    case THERMOSTAT_TELEMETRY_SAMPLE:
+    {
+        // The sign is printed apart, so that -0.5 oC is not printed as 0.500
+        uint32_t magnitude = (p_record->value < 0) ? (0U - (uint32_t)p_record->value) : (uint32_t)p_record->value;
+        printf("[%" PRIu32 " ms] sensor %u %s%" PRIu32 ".%03" PRIu32 " oC\n", p_record->time_ms, p_record->id, (p_record->value < 0) ? "-" : "", magnitude / 1000U, magnitude % 1000U);
+        break;
+    }
+    case THERMOSTAT_TELEMETRY_TRANSITION:
+        printf("[%" PRIu32 " ms] zone %u %s\n", p_record->time_ms, p_record->id, (p_record->value == ACTIVATION) ? "ON" : "OFF");
+        break;
+    default:
+        if ((p_record->id < (sizeof(counter_names) / sizeof(counter_names[0]))) && (counter_names[p_record->id] != NULL))
+        {
+            printf("[%" PRIu32 " ms] %s %" PRId32 "\n", p_record->time_ms, counter_names[p_record->id], p_record->value);
+        }
+        else
+        {
+            printf("[%" PRIu32 " ms] counter %u %" PRId32 "\n", p_record->time_ms, p_record->id, p_record->value);
+        }
+        break;
+    }
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Decodes a capture of the telemetry.
+ *
+ * @param argc Number of arguments.
+ * @param argv Arguments: `[-q] <capture.bin | ->`.
+ * @return int 0 if all the frames are valid, 1 if some are not, 2 on error.
+ */
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+    int quiet = (argc > arg) && (strcmp(argv[arg], "-q") == 0);
+    arg += quiet;
+    if (argc <= arg)
+    {
+        fprintf(stderr, "Usage: %s [-q] <capture.bin | ->\n", argv[0]);
+        return 2;
+    }
+
+    FILE *p_file = (strcmp(argv[arg], "-") == 0) ? stdin : fopen(argv[arg], "rb");
+    if (p_file == NULL)
+    {
+        perror(argv[arg]);
+        return 2;
+    }
+
+    thermostat_telemetry_decoder_t decoder;
+    thermostat_telemetry_record_t record;
+    uint32_t records = 0;
+    thermostat_telemetry_decoder_init(&decoder);
+    int byte;
+    while ((byte = getc(p_file)) != EOF)
+    {
+        if (thermostat_telemetry_decoder_push(&decoder, (uint8_t)byte))
+        {
+            while (thermostat_telemetry_decoder_next(&decoder, &record))
+            {
+                if (!quiet)
+                {
+                    _print(&record);
+                }
+                records++;
+            }
+        }
+    }
+    if (p_file != stdin)
+    {
+        fclose(p_file);
+    }
+
+    uint32_t centibytes = (records > 0) ? (uint32_t)(((uint64_t)decoder.bytes * 100U) / records) : 0;
+    printf("%" PRIu32 " records in %" PRIu32 " frames (%" PRIu32 " bad), %" PRIu32 " bytes: %" PRIu32 ".%02" PRIu32 " bytes per record\n", records, decoder.frames, decoder.bad_frames, decoder.bytes, centibytes / 100U, centibytes % 100U);
+    return (decoder.bad_frames == 0) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file trace_replay.c
+ * @author Josué Pagán (j.pagan@upm.es)
+ * @brief Host tool to print and replay an image of the trace of the thermostat (see `thermostat_trace.h`).
+ *
+ * Usage: `trace_replay [-d] <trace.bin> [zone [sensor]]`. The samples of the sensor (0 by default) are replayed into a new thermostat with the default configuration, and the transitions of the replay are compared with the ones recorded for the zone (0 by default). With `-d`, the records are printed too. It returns 0 if the replay makes the same transitions as the recording.
+ *
+ * @date 2024-05-01
+ *
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Standard C includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* Project includes */
+#include "port_system.h"
+#include "port_led.h"
+#include "port_temp_sensor.h"
+#include "fsm_thermostat.h"
+#include "thermostat_trace.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define TRACE_REPLAY_MAX_BYTES (16U * 1024U * 1024U) /*!< Largest image accepted */
+
+/* Private functions ----------------------------------------------------------*/
+/**
+ * @brief Reads a whole file into memory.
+ *
+ * @param p_path Path of the file.
+ * @param p_length Pointer to store the bytes of the file.
+ * @return uint8_t* Contents of the file (to be freed), or NULL on error.
+ */
+static uint8_t *_read_file(const char *p_path, uint32_t *p_length)
+{
+    FILE *p_file = fopen(p_path, "rb");
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return NULL;
+    }
+    uint8_t *p_data = malloc(TRACE_REPLAY_MAX_BYTES);
+    if (p_data != NULL)
+    {
+        *p_length = (uint32_t)fread(p_data, 1, TRACE_REPLAY_MAX_BYTES, p_file);
+    }
+    fclose(p_file);
+    return p_data;
+}
+
+/**
+ * @brief Prints all the records of an image.
+ */
+static void _dump(const uint8_t *p_image, uint32_t length)
+{
+    thermostat_trace_reader_t reader;
+    thermostat_trace_record_t record;
+    thermostat_trace_reader_init(&reader, p_image, length);
+    printf("%" PRIu32 " bytes of records, %" PRIu32 " records dropped before the first one\n", reader.length, reader.dropped);
+    while (thermostat_trace_reader_next(&reader, &record))
+    {
+        if (record.type == THERMOSTAT_TRACE_SAMPLE)
+        {
+            printf("[%" PRIu32 " ms] sensor %u sample %" PRIu32 " counts\n", record.time_ms, record.zone, record.value);
+        }
+        else
+        {
+            printf("[%" PRIu32 " ms] zone %u %s\n", record.time_ms, record.zone, (record.value == ACTIVATION) ? "ON" : "OFF");
+        }
+    }
+    if (reader.offset != reader.length)
+    {
+        printf("Truncated record at byte %" PRIu32 "\n", reader.offset);
+    }
+}
+
+/* Main ----------------------------------------------------------------------*/
+/**
+ * @brief Replays an image of the trace.
+ *
+ * @param argc Number of arguments.
+ * @param argv Arguments: `[-d] <trace.bin> [zone [sensor]]`.
+ * @return int 0 if the replay matches the recording, 1 if it does not, 2 on error.
+ */
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+    int dump = (argc > arg) && (strcmp(argv[arg], "-d") == 0);
+    arg += dump;
+    if (argc <= arg)
+    {
+        fprintf(stderr, "Usage: %s [-d] <trace.bin> [zone [sensor]]\n", argv[0]);
+        return 2;
+    }
+    uint8_t zone = (argc > arg + 1) ? (uint8_t)atoi(argv[arg + 1]) : 0;
+    uint8_t sensor = (argc > arg + 2) ? (uint8_t)atoi(argv[arg + 2]) : 0;
+
+    uint32_t length = 0;
+    uint8_t *p_image = _read_file(argv[arg], &length);
+    if (p_image == NULL)
+    {
+        return 2;
+    }
+
+    port_system_init();
+    fsm_t *p_fsm = fsm_thermostat_new(&led_heater_active, &led_comfort_temperature, &temp_sensor_thermostat);
+    thermostat_trace_replay_result_t result;
+    if (!thermostat_trace_replay(p_image, length, p_fsm, zone, sensor, &result))
+    {
+        fprintf(stderr, "%s: not a trace of the thermostat\n", argv[arg]);
+        free(p_image);
+        return 2;
+    }
+    if (dump)
+    {
+        _dump(p_image, length);
+    }
+    printf("%" PRIu32 " samples, %" PRIu32 " transitions recorded, %" PRIu32 " replayed, %" PRIu32 " mismatches\n", result.samples, result.recorded_transitions, result.replayed_transitions, result.mismatches);
+
+    free(p_image);
+    return (result.mismatches == 0) ? 0 : 1;
+}